@@ -0,0 +1,391 @@
+/*
+  ==============================================================================
+
+    The storage that the processor records into and plays back from.
+
+  ==============================================================================
+*/
+
+#include "CaptureBuffer.h"
+#include "ReversatronKernels.h"
+
+//==============================================================================
+CaptureBuffer::CaptureBuffer (int numChannelsToUse, int numSamplesToUse)
+    : numChannels (numChannelsToUse), numSamples (numSamplesToUse)
+{
+}
+
+template <typename SampleType>
+void CaptureBuffer::write (const juce::AudioBuffer<SampleType>& source, int startFrame, int numToWrite) noexcept
+{
+    beginWrite (startFrame, numToWrite);
+
+    for (int channel = juce::jmin (numChannels, source.getNumChannels()); --channel >= 0;)
+        writeChannel (channel, source.getReadPointer (channel), startFrame, numToWrite);
+
+    endWrite (startFrame, numToWrite);
+}
+
+template void CaptureBuffer::write (const juce::AudioBuffer<float>&, int, int) noexcept;
+template void CaptureBuffer::write (const juce::AudioBuffer<double>&, int, int) noexcept;
+
+void CaptureBuffer::beginWrite (int, int) noexcept
+{
+}
+
+void CaptureBuffer::reserveFrames (int, int)
+{
+}
+
+void CaptureBuffer::endWrite (int, int) noexcept
+{
+}
+
+void CaptureBuffer::writeChannel (int channel, const double* source, int startFrame, int numToWrite) noexcept
+{
+    float chunk[conversionChunkSize];
+
+    for (int done = 0; done < numToWrite; done += conversionChunkSize)
+    {
+        const auto num = juce::jmin (conversionChunkSize, numToWrite - done);
+
+        for (int i = 0; i < num; ++i)
+            chunk[i] = static_cast<float> (source[done + i]);
+
+        writeChannel (channel, chunk, startFrame + done, num);
+    }
+}
+
+const float* CaptureBuffer::getReadPointer (int, int, int) const noexcept
+{
+    return nullptr;
+}
+
+const double* CaptureBuffer::getDoubleReadPointer (int, int, int) const noexcept
+{
+    return nullptr;
+}
+
+void CaptureBuffer::readReversed (int channel, int position, double* dest, int num) noexcept
+{
+    float chunk[conversionChunkSize];
+
+    for (int done = 0; done < num; done += conversionChunkSize)
+    {
+        const auto n = juce::jmin (conversionChunkSize, num - done);
+        readReversed (channel, position + done, chunk, n);
+
+        for (int i = 0; i < n; ++i)
+            dest[done + i] = static_cast<double> (chunk[i]);
+    }
+}
+
+void CaptureBuffer::copyFrames (int, int, int, int) noexcept
+{
+    // Only buffers that can be used as a ring can copy within themselves.
+    jassertfalse;
+}
+
+void CaptureBuffer::beginPlayback (int) noexcept
+{
+}
+
+void CaptureBuffer::releaseReversed (int) noexcept
+{
+}
+
+void CaptureBuffer::release() noexcept
+{
+}
+
+void CaptureBuffer::readTake (int channel, int startFrame, float* dest, int num)
+{
+    if (auto* src = getReadPointer (channel, startFrame, num))
+    {
+        juce::FloatVectorOperations::copy (dest, src, num);
+        return;
+    }
+
+    // Recorded frame f is playback position (numSamples - 1 - f).
+    readReversed (channel, numSamples - startFrame - num, dest, num);
+    std::reverse (dest, dest + num);
+}
+
+void CaptureBuffer::readTake (int channel, int startFrame, double* dest, int num)
+{
+    if (auto* src = getDoubleReadPointer (channel, startFrame, num))
+    {
+        std::copy (src, src + num, dest);
+        return;
+    }
+
+    if (getBitsPerSample() == 64)
+    {
+        readReversed (channel, numSamples - startFrame - num, dest, num);
+        std::reverse (dest, dest + num);
+        return;
+    }
+
+    float chunk[conversionChunkSize];
+
+    for (int done = 0; done < num; done += conversionChunkSize)
+    {
+        const auto n = juce::jmin (conversionChunkSize, num - done);
+        readTake (channel, startFrame + done, chunk, n);
+
+        for (int i = 0; i < n; ++i)
+            dest[done + i] = static_cast<double> (chunk[i]);
+    }
+}
+
+void CaptureBuffer::flushWrites()
+{
+}
+
+//==============================================================================
+template <typename SampleType>
+MemoryCaptureBuffer<SampleType>::MemoryCaptureBuffer (int numChannelsToUse, int numSamplesToUse, CaptureSegmentPool& poolToUse)
+    : CaptureBuffer (numChannelsToUse, numSamplesToUse),
+      pool (poolToUse),
+      numSegments ((numSamplesToUse + segmentSize - 1) >> segmentShift),
+      segments ((size_t) (numChannelsToUse * numSegments), true)
+{
+}
+
+template <typename SampleType>
+MemoryCaptureBuffer<SampleType>::~MemoryCaptureBuffer()
+{
+    for (int i = 0; i < numChannels * numSegments; ++i)
+        pool.freeSegment (segments[i]);
+}
+
+template <typename SampleType>
+float*& MemoryCaptureBuffer<SampleType>::getSegment (int channel, int index) const noexcept
+{
+    return segments[channel * numSegments + index];
+}
+
+template <typename SampleType>
+float* MemoryCaptureBuffer<SampleType>::acquireSegment (int channel, int index) noexcept
+{
+    auto& segment = getSegment (channel, index);
+
+    if (segment == nullptr)
+        if ((segment = pool.take()) != nullptr)
+            ++numSegmentsHeld;
+
+    return segment;
+}
+
+template <typename SampleType>
+void MemoryCaptureBuffer<SampleType>::beginWrite (int startFrame, int numToWrite) noexcept
+{
+    if (numToWrite <= 0)
+        return;
+
+    // Segments are claimed here rather than per channel, as only the audio
+    // thread may take from the pool. The one after the last is picked up
+    // early, while the pool has one ready.
+    const auto firstIndex = startFrame >> segmentShift;
+    const auto lastIndex = juce::jmin (numSegments - 1, ((startFrame + numToWrite - 1) >> segmentShift) + 1);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        for (int index = firstIndex; index <= lastIndex; ++index)
+            acquireSegment (channel, index);
+}
+
+template <typename SampleType>
+void MemoryCaptureBuffer<SampleType>::reserveFrames (int startFrame, int numToWrite)
+{
+    if (numToWrite <= 0)
+        return;
+
+    // The same segments beginWrite() would claim, allocated directly so that
+    // it finds them all in place and never takes from the pool: the pool's
+    // ready queue may only be read by the audio thread.
+    const auto firstIndex = startFrame >> segmentShift;
+    const auto lastIndex = juce::jmin (numSegments - 1, ((startFrame + numToWrite - 1) >> segmentShift) + 1);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        for (int index = firstIndex; index <= lastIndex; ++index)
+        {
+            auto& segment = getSegment (channel, index);
+
+            if (segment == nullptr)
+                if ((segment = pool.allocateSegment()) != nullptr)
+                    ++numSegmentsHeld;
+        }
+    }
+}
+
+template <typename SampleType>
+template <typename SourceType>
+void MemoryCaptureBuffer<SampleType>::writeSamples (int channel, const SourceType* source, int startFrame, int numToWrite) noexcept
+{
+    for (int done = 0; done < numToWrite;)
+    {
+        const auto frame = startFrame + done;
+        const auto index = frame >> segmentShift;
+        const auto offset = frame & (segmentSize - 1);
+        const auto num = juce::jmin (numToWrite - done, segmentSize - offset);
+
+        // Segments are raw storage from the pool, holding whichever type
+        // this buffer records.
+        if (auto* segment = reinterpret_cast<SampleType*> (getSegment (channel, index)))
+        {
+            if constexpr (std::is_same_v<SourceType, SampleType>)
+                juce::FloatVectorOperations::copy (segment + offset, source + done, num);
+            else
+                for (int i = 0; i < num; ++i)
+                    segment[offset + i] = static_cast<SampleType> (source[done + i]);
+        }
+        else if (channel == 0)
+        {
+            numDroppedSamples.store (numDroppedSamples.load (std::memory_order_relaxed) + num, std::memory_order_relaxed);
+        }
+
+        done += num;
+    }
+}
+
+template <typename SampleType>
+void MemoryCaptureBuffer<SampleType>::writeChannel (int channel, const float* source, int startFrame, int numToWrite) noexcept
+{
+    writeSamples (channel, source, startFrame, numToWrite);
+}
+
+template <typename SampleType>
+void MemoryCaptureBuffer<SampleType>::writeChannel (int channel, const double* source, int startFrame, int numToWrite) noexcept
+{
+    writeSamples (channel, source, startFrame, numToWrite);
+}
+
+template <typename SampleType>
+const SampleType* MemoryCaptureBuffer<SampleType>::getSegmentPointer (int channel, int startFrame, int num) const noexcept
+{
+    const auto index = startFrame >> segmentShift;
+
+    if (((startFrame + num - 1) >> segmentShift) != index)
+        return nullptr;
+
+    if (auto* segment = reinterpret_cast<const SampleType*> (getSegment (channel, index)))
+        return segment + (startFrame & (segmentSize - 1));
+
+    return nullptr;
+}
+
+template <typename SampleType>
+const float* MemoryCaptureBuffer<SampleType>::getReadPointer (int channel, int startFrame, int num) const noexcept
+{
+    if constexpr (std::is_same_v<SampleType, float>)
+        return getSegmentPointer (channel, startFrame, num);
+    else
+        return nullptr;
+}
+
+template <typename SampleType>
+const double* MemoryCaptureBuffer<SampleType>::getDoubleReadPointer (int channel, int startFrame, int num) const noexcept
+{
+    if constexpr (std::is_same_v<SampleType, double>)
+        return getSegmentPointer (channel, startFrame, num);
+    else
+        return nullptr;
+}
+
+template <typename SampleType>
+template <typename DestType>
+void MemoryCaptureBuffer<SampleType>::readSamplesReversed (int channel, int position, DestType* dest, int num) noexcept
+{
+    const auto firstFrame = numSamples - position - num;
+
+    // Walk backwards from the last frame wanted, one segment at a time.
+    for (int done = 0; done < num;)
+    {
+        const auto frame = firstFrame + num - 1 - done;
+        const auto index = frame >> segmentShift;
+        const auto segmentStart = index << segmentShift;
+        const auto runStart = juce::jmax (segmentStart, firstFrame);
+        const auto n = frame - runStart + 1;
+
+        if (auto* segment = reinterpret_cast<const SampleType*> (getSegment (channel, index)))
+        {
+            const auto* src = segment + (runStart - segmentStart);
+
+            if constexpr (std::is_same_v<DestType, SampleType>)
+                ReversatronKernels::reverseCopy (dest + done, src, n);
+            else
+                for (int i = 0; i < n; ++i)
+                    dest[done + i] = static_cast<DestType> (src[n - 1 - i]);
+        }
+        else
+        {
+            juce::FloatVectorOperations::clear (dest + done, n);
+        }
+
+        done += n;
+    }
+}
+
+template <typename SampleType>
+void MemoryCaptureBuffer<SampleType>::readReversed (int channel, int position, float* dest, int num) noexcept
+{
+    readSamplesReversed (channel, position, dest, num);
+}
+
+template <typename SampleType>
+void MemoryCaptureBuffer<SampleType>::readReversed (int channel, int position, double* dest, int num) noexcept
+{
+    readSamplesReversed (channel, position, dest, num);
+}
+
+template <typename SampleType>
+void MemoryCaptureBuffer<SampleType>::copyFrames (int channel, int sourceFrame, int destFrame, int num) noexcept
+{
+    // Split wherever either range crosses into another segment. A missing
+    // source segment was dropped while recording, so it copies as silence.
+    for (int done = 0; done < num;)
+    {
+        const auto source = sourceFrame + done;
+        const auto dest = destFrame + done;
+        const auto sourceOffset = source & (segmentSize - 1);
+        const auto destOffset = dest & (segmentSize - 1);
+        const auto n = juce::jmin (num - done, segmentSize - sourceOffset, segmentSize - destOffset);
+
+        if (auto* destSegment = reinterpret_cast<SampleType*> (getSegment (channel, dest >> segmentShift)))
+        {
+            if (auto* sourceSegment = reinterpret_cast<const SampleType*> (getSegment (channel, source >> segmentShift)))
+                juce::FloatVectorOperations::copy (destSegment + destOffset, sourceSegment + sourceOffset, n);
+            else
+                juce::FloatVectorOperations::clear (destSegment + destOffset, n);
+        }
+        else if (channel == 0)
+        {
+            numDroppedSamples.store (numDroppedSamples.load (std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        done += n;
+    }
+}
+
+template <typename SampleType>
+void MemoryCaptureBuffer<SampleType>::release() noexcept
+{
+    if (numSegmentsHeld == 0)
+        return;
+
+    for (int i = 0; i < numChannels * numSegments; ++i)
+    {
+        if (segments[i] != nullptr)
+        {
+            if (! pool.give (segments[i]))
+                return;
+
+            segments[i] = nullptr;
+            --numSegmentsHeld;
+        }
+    }
+}
+
+template class MemoryCaptureBuffer<float>;
+template class MemoryCaptureBuffer<double>;
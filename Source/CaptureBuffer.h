@@ -0,0 +1,267 @@
+/*
+  ==============================================================================
+
+    The storage that the processor records into and plays back from.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CaptureSegmentPool.h"
+
+//==============================================================================
+enum class CaptureStorage
+{
+    memory = 0,
+    disk
+};
+
+/** Sample encoding used by memory storage. Disk storage always uses float32. */
+enum class CaptureFormat
+{
+    float32 = 0,
+    int16,
+    int24,
+    lossless24,
+    float64
+};
+
+/** Everything the allocator needs to know to build a buffer. */
+struct CaptureBufferSpec
+{
+    int numChannels = 0;
+    int numSamples = 0;
+    CaptureStorage storage = CaptureStorage::memory;
+    CaptureFormat format = CaptureFormat::float32;
+    bool doubleBuffered = false;    // two buffers for ping-pong mode
+
+    bool operator== (const CaptureBufferSpec& other) const noexcept
+    {
+        return numChannels == other.numChannels && numSamples == other.numSamples && storage == other.storage
+            && format == other.format && doubleBuffered == other.doubleBuffered;
+    }
+
+    bool operator!= (const CaptureBufferSpec& other) const noexcept     { return ! operator== (other); }
+};
+
+//==============================================================================
+/**
+    Base class for the reverse buffer backends.
+
+    A take is always written front to back, starting at frame 0, and then read
+    back as "playback positions": position p is recorded frame
+    (getNumSamples() - 1 - p). Both sides are driven from the audio thread.
+
+    Writes are split into beginWrite(), a writeChannel() per channel and
+    endWrite(), so that the channels can be spread across worker threads.
+    Different channels may likewise be read concurrently; everything else is
+    called from the audio thread only.
+
+    The audio thread writes and reads at whichever precision the host is
+    processing at. Backends that store some other sample type only need to
+    implement the float versions; the double ones convert through them.
+*/
+class CaptureBuffer
+{
+public:
+    CaptureBuffer (int numChannels, int numSamples);
+    virtual ~CaptureBuffer() = default;
+
+    int getNumChannels() const noexcept   { return numChannels; }
+    int getNumSamples() const noexcept    { return numSamples; }
+
+    /** True if this records one take while playing back the previous one. */
+    virtual bool isDoubleBuffered() const noexcept    { return false; }
+
+    /** True if frames can be written and read back in any order, so that the
+        buffer can be used as a ring (see SliceReverser).
+    */
+    virtual bool isRandomAccess() const noexcept      { return false; }
+
+    /** The precision the take is stored at: 16 or 24 for the fixed-point
+        formats, 32 or 64 for floating point.
+    */
+    virtual int getBitsPerSample() const noexcept     { return 32; }
+
+    /** Stores the first numToWrite samples of each channel of source at
+        startFrame. A write at frame 0 begins a new take.
+    */
+    template <typename SampleType>
+    void write (const juce::AudioBuffer<SampleType>& source, int startFrame, int numToWrite) noexcept;
+
+    /** Called before the channels of each write are stored. */
+    virtual void beginWrite (int startFrame, int numToWrite) noexcept;
+
+    /** Off the audio thread, before the buffer is handed over: gets the
+        memory for a write of these frames ready without drawing on anything
+        the audio thread uses, so that the write can then be made from
+        another thread (e.g. when a take is converted into a new buffer).
+    */
+    virtual void reserveFrames (int startFrame, int numToWrite);
+
+    /** Stores numToWrite samples of one channel at startFrame. */
+    virtual void writeChannel (int channel, const float* source, int startFrame, int numToWrite) noexcept = 0;
+    virtual void writeChannel (int channel, const double* source, int startFrame, int numToWrite) noexcept;
+
+    /** Called once every channel of a write has been stored. */
+    virtual void endWrite (int startFrame, int numToWrite) noexcept;
+
+    /** Called once recording stops and playback is about to begin. Normally
+        the whole take was recorded; if it was cut short, only frames
+        [0, numFramesRecorded) are valid and playback starts at position
+        (getNumSamples() - numFramesRecorded).
+    */
+    virtual void beginPlayback (int numFramesRecorded) noexcept;
+
+    /** Returns frames [startFrame, startFrame + num) in their original order
+        if the backend holds them contiguously in memory, or nullptr if they
+        have to be fetched with readReversed().
+    */
+    virtual const float* getReadPointer (int channel, int startFrame, int num) const noexcept;
+
+    /** As getReadPointer(), for backends that store doubles. */
+    virtual const double* getDoubleReadPointer (int channel, int startFrame, int num) const noexcept;
+
+    /** getReadPointer() or getDoubleReadPointer(), for code templated on the
+        sample type.
+    */
+    template <typename SampleType>
+    const SampleType* getReadPointerAs (int channel, int startFrame, int num) const noexcept
+    {
+        if constexpr (std::is_same_v<SampleType, double>)
+            return getDoubleReadPointer (channel, startFrame, num);
+        else
+            return getReadPointer (channel, startFrame, num);
+    }
+
+    /** Fills dest with playback positions [position, position + num). */
+    virtual void readReversed (int channel, int position, float* dest, int num) noexcept = 0;
+    virtual void readReversed (int channel, int position, double* dest, int num) noexcept;
+
+    /** Copies frames [sourceFrame, sourceFrame + num) of one channel to
+        destFrame, for buffers used as a ring (see isRandomAccess()). The
+        two ranges mustn't overlap, and the destination has to have been
+        claimed with beginWrite().
+    */
+    virtual void copyFrames (int channel, int sourceFrame, int destFrame, int num) noexcept;
+
+    /** Tells the backend that playback positions below this won't be read again. */
+    virtual void releaseReversed (int position) noexcept;
+
+    /** Called on the audio thread while stopped: the take is finished with,
+        so any memory that can be handed back should be.
+    */
+    virtual void release() noexcept;
+
+    //==============================================================================
+    /** Copies recorded frames [startFrame, startFrame + num) of the take in
+        their original order. Only for use off the audio thread, once the
+        buffer has been handed over, e.g. to convert a take to a new sample
+        rate; a take still being recorded must be finished with
+        beginPlayback() first.
+    */
+    virtual void readTake (int channel, int startFrame, float* dest, int num);
+
+    /** As readTake(), at full precision for a take stored as doubles; other
+        takes convert through the float version.
+    */
+    virtual void readTake (int channel, int startFrame, double* dest, int num);
+
+    /** Blocks until everything written so far has been stored. Like
+        readTake(), this is for converting takes off the audio thread.
+    */
+    virtual void flushWrites();
+
+    /** Any thread: the RAM the buffer has committed, other than segments
+        from a CaptureSegmentPool (which the pool accounts for itself). It
+        may lag a block behind the audio thread.
+    */
+    virtual size_t getNumBytesUsed() const noexcept   { return 0; }
+
+    /** Any thread: frames of input that couldn't be stored since the buffer
+        was created, and will play back as silence. It may lag a block behind
+        the audio thread.
+    */
+    virtual int getNumDroppedSamples() const noexcept { return 0; }
+
+    uint32_t generation = 0;
+
+protected:
+    const int numChannels, numSamples;
+
+    /** The double versions of writeChannel() and readReversed() convert this
+        many samples at a time, on the stack.
+    */
+    static constexpr int conversionChunkSize = 256;
+
+private:
+    JUCE_DECLARE_NON_COPYABLE (CaptureBuffer)
+};
+
+//==============================================================================
+/**
+    Keeps the take in RAM as 32-bit floats (CaptureFormat::float32) or
+    64-bit doubles (CaptureFormat::float64), split into fixed-size segments.
+
+    Segments are taken from a CaptureSegmentPool as the record head reaches
+    them (plus one ahead, so the pool has time to refill), and handed back by
+    release(). Resident memory therefore follows what has actually been
+    recorded rather than the configured length. A take copied in on the
+    allocator's thread gets its segments from reserveFrames() instead. If
+    the pool ever runs dry (including when the memory budget shared by all
+    instances is used up) the affected samples are dropped and play back as
+    silence, and counted by getNumDroppedSamples().
+
+    A pool segment is a fixed number of bytes, so it holds half as many
+    frames of doubles. Input and output at the other precision is converted
+    on the way in and out.
+*/
+template <typename SampleType>
+class MemoryCaptureBuffer  : public CaptureBuffer
+{
+public:
+    MemoryCaptureBuffer (int numChannels, int numSamples, CaptureSegmentPool& pool);
+    ~MemoryCaptureBuffer() override;
+
+    bool isRandomAccess() const noexcept override     { return true; }
+    int getBitsPerSample() const noexcept override    { return 8 * (int) sizeof (SampleType); }
+
+    void beginWrite (int startFrame, int numToWrite) noexcept override;
+    void reserveFrames (int startFrame, int numToWrite) override;
+    void writeChannel (int channel, const float* source, int startFrame, int numToWrite) noexcept override;
+    void writeChannel (int channel, const double* source, int startFrame, int numToWrite) noexcept override;
+    const float* getReadPointer (int channel, int startFrame, int num) const noexcept override;
+    const double* getDoubleReadPointer (int channel, int startFrame, int num) const noexcept override;
+    void readReversed (int channel, int position, float* dest, int num) noexcept override;
+    void readReversed (int channel, int position, double* dest, int num) noexcept override;
+    void copyFrames (int channel, int sourceFrame, int destFrame, int num) noexcept override;
+    void release() noexcept override;
+
+    /** Frames that couldn't be stored because no segment was ready. */
+    int getNumDroppedSamples() const noexcept override  { return numDroppedSamples.load (std::memory_order_relaxed); }
+
+private:
+    static constexpr int segmentShift = CaptureSegmentPool::segmentShift - (sizeof (SampleType) == sizeof (double) ? 1 : 0);
+    static constexpr int segmentSize = 1 << segmentShift;
+
+    float*& getSegment (int channel, int index) const noexcept;
+    float* acquireSegment (int channel, int index) noexcept;
+
+    template <typename SourceType>
+    void writeSamples (int channel, const SourceType* source, int startFrame, int numToWrite) noexcept;
+
+    template <typename DestType>
+    void readSamplesReversed (int channel, int position, DestType* dest, int num) noexcept;
+
+    const SampleType* getSegmentPointer (int channel, int startFrame, int num) const noexcept;
+
+    CaptureSegmentPool& pool;
+    const int numSegments;
+    juce::HeapBlock<float*> segments;
+    int numSegmentsHeld = 0;
+    std::atomic<int> numDroppedSamples { 0 };   // written by the audio thread only
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MemoryCaptureBuffer)
+};
@@ -0,0 +1,320 @@
+/*
+  ==============================================================================
+
+    Prepares reverse buffers on a worker thread and hands them to the audio
+    thread without locking or allocating there.
+
+  ==============================================================================
+*/
+
+#include "CaptureBufferAllocator.h"
+#include "CompactCaptureBuffer.h"
+#include "DiskCaptureBuffer.h"
+#include "PingPongCaptureBuffer.h"
+
+//==============================================================================
+CaptureBufferAllocator::CaptureBufferAllocator()
+    : juce::Thread ("ReversaTron buffer allocator")
+{
+    startThread();
+}
+
+CaptureBufferAllocator::~CaptureBufferAllocator()
+{
+    stopThread (10000);
+
+    delete preparedBuffer.exchange (nullptr);
+    reclaimRetiredBuffers();
+}
+
+//==============================================================================
+uint32_t CaptureBufferAllocator::requestBuffer (const CaptureBufferSpec& spec, std::unique_ptr<CaptureCarryOver> carryOver)
+{
+    uint32_t generation;
+
+    if (carryOver != nullptr)
+    {
+        // The take's old buffer is no longer the audio thread's, and the
+        // worker mustn't be reading it when it's freed.
+        const juce::ScopedLock sl (installedBufferLock);
+        auto* expected = carryOver->source.get();
+        installedBuffer.compare_exchange_strong (expected, nullptr);
+    }
+
+    {
+        const juce::ScopedLock sl (requestLock);
+        requestedSpec = spec;
+        std::swap (requestedCarryOver, carryOver);
+        generation = ++requestedGeneration;
+    }
+
+    // Any take superseded along with the last request is freed here, outside
+    // the lock.
+    carryOver.reset();
+    notify();
+    return generation;
+}
+
+bool CaptureBufferAllocator::isRequestPending() const noexcept
+{
+    return installedGeneration.load() != requestedGeneration.load();
+}
+
+CaptureBuffer* CaptureBufferAllocator::takePreparedBuffer() noexcept
+{
+    auto* buffer = preparedBuffer.exchange (nullptr);
+
+    if (buffer != nullptr)
+    {
+        installedBuffer = buffer;
+        installedGeneration = buffer->generation;
+    }
+
+    return buffer;
+}
+
+bool CaptureBufferAllocator::canRetireBuffer() const noexcept
+{
+    return retiredFifo.getFreeSpace() > 0;
+}
+
+void CaptureBufferAllocator::retireBuffer (CaptureBuffer* buffer) noexcept
+{
+    if (buffer == nullptr)
+        return;
+
+    auto* expected = buffer;
+    installedBuffer.compare_exchange_strong (expected, nullptr);
+
+    const auto scope = retiredFifo.write (1);
+    jassert (scope.blockSize1 == 1);   // check canRetireBuffer() first!
+
+    if (scope.blockSize1 > 0)
+        retiredBuffers[(size_t) scope.startIndex1] = buffer;
+}
+
+void CaptureBufferAllocator::waitForWorker()
+{
+    const auto pass = ++numPassesRequested;
+    notify();
+
+    while (numPassesCompleted.load() < pass && isThreadRunning())
+        passCompleted.wait (10);
+}
+
+//==============================================================================
+void CaptureBufferAllocator::run()
+{
+    while (! threadShouldExit())
+    {
+        const auto pass = numPassesRequested.load();
+
+        reclaimRetiredBuffers();
+        segmentPool.refill();
+
+        {
+            // Buffers are only freed on this thread, so the installed one
+            // stays valid while it's being read, even if it's retired.
+            const juce::ScopedLock sl (installedBufferLock);
+            auto* installed = installedBuffer.load();
+            takeArchiver.serviceRequests (installed);
+
+            const auto numOtherBytes = installed != nullptr ? installed->getNumBytesUsed() : 0;
+            segmentPool.getAccount().setNumOtherBytes ((juce::int64) numOtherBytes);
+        }
+
+        const auto generation = requestedGeneration.load();
+        const auto needsBuffer = generation != preparedGeneration;
+
+        if (needsBuffer)
+        {
+            CaptureBufferSpec spec;
+            std::unique_ptr<CaptureCarryOver> carryOver;
+
+            {
+                const juce::ScopedLock sl (requestLock);
+                spec = requestedSpec;
+                std::swap (carryOver, requestedCarryOver);
+            }
+
+            auto buffer = createBuffer (spec);
+
+            if (carryOver != nullptr && carryOver->source != nullptr)
+                convertTake (*carryOver, *buffer);
+
+            buffer->generation = generation;
+            preparedGeneration = generation;
+
+            // Anything still sitting in the slot was never seen by the audio
+            // thread, so it can be freed straight away.
+            delete preparedBuffer.exchange (buffer.release());
+        }
+
+        numPassesCompleted = pass;
+        passCompleted.signal();
+
+        if (needsBuffer)
+            continue;
+
+        // Retired buffers and the segment pool are polled rather than
+        // signalled, so the audio thread never has to touch the event.
+        wait (20);
+    }
+}
+
+std::unique_ptr<CaptureBuffer> CaptureBufferAllocator::createBuffer (const CaptureBufferSpec& spec)
+{
+    if (spec.doubleBuffered)
+        return std::make_unique<PingPongCaptureBuffer> (createSingleBuffer (spec), createSingleBuffer (spec));
+
+    return createSingleBuffer (spec);
+}
+
+std::unique_ptr<CaptureBuffer> CaptureBufferAllocator::createSingleBuffer (const CaptureBufferSpec& spec)
+{
+    if (spec.storage == CaptureStorage::disk)
+    {
+        auto disk = std::make_unique<DiskCaptureBuffer> (spec.numChannels, spec.numSamples);
+
+        if (disk->isValid())
+        {
+            segmentPool.setNumReadyWanted (0);
+            return disk;
+        }
+
+        // Couldn't create or map the temporary file, so fall back to RAM.
+        jassertfalse;
+    }
+    else if (spec.format != CaptureFormat::float32 && spec.format != CaptureFormat::float64)
+    {
+        auto compact = std::make_unique<CompactCaptureBuffer> (spec.numChannels, spec.numSamples, spec.format);
+
+        if (compact->isValid())
+        {
+            segmentPool.setNumReadyWanted (0);
+            return compact;
+        }
+
+        // Couldn't reserve the storage, so fall back to segments, which are
+        // only allocated as the take needs them.
+        jassertfalse;
+    }
+
+    // Enough for the segment being recorded plus the one ahead, per channel.
+    // An empty buffer, for an instance with no take running, needs none.
+    segmentPool.setNumReadyWanted (spec.numSamples > 0 ? 2 * spec.numChannels : 0);
+
+    std::unique_ptr<CaptureBuffer> buffer;
+
+    if (spec.format == CaptureFormat::float64)
+        buffer = std::make_unique<MemoryCaptureBuffer<double>> (spec.numChannels, spec.numSamples, segmentPool);
+    else
+        buffer = std::make_unique<MemoryCaptureBuffer<float>> (spec.numChannels, spec.numSamples, segmentPool);
+
+    if (reservesWholeBuffers)
+        buffer->reserveFrames (0, spec.numSamples);
+
+    return buffer;
+}
+
+void CaptureBufferAllocator::convertTake (CaptureCarryOver& carryOver, CaptureBuffer& dest)
+{
+    auto& source = *carryOver.source;
+    const auto oldLength = carryOver.takeLength;
+    const auto newLength = dest.getNumSamples();
+    const auto numChannels = juce::jmin (source.getNumChannels(), dest.getNumChannels());
+    const auto numIn = juce::jlimit (0, juce::jmin (oldLength, source.getNumSamples()), carryOver.numFramesRecorded);
+    const auto numOut = CaptureCarryOver::scale (numIn, oldLength, newLength);
+
+    if (numIn == 0 || numOut == 0 || numChannels == 0)
+        return;
+
+    // A take still recording is finished off first, so all of it can be read.
+    if (! carryOver.isPlaying)
+        source.beginPlayback (numIn);
+
+    // A 64-bit take is converted at full precision.
+    if (source.getBitsPerSample() == 64)
+        convertFrames<double> (source, dest, numChannels, numIn, numOut, oldLength, newLength);
+    else
+        convertFrames<float> (source, dest, numChannels, numIn, numOut, oldLength, newLength);
+
+    if (carryOver.isPlaying)
+        dest.beginPlayback (numOut);
+}
+
+template <typename SampleType>
+void CaptureBufferAllocator::convertFrames (CaptureBuffer& source, CaptureBuffer& dest, int numChannels,
+                                            int numIn, int numOut, int oldLength, int newLength)
+{
+    constexpr int chunkSize = 8192;
+
+    // A take restored at the length it was saved at is just copied across.
+    if (oldLength == newLength)
+    {
+        juce::AudioBuffer<SampleType> copied (numChannels, chunkSize);
+
+        for (int start = 0; start < numIn && ! threadShouldExit(); start += chunkSize)
+        {
+            const auto num = juce::jmin (chunkSize, numIn - start);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                source.readTake (channel, start, copied.getWritePointer (channel), num);
+
+            dest.reserveFrames (start, num);
+            dest.write (copied, start, num);
+            dest.flushWrites();
+        }
+
+        return;
+    }
+
+    // Output frame i reads the old take at i * step, so the whole take maps
+    // onto the whole new one.
+    const auto step = (double) oldLength / newLength;
+    constexpr auto before = SampleInterpolator::numSamplesBefore;
+    constexpr auto after = SampleInterpolator::numSamplesAfter;
+
+    std::vector<SampleType> window ((size_t) (std::ceil (chunkSize * step) + before + after + 2));
+    juce::AudioBuffer<SampleType> converted (numChannels, chunkSize);
+
+    for (int outStart = 0; outStart < numOut && ! threadShouldExit(); outStart += chunkSize)
+    {
+        const auto num = juce::jmin (chunkSize, numOut - outStart);
+        const auto start = outStart * step;
+        const auto first = (int) std::floor (start) - before;
+        const auto last = juce::jmin ((int) std::floor ((outStart + num - 1) * step) + after, first + (int) window.size() - 1);
+
+        // Frames either side of the take read as silence.
+        const auto readStart = juce::jmax (0, first);
+        const auto readEnd = juce::jmin (numIn, last + 1);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            std::fill (window.begin(), window.end(), SampleType (0));
+
+            if (readEnd > readStart)
+                source.readTake (channel, readStart, window.data() + (readStart - first), readEnd - readStart);
+
+            interpolator->process (SampleInterpolator::Quality::windowedSinc, converted.getWritePointer (channel),
+                                   window.data() + before, num, start - std::floor (start), step);
+        }
+
+        // The new buffer's memory comes straight from the arena: the pool's
+        // ready segments are the audio thread's alone, and it may be running.
+        dest.reserveFrames (outStart, num);
+        dest.write (converted, outStart, num);
+        dest.flushWrites();
+    }
+}
+
+void CaptureBufferAllocator::reclaimRetiredBuffers()
+{
+    const auto scope = retiredFifo.read (retiredFifo.getNumReady());
+
+    for (int i = 0; i < scope.blockSize1; ++i)
+        delete retiredBuffers[(size_t) (scope.startIndex1 + i)];
+
+    for (int i = 0; i < scope.blockSize2; ++i)
+        delete retiredBuffers[(size_t) (scope.startIndex2 + i)];
+}
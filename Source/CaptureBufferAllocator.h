@@ -0,0 +1,150 @@
+/*
+  ==============================================================================
+
+    Prepares reverse buffers on a worker thread and hands them to the audio
+    thread without locking or allocating there.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CaptureBuffer.h"
+#include "SampleInterpolator.h"
+#include "TakeArchiver.h"
+
+//==============================================================================
+/**
+    A take handed to the allocator to be resampled into the next buffer it
+    builds, when the sample rate changes part way through.
+*/
+struct CaptureCarryOver
+{
+    std::unique_ptr<CaptureBuffer> source;
+    int takeLength = 0;             // the length of the buffer it was recorded into
+    int numFramesRecorded = 0;      // frames [0, numFramesRecorded) of source hold the take
+    bool isPlaying = false;         // recording had finished and playback begun
+
+    /** Where frame (or count) num of a take oldLength frames long ends up in
+        one newLength frames long. A whole take stays whole.
+    */
+    static int scale (int num, int oldLength, int newLength) noexcept
+    {
+        if (num >= oldLength || oldLength <= 0)
+            return newLength;
+
+        return juce::jmin (newLength, juce::roundToInt ((double) num * newLength / oldLength));
+    }
+};
+
+//==============================================================================
+/**
+    Owns a background thread that allocates and clears new CaptureBuffers.
+
+    The message thread asks for a buffer with requestBuffer(). Once the worker
+    has built it, the audio thread picks it up with takePreparedBuffer() (an
+    atomic pointer exchange) and hands the buffer it was using back through
+    retireBuffer(), so that the worker can free it later. Neither allocation
+    nor deallocation ever happens on the audio thread. The same worker keeps
+    the segment pool used by in-memory buffers topped up, converts takes
+    carried over from the previous buffer, serves the TakeArchiver's reads
+    of the installed buffer's take, and reports the memory held outside the
+    pool to the CaptureMemoryArena.
+*/
+class CaptureBufferAllocator  : private juce::Thread
+{
+public:
+    CaptureBufferAllocator();
+    ~CaptureBufferAllocator() override;
+
+    /** Message thread: asks for a cleared buffer of the given size. If an
+        earlier request hasn't been picked up yet, it is superseded.
+
+        If a take is passed in, it is resampled to fit the new buffer's length
+        (see CaptureCarryOver::scale()) and written into it before the buffer
+        is handed over, so the buffer arrives part way through that take.
+        Returns the generation the new buffer will carry.
+    */
+    uint32_t requestBuffer (const CaptureBufferSpec& spec, std::unique_ptr<CaptureCarryOver> carryOver = {});
+
+    /** True between a call to requestBuffer() and the audio thread taking the
+        buffer it produced.
+    */
+    bool isRequestPending() const noexcept;
+
+    /** Audio thread: returns the most recently prepared buffer, or nullptr if
+        there is nothing new. The caller takes ownership and must pass the
+        buffer it replaces to retireBuffer().
+    */
+    CaptureBuffer* takePreparedBuffer() noexcept;
+
+    /** Audio thread: true if retireBuffer() has room for another buffer. */
+    bool canRetireBuffer() const noexcept;
+
+    /** Audio thread: queues a buffer to be deleted on the worker thread. */
+    void retireBuffer (CaptureBuffer* buffer) noexcept;
+
+    /** Non-realtime only: nudges the worker and blocks until it has been
+        round its loop once more, so any requested buffer is built and the
+        segment pool is topped up. Offline rendering uses this to run faster
+        than real time without dropping samples.
+    */
+    void waitForWorker();
+
+    /** For the headless tools: makes in-memory buffers take every segment
+        they'll need as they're built, rather than as the take records, so
+        processBlock never waits for the pool to be topped up. It costs the
+        whole buffer's memory up front. Applies to buffers requested from
+        then on.
+    */
+    void setReservesWholeBuffers (bool shouldReserve) noexcept     { reservesWholeBuffers = shouldReserve; }
+
+    /** The pool that in-memory buffers draw their segments from. The worker
+        keeps it topped up.
+    */
+    CaptureSegmentPool& getSegmentPool() noexcept               { return segmentPool; }
+    const CaptureSegmentPool& getSegmentPool() const noexcept   { return segmentPool; }
+
+    /** Reads the installed buffer's take, for saving sessions and exporting. */
+    TakeArchiver& getTakeArchiver() noexcept        { return takeArchiver; }
+
+private:
+    void run() override;
+    void reclaimRetiredBuffers();
+
+    std::unique_ptr<CaptureBuffer> createBuffer (const CaptureBufferSpec& spec);
+    std::unique_ptr<CaptureBuffer> createSingleBuffer (const CaptureBufferSpec& spec);
+    void convertTake (CaptureCarryOver& carryOver, CaptureBuffer& dest);
+
+    template <typename SampleType>
+    void convertFrames (CaptureBuffer& source, CaptureBuffer& dest, int numChannels, int numIn, int numOut, int oldLength, int newLength);
+
+    CaptureSegmentPool segmentPool;
+    juce::SharedResourcePointer<SampleInterpolator> interpolator;
+
+    juce::CriticalSection requestLock;
+    CaptureBufferSpec requestedSpec;
+    std::unique_ptr<CaptureCarryOver> requestedCarryOver;
+    std::atomic<uint32_t> requestedGeneration { 0 }, installedGeneration { 0 };
+    uint32_t preparedGeneration = 0;
+
+    std::atomic<CaptureBuffer*> preparedBuffer { nullptr };
+
+    // The buffer the audio thread is using, for the archiver to read. The
+    // lock is held by the worker while it reads, and by requestBuffer() while
+    // it takes back a buffer being carried over.
+    std::atomic<CaptureBuffer*> installedBuffer { nullptr };
+    juce::CriticalSection installedBufferLock;
+    TakeArchiver takeArchiver { *this };
+
+    std::atomic<bool> reservesWholeBuffers { false };
+    std::atomic<uint32_t> numPassesRequested { 0 }, numPassesCompleted { 0 };
+    juce::WaitableEvent passCompleted;
+
+    static constexpr int retiredCapacity = 16;
+    juce::AbstractFifo retiredFifo { retiredCapacity };
+    std::array<CaptureBuffer*, retiredCapacity> retiredBuffers {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CaptureBufferAllocator)
+};
@@ -0,0 +1,175 @@
+/*
+  ==============================================================================
+
+    The capture memory shared by every ReversaTron instance in the process.
+
+  ==============================================================================
+*/
+
+#include "CaptureMemoryArena.h"
+
+namespace
+{
+    const char* const budgetKey = "memoryBudgetMB";
+
+    juce::PropertiesFile::Options getSettingsOptions()
+    {
+        juce::PropertiesFile::Options options;
+        options.applicationName = "ReversaTron";
+        options.filenameSuffix = ".settings";
+        options.folderName = "ReversaTron";
+        options.osxLibrarySubFolder = "Application Support";
+        return options;
+    }
+}
+
+//==============================================================================
+CaptureMemoryArena::CaptureMemoryArena()
+    : settings (std::make_unique<juce::PropertiesFile> (getSettingsOptions()))
+{
+    spares.reserve ((size_t) maxSpareSegments);
+    budget = juce::jmax ((juce::int64) 0, (juce::int64) settings->getIntValue (budgetKey, 0)) << 20;
+}
+
+CaptureMemoryArena::~CaptureMemoryArena()
+{
+    // Every account holds a reference, so they're all gone by now.
+    jassert (numAccounts.load() == 0);
+    trimSpares (0);
+}
+
+void CaptureMemoryArena::setBudget (juce::int64 numBytes)
+{
+    budget = juce::jmax ((juce::int64) 0, numBytes);
+
+    // Spares are the first thing to go if the budget has come down.
+    if (budget.load() != unlimited && numBytesHeld.load() > budget.load())
+        trimSpares (0);
+
+    settings->setValue (budgetKey, (int) (budget.load() >> 20));
+    settings->saveIfNeeded();
+}
+
+juce::int64 CaptureMemoryArena::getBudget() const noexcept
+{
+    return budget.load();
+}
+
+CaptureMemoryArena::Usage CaptureMemoryArena::getUsage() const noexcept
+{
+    Usage usage;
+    usage.numBytes = numBytesHeld.load();
+    usage.budget = budget.load();
+    usage.numAccounts = numAccounts.load();
+    usage.numRefused = numRefused.load();
+    return usage;
+}
+
+bool CaptureMemoryArena::reserve (juce::int64 numBytes, bool ignoreBudget) noexcept
+{
+    auto held = numBytesHeld.load();
+
+    do
+    {
+        const auto limit = budget.load();
+
+        if (! ignoreBudget && limit != unlimited && held + numBytes > limit)
+        {
+            ++numRefused;
+            return false;
+        }
+    }
+    while (! numBytesHeld.compare_exchange_weak (held, held + numBytes));
+
+    return true;
+}
+
+void CaptureMemoryArena::trimSpares (int numToKeep)
+{
+    const juce::ScopedLock sl (spareLock);
+
+    while ((int) spares.size() > numToKeep)
+    {
+        delete[] spares.back();
+        spares.pop_back();
+        numBytesHeld -= (juce::int64) spareSize;
+    }
+}
+
+//==============================================================================
+CaptureMemoryArena::Account::Account()
+{
+    ++arena->numAccounts;
+}
+
+CaptureMemoryArena::Account::~Account()
+{
+    // Anything still reported goes with the instance.
+    setNumOtherBytes (0);
+    jassert (numSegmentBytes.load() == 0);
+    --arena->numAccounts;
+}
+
+float* CaptureMemoryArena::Account::allocateSegment (size_t numBytes)
+{
+    // A spare is already counted, and already cleared.
+    {
+        const juce::ScopedLock sl (arena->spareLock);
+
+        if (! arena->spares.empty() && arena->spareSize == numBytes)
+        {
+            auto* segment = arena->spares.back();
+            arena->spares.pop_back();
+            numSegmentBytes += (juce::int64) numBytes;
+            return segment;
+        }
+    }
+
+    if (! arena->reserve ((juce::int64) numBytes, ignoresBudget.load()))
+        return nullptr;
+
+    // Clearing here is what touches the pages, so it has to happen on the
+    // worker rather than when the audio thread first writes.
+    auto* segment = new float[numBytes / sizeof (float)];
+    juce::FloatVectorOperations::clear (segment, (int) (numBytes / sizeof (float)));
+    numSegmentBytes += (juce::int64) numBytes;
+    return segment;
+}
+
+void CaptureMemoryArena::Account::freeSegment (float* segment, size_t numBytes) noexcept
+{
+    if (segment == nullptr)
+        return;
+
+    numSegmentBytes -= (juce::int64) numBytes;
+
+    {
+        const juce::ScopedLock sl (arena->spareLock);
+
+        // Kept (still counted) for whichever instance needs one next,
+        // unless that would go over the budget.
+        const auto limit = arena->budget.load();
+
+        if ((int) arena->spares.size() < maxSpareSegments && (arena->spares.empty() || arena->spareSize == numBytes)
+            && (limit == unlimited || arena->numBytesHeld.load() <= limit))
+        {
+            juce::FloatVectorOperations::clear (segment, (int) (numBytes / sizeof (float)));
+            arena->spareSize = numBytes;
+            arena->spares.push_back (segment);
+            return;
+        }
+    }
+
+    delete[] segment;
+    arena->numBytesHeld -= (juce::int64) numBytes;
+}
+
+void CaptureMemoryArena::Account::setNumOtherBytes (juce::int64 numBytes) noexcept
+{
+    arena->numBytesHeld += numBytes - numOtherBytes.exchange (numBytes);
+}
+
+juce::int64 CaptureMemoryArena::Account::getNumBytes() const noexcept
+{
+    return numSegmentBytes.load() + numOtherBytes.load();
+}
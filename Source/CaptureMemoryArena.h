@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    The capture memory shared by every ReversaTron instance in the process.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Keeps track of the capture memory held by every instance, and enforces a
+    budget across all of them.
+
+    One arena is shared by the whole process (see SharedResourcePointer).
+    Each instance draws on it through an Account, which its segment pool uses
+    to allocate and free segments on the allocator's worker thread. A segment
+    is only allocated if the total, over every instance, stays within the
+    budget; otherwise the pool stays short and the audio thread drops samples
+    as it does whenever the pool runs dry. Freed segments are kept as a few
+    cleared spares that any instance can pick up, and the rest go back to the
+    system.
+
+    Memory held some other way (compact formats, the disk rings) is
+    reported by each account's worker, and counts towards the total so that
+    segments give way to it, but isn't cut off. The budget is a user setting
+    rather than part of any one session, so it's kept in a settings file
+    shared by every instance. The headless tools exempt their accounts from
+    it (see Account::setIgnoresBudget()), so that a budget set for the plugin
+    never makes an offline render drop samples.
+*/
+class CaptureMemoryArena
+{
+public:
+    CaptureMemoryArena();
+    ~CaptureMemoryArena();
+
+    /** A budget of 0 means no limit. */
+    static constexpr juce::int64 unlimited = 0;
+
+    /** Any thread but the audio thread: sets the budget for every instance,
+        and saves it for the next time the plugin loads.
+    */
+    void setBudget (juce::int64 numBytes);
+    juce::int64 getBudget() const noexcept;
+
+    /** Memory use across every instance. */
+    struct Usage
+    {
+        juce::int64 numBytes = 0;       // including spare segments
+        juce::int64 budget = unlimited;
+        int numAccounts = 0;
+        int numRefused = 0;             // segments not allocated because of the budget
+    };
+
+    Usage getUsage() const noexcept;
+
+    class Account;      // one instance's share, see below
+
+private:
+    bool reserve (juce::int64 numBytes, bool ignoreBudget) noexcept;
+    void trimSpares (int numToKeep);
+
+    static constexpr int maxSpareSegments = 16;
+
+    std::atomic<juce::int64> budget { unlimited }, numBytesHeld { 0 };
+    std::atomic<int> numAccounts { 0 }, numRefused { 0 };
+
+    juce::CriticalSection spareLock;
+    std::vector<float*> spares;
+    size_t spareSize = 0;
+
+    std::unique_ptr<juce::PropertiesFile> settings;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CaptureMemoryArena)
+};
+
+//==============================================================================
+/** One instance's share of the arena. */
+class CaptureMemoryArena::Account
+{
+public:
+    Account();
+    ~Account();
+
+    /** Worker thread: returns a cleared segment of numBytes bytes, or
+        nullptr if the budget doesn't allow it.
+    */
+    float* allocateSegment (size_t numBytes);
+
+    /** Any thread but the audio thread: gives back a segment from
+        allocateSegment().
+    */
+    void freeSegment (float* segment, size_t numBytes) noexcept;
+
+    /** Worker thread: the memory the instance holds outside its segments. */
+    void setNumOtherBytes (juce::int64 numBytes) noexcept;
+
+    /** Everything the instance holds, segments included. */
+    juce::int64 getNumBytes() const noexcept;
+
+    /** Lets this account allocate whatever the budget says, while still
+        counting towards the total. Unlike the budget, this isn't saved.
+    */
+    void setIgnoresBudget (bool shouldIgnore) noexcept  { ignoresBudget = shouldIgnore; }
+
+    CaptureMemoryArena& getArena() const noexcept   { return *arena; }
+
+private:
+    juce::SharedResourcePointer<CaptureMemoryArena> arena;
+    std::atomic<juce::int64> numSegmentBytes { 0 }, numOtherBytes { 0 };
+    std::atomic<bool> ignoresBudget { false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Account)
+};
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    A pool of pre-faulted memory segments for the in-memory reverse buffer.
+
+  ==============================================================================
+*/
+
+#include "CaptureSegmentPool.h"
+
+//==============================================================================
+CaptureSegmentPool::CaptureSegmentPool() = default;
+
+CaptureSegmentPool::~CaptureSegmentPool()
+{
+    readyFifo.read (readyFifo.getNumReady()).forEach ([this] (int index) { freeSegment (ready[(size_t) index]); });
+    returnedFifo.read (returnedFifo.getNumReady()).forEach ([this] (int index) { freeSegment (returned[(size_t) index]); });
+}
+
+float* CaptureSegmentPool::take() noexcept
+{
+    float* segment = nullptr;
+    readyFifo.read (1).forEach ([&] (int index) { segment = ready[(size_t) index]; });
+    return segment;
+}
+
+bool CaptureSegmentPool::give (float* segment) noexcept
+{
+    if (returnedFifo.getFreeSpace() == 0)
+        return false;
+
+    returnedFifo.write (1).forEach ([&] (int index) { returned[(size_t) index] = segment; });
+    return true;
+}
+
+void CaptureSegmentPool::trim() noexcept
+{
+    const auto wanted = numReadyWanted.load();
+
+    while (readyFifo.getNumReady() > wanted && returnedFifo.getFreeSpace() > 0)
+        give (take());
+}
+
+bool CaptureSegmentPool::needsRefill() const noexcept
+{
+    return readyFifo.getNumReady() < numReadyWanted.load();
+}
+
+void CaptureSegmentPool::setNumReadyWanted (int numWanted) noexcept
+{
+    numReadyWanted = juce::jlimit (0, capacity - 1, numWanted);
+}
+
+void CaptureSegmentPool::refill()
+{
+    // Returned segments are cleared and reused if there's room, otherwise
+    // they're freed, so an idle pool shrinks back to its ready count.
+    const auto wanted = numReadyWanted.load();
+
+    returnedFifo.read (returnedFifo.getNumReady()).forEach ([&] (int index)
+    {
+        auto* segment = returned[(size_t) index];
+
+        if (readyFifo.getNumReady() < wanted)
+        {
+            juce::FloatVectorOperations::clear (segment, segmentSize);
+            readyFifo.write (1).forEach ([&] (int readyIndex) { ready[(size_t) readyIndex] = segment; });
+        }
+        else
+        {
+            freeSegment (segment);
+        }
+    });
+
+    // Stops short if the arena's budget has run out.
+    const auto numToAdd = wanted - readyFifo.getNumReady();
+
+    for (int i = 0; i < numToAdd; ++i)
+    {
+        auto* segment = allocateSegment();
+
+        if (segment == nullptr)
+            break;
+
+        readyFifo.write (1).forEach ([&] (int index) { ready[(size_t) index] = segment; });
+    }
+}
+
+float* CaptureSegmentPool::allocateSegment()
+{
+    return account.allocateSegment (segmentBytes);
+}
+
+void CaptureSegmentPool::freeSegment (float* segment) noexcept
+{
+    account.freeSegment (segment, segmentBytes);
+}
@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    A pool of pre-faulted memory segments for the in-memory reverse buffer.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CaptureMemoryArena.h"
+
+//==============================================================================
+/**
+    Hands out fixed-size, already cleared blocks of samples to the audio thread
+    and takes them back again, without locking or allocating on that side.
+
+    A worker thread calls refill() periodically to keep a few segments ready
+    (their pages already touched, so the audio thread never page-faults on
+    them) and to recycle or free whatever has been given back. The ready and
+    returned queues are single-producer, single-consumer, so the audio thread
+    is the only one that takes or gives, and the worker the only one that
+    refills. Segments come from, and go back to, the process-wide
+    CaptureMemoryArena, so a pool stays short rather than going over the
+    arena's budget. Until it's asked for any, a pool holds none at all.
+*/
+class CaptureSegmentPool
+{
+public:
+    CaptureSegmentPool();
+    ~CaptureSegmentPool();
+
+    /** Frames per channel in one segment. */
+    static constexpr int segmentSize = 1 << 15;
+    static constexpr int segmentShift = 15;
+
+    /** Audio thread: returns a cleared segment, or nullptr if none are ready. */
+    float* take() noexcept;
+
+    /** Audio thread: hands a segment back. Returns false if the return queue
+        is full, in which case the caller keeps it and tries again later.
+    */
+    bool give (float* segment) noexcept;
+
+    /** Audio thread: hands back any ready segments beyond the number wanted,
+        so that an idle pool can shrink to nothing.
+    */
+    void trim() noexcept;
+
+    /** True if fewer segments are ready than were asked for. */
+    bool needsRefill() const noexcept;
+
+    /** Worker thread: sets how many segments to keep ready. */
+    void setNumReadyWanted (int numWanted) noexcept;
+
+    /** Worker thread: tops up the ready segments and recycles returned ones. */
+    void refill();
+
+    /** Worker thread: a cleared segment straight from the arena, for a buffer
+        that isn't in use yet. Unlike take(), this leaves the ready segments
+        alone, as only the audio thread may read those. Returns nullptr if
+        the budget has run out.
+    */
+    float* allocateSegment();
+
+    /** Any thread but the audio thread: frees a segment that isn't going
+        back to the pool.
+    */
+    void freeSegment (float* segment) noexcept;
+
+    /** This instance's share of the arena the segments come from. */
+    CaptureMemoryArena::Account& getAccount() noexcept               { return account; }
+    const CaptureMemoryArena::Account& getAccount() const noexcept   { return account; }
+
+private:
+    static constexpr size_t segmentBytes = sizeof (float) * (size_t) segmentSize;
+    static constexpr int capacity = 512;
+
+    CaptureMemoryArena::Account account;
+
+    juce::AbstractFifo readyFifo { capacity }, returnedFifo { capacity };
+    std::array<float*, capacity> ready {}, returned {};
+    std::atomic<int> numReadyWanted { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CaptureSegmentPool)
+};
@@ -0,0 +1,204 @@
+/*
+  ==============================================================================
+
+    A small pool of threads that processBlock uses to spread per-channel
+    work across cores.
+
+  ==============================================================================
+*/
+
+#include "ChannelWorkerPool.h"
+
+#if JUCE_WINDOWS
+ #include <windows.h>
+#elif JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#else
+ #include <cerrno>
+ #include <semaphore.h>
+#endif
+
+namespace
+{
+    inline uint32_t getJob (uint64_t claim) noexcept            { return static_cast<uint32_t> (claim >> 32); }
+    inline int getNumChannels (uint64_t claim) noexcept         { return static_cast<int> ((claim >> 16) & 0xffff); }
+    inline int getNextChannel (uint64_t claim) noexcept         { return static_cast<int> (claim & 0xffff); }
+}
+
+//==============================================================================
+/** A counting semaphore that the audio thread can post to without taking a
+    lock. JUCE's WaitableEvent signals through a mutex and condition
+    variable, so each platform's own semaphore is used instead.
+*/
+class WakeUpSemaphore
+{
+public:
+   #if JUCE_WINDOWS
+    WakeUpSemaphore()                 : handle (CreateSemaphoreW (nullptr, 0, 0x7fffffff, nullptr)) {}
+    ~WakeUpSemaphore()                { CloseHandle (handle); }
+    void post() noexcept              { ReleaseSemaphore (handle, 1, nullptr); }
+    void wait() noexcept              { WaitForSingleObject (handle, INFINITE); }
+
+   private:
+    HANDLE handle;
+   #elif JUCE_MAC || JUCE_IOS
+    WakeUpSemaphore()                 : semaphore (dispatch_semaphore_create (0)) {}
+    ~WakeUpSemaphore()                { dispatch_release (semaphore); }
+    void post() noexcept              { dispatch_semaphore_signal (semaphore); }
+    void wait() noexcept              { dispatch_semaphore_wait (semaphore, DISPATCH_TIME_FOREVER); }
+
+   private:
+    dispatch_semaphore_t semaphore;
+   #else
+    WakeUpSemaphore()                 { sem_init (&semaphore, 0, 0); }
+    ~WakeUpSemaphore()                { sem_destroy (&semaphore); }
+    void post() noexcept              { sem_post (&semaphore); }
+
+    void wait() noexcept
+    {
+        while (sem_wait (&semaphore) != 0 && errno == EINTR)
+        {
+        }
+    }
+
+   private:
+    sem_t semaphore;
+   #endif
+
+    JUCE_DECLARE_NON_COPYABLE (WakeUpSemaphore)
+};
+
+//==============================================================================
+struct ChannelWorkerPool::Worker  : public juce::Thread
+{
+    Worker (ChannelWorkerPool& p, int index)
+        : juce::Thread ("ReversaTron channel worker " + juce::String (index)),
+          pool (p), workerIndex (index)
+    {
+    }
+
+    void run() override    { pool.workerLoop (*this); }
+
+    ChannelWorkerPool& pool;
+    const int workerIndex;
+    WakeUpSemaphore wakeUp;
+
+    // Set by the worker as it goes to sleep, and cleared by whichever thread
+    // takes on posting the wake-up, so each sleep gets exactly one post.
+    std::atomic<bool> sleeping { false };
+};
+
+//==============================================================================
+ChannelWorkerPool::ChannelWorkerPool (int numWorkers, double rate, int size)
+    : sampleRate (rate), blockSize (size)
+{
+    // Each worker carries part of the audio thread's block, so it gets the
+    // same deadline.
+    const auto options = juce::Thread::RealtimeOptions{}.withApproximateAudioProcessingTime (blockSize, sampleRate);
+
+    for (int i = 1; i <= numWorkers; ++i)
+        workers.add (new Worker (*this, i))->startRealtimeThread (options);
+}
+
+ChannelWorkerPool::~ChannelWorkerPool()
+{
+    for (auto* worker : workers)
+        worker->signalThreadShouldExit();
+
+    // A worker that's awake sees the exit flag before it sleeps again, so
+    // a spare post is harmless.
+    for (auto* worker : workers)
+    {
+        worker->sleeping = false;
+        worker->wakeUp.post();
+        worker->stopThread (1000);
+    }
+}
+
+//==============================================================================
+double ChannelWorkerPool::runJob (int numChannels, JobFunction function, void* context) noexcept
+{
+    jassert (numChannels <= maxChannels);
+
+    if (numChannels <= 0)
+        return 0.0;
+
+    jobFunction = function;
+    jobContext = context;
+    numChannelsDone = 0;
+
+    const auto job = ++lastJob;
+    claim = (static_cast<uint64_t> (job) << 32) | (static_cast<uint64_t> (numChannels) << 16);
+
+    // Publishing the job and then checking sleeping (and the reverse order
+    // in workerLoop) means a worker either sees the job or gets woken.
+    for (auto* worker : workers)
+        if (worker->sleeping.load() && worker->sleeping.exchange (false))
+            worker->wakeUp.post();
+
+    processChannels (job, 0);
+
+    if (numChannelsDone.load() >= numChannels)
+        return 0.0;
+
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+
+    while (numChannelsDone.load() < numChannels)
+        juce::Thread::yield();
+
+    return juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+}
+
+void ChannelWorkerPool::processChannels (uint32_t job, int workerIndex) noexcept
+{
+    auto current = claim.load();
+
+    while (getJob (current) == job && getNextChannel (current) < getNumChannels (current))
+    {
+        if (claim.compare_exchange_weak (current, current + 1))
+        {
+            // The job can't finish until this channel is done, so its
+            // function and context stay valid until then.
+            jobFunction (jobContext, getNextChannel (current), workerIndex);
+            ++numChannelsDone;
+            current = claim.load();
+        }
+    }
+}
+
+void ChannelWorkerPool::workerLoop (Worker& worker)
+{
+    // Short spans can arrive several times per block, so spin a little before
+    // going to sleep.
+    constexpr int numSpins = 64;
+    uint32_t seenJob = getJob (claim.load());
+
+    while (! worker.threadShouldExit())
+    {
+        auto job = getJob (claim.load());
+
+        for (int i = 0; job == seenJob && i < numSpins; ++i)
+        {
+            juce::Thread::yield();
+            job = getJob (claim.load());
+        }
+
+        if (job == seenJob)
+        {
+            worker.sleeping = true;
+
+            // If a job or the exit flag turned up meanwhile, take the flag
+            // back; if the audio thread got to it first, its post is on the
+            // way and has to be used up.
+            if (getJob (claim.load()) == seenJob && ! worker.threadShouldExit())
+                worker.wakeUp.wait();
+            else if (! worker.sleeping.exchange (false))
+                worker.wakeUp.wait();
+
+            continue;
+        }
+
+        seenJob = job;
+        processChannels (job, worker.workerIndex);
+    }
+}
@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    A small pool of threads that processBlock uses to spread per-channel
+    work across cores.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Runs a job once per channel, spread across a fixed set of worker threads
+    and the calling (audio) thread.
+
+    The audio thread publishes a job by storing a single atomic word that
+    holds the job number, the channel count and the next unclaimed channel.
+    Every thread then claims channels with a compare-and-swap until none are
+    left, and the audio thread waits for the last of them to finish.
+
+    Nothing is allocated or locked on the audio thread. The workers run at
+    real-time priority, sized for the block they serve, and spin briefly
+    before sleeping on a platform semaphore; waking one is a single post,
+    which never blocks. The audio thread still has to wait for channels a
+    worker has claimed, so run() returns how long it waited, and the
+    processor passes that on to its DspLoadMonitor.
+*/
+class ChannelWorkerPool
+{
+public:
+    /** Starts numWorkers threads, in addition to the thread that calls run(),
+        with real-time priority for blocks of blockSize samples at sampleRate.
+    */
+    ChannelWorkerPool (int numWorkers, double sampleRate, int blockSize);
+    ~ChannelWorkerPool();
+
+    int getNumWorkers() const noexcept    { return workers.size(); }
+
+    /** True if this pool was started for the given block timing. */
+    bool isPreparedFor (double rate, int size) const noexcept     { return rate == sampleRate && size == blockSize; }
+
+    /** Audio thread: calls job (channel, workerIndex) for every channel in
+        [0, numChannels), and returns once they have all finished. The calling
+        thread is worker 0, so workerIndex runs from 0 to getNumWorkers().
+
+        Returns the number of seconds the calling thread spent waiting for
+        the workers to finish their channels after it ran out of its own,
+        which is 0 if it never had to.
+    */
+    template <typename Job>
+    double run (int numChannels, Job& job) noexcept
+    {
+        return runJob (numChannels, [] (void* context, int channel, int workerIndex)
+                {
+                    (*static_cast<Job*> (context)) (channel, workerIndex);
+                }, &job);
+    }
+
+    static constexpr int maxChannels = 0xffff;
+
+private:
+    struct Worker;
+    using JobFunction = void (*) (void* context, int channel, int workerIndex);
+
+    double runJob (int numChannels, JobFunction, void* context) noexcept;
+    void processChannels (uint32_t job, int workerIndex) noexcept;
+    void workerLoop (Worker&);
+
+    // Job number (32 bits) | number of channels (16 bits) | next channel (16 bits)
+    std::atomic<uint64_t> claim { 0 };
+    std::atomic<int> numChannelsDone { 0 };
+    uint32_t lastJob = 0;
+
+    const double sampleRate;
+    const int blockSize;
+
+    JobFunction jobFunction = nullptr;
+    void* jobContext = nullptr;
+
+    juce::OwnedArray<Worker> workers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChannelWorkerPool)
+};
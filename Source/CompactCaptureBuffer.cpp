@@ -0,0 +1,392 @@
+/*
+  ==============================================================================
+
+    A reverse buffer that keeps the take in a compact fixed-point encoding.
+
+  ==============================================================================
+*/
+
+#include "CompactCaptureBuffer.h"
+#include "ReversatronKernels.h"
+
+namespace
+{
+    int getBytesPerSample (CaptureFormat format) noexcept
+    {
+        switch (format)
+        {
+            case CaptureFormat::int16:  return 2;
+            case CaptureFormat::int24:  return 3;
+            default:                    return 0;
+        }
+    }
+
+    inline uint32_t zigZag (int32_t v) noexcept     { return (static_cast<uint32_t> (v) << 1) ^ static_cast<uint32_t> (v >> 31); }
+    inline int32_t unZigZag (uint32_t v) noexcept   { return static_cast<int32_t> (v >> 1) ^ -static_cast<int32_t> (v & 1); }
+}
+
+//==============================================================================
+CompactCaptureBuffer::CompactCaptureBuffer (int numChannelsToUse, int numSamplesToUse, CaptureFormat formatToUse)
+    : CaptureBuffer (numChannelsToUse, numSamplesToUse),
+      format (formatToUse),
+      bytesPerSample (getBytesPerSample (formatToUse)),
+      channels ((size_t) numChannelsToUse)
+{
+    jassert (format == CaptureFormat::int16 || format == CaptureFormat::int24 || format == CaptureFormat::lossless24);
+
+    const auto numBlocks = (numSamples + losslessBlockSize - 1) / losslessBlockSize;
+
+    for (auto& c : channels)
+    {
+        // Deliberately not cleared: pages are only committed once written.
+        if (format == CaptureFormat::lossless24)
+        {
+            c.data.malloc ((size_t) numBlocks * (size_t) maxEncodedBlockBytes);
+            c.blockOffsets.calloc ((size_t) numBlocks + 1);
+        }
+        else
+        {
+            c.data.malloc ((size_t) numSamples * (size_t) bytesPerSample);
+        }
+    }
+}
+
+bool CompactCaptureBuffer::isValid() const noexcept
+{
+    for (auto& c : channels)
+        if (c.data == nullptr || (format == CaptureFormat::lossless24 && c.blockOffsets == nullptr))
+            return false;
+
+    return true;
+}
+
+size_t CompactCaptureBuffer::getNumBytesUsed() const noexcept
+{
+    return numBytesUsed.load (std::memory_order_relaxed);
+}
+
+void CompactCaptureBuffer::updateNumBytesUsed (int numFramesWritten) noexcept
+{
+    size_t total = 0;
+
+    for (auto& c : channels)
+        total += format == CaptureFormat::lossless24 ? (size_t) c.numBytesEncoded
+                                                     : (size_t) numFramesWritten * (size_t) bytesPerSample;
+
+    if (total > numBytesUsed.load (std::memory_order_relaxed))
+        numBytesUsed.store (total, std::memory_order_relaxed);
+}
+
+int CompactCaptureBuffer::getBlockLength (int block) const noexcept
+{
+    return juce::jmin (losslessBlockSize, numSamples - block * losslessBlockSize);
+}
+
+int CompactCaptureBuffer::getBitsPerSample() const noexcept
+{
+    return format == CaptureFormat::int16 ? 16 : 24;
+}
+
+//==============================================================================
+void CompactCaptureBuffer::writeChannel (int channel, const float* source, int startFrame, int numToWrite) noexcept
+{
+    auto& c = channels[(size_t) channel];
+
+    switch (format)
+    {
+        case CaptureFormat::int16:
+            ReversatronKernels::encodeInt16 (reinterpret_cast<int16_t*> (c.data.get()) + startFrame, source, numToWrite);
+            break;
+
+        case CaptureFormat::int24:
+            ReversatronKernels::encodeInt24 (c.data + 3 * (size_t) startFrame, source, numToWrite);
+            break;
+
+        case CaptureFormat::lossless24:
+            writeLossless (c, source, startFrame, numToWrite);
+            break;
+
+        default:
+            break;
+    }
+}
+
+void CompactCaptureBuffer::endWrite (int startFrame, int numToWrite) noexcept
+{
+    updateNumBytesUsed (startFrame + numToWrite);
+}
+
+void CompactCaptureBuffer::beginPlayback (int numFramesRecorded) noexcept
+{
+    // A take that filled the buffer has had its last, short block encoded
+    // already.
+    if (format != CaptureFormat::lossless24 || numFramesRecorded % losslessBlockSize == 0 || numFramesRecorded >= numSamples)
+        return;
+
+    // A take cut short leaves a partly staged block. Pad it with silence and
+    // encode it, so the frames before the cut can be decoded.
+    const auto block = numFramesRecorded / losslessBlockSize;
+    const auto blockLength = getBlockLength (block);
+
+    for (auto& c : channels)
+    {
+        std::fill (c.staging.begin() + c.numStaged, c.staging.begin() + blockLength, 0);
+
+        const auto offset = c.blockOffsets[block];
+        c.blockOffsets[block + 1] = offset + (uint32_t) encodeBlock (c.data + offset, c.staging.data(), blockLength);
+        c.numBytesEncoded = c.blockOffsets[block + 1];
+        c.numStaged = 0;
+        c.decodedBlock = -1;
+    }
+}
+
+void CompactCaptureBuffer::readReversed (int channel, int position, float* dest, int num) noexcept
+{
+    auto& c = channels[(size_t) channel];
+    const auto firstFrame = numSamples - position - num;
+
+    switch (format)
+    {
+        case CaptureFormat::int16:
+            ReversatronKernels::reverseDecodeInt16 (dest, reinterpret_cast<const int16_t*> (c.data.get()) + firstFrame, num);
+            break;
+
+        case CaptureFormat::int24:
+            ReversatronKernels::reverseDecodeInt24 (dest, c.data + 3 * (size_t) firstFrame, num);
+            break;
+
+        case CaptureFormat::lossless24:
+            readLossless (c, firstFrame, dest, num);
+            break;
+
+        default:
+            juce::FloatVectorOperations::clear (dest, num);
+            break;
+    }
+}
+
+void CompactCaptureBuffer::readTake (int channel, int startFrame, float* dest, int num)
+{
+    if (format != CaptureFormat::lossless24)
+    {
+        CaptureBuffer::readTake (channel, startFrame, dest, num);
+        return;
+    }
+
+    // Decoded into a block of its own rather than the playback cache, so
+    // that finished blocks can be read while the audio thread uses the take.
+    auto& c = channels[(size_t) channel];
+    std::array<float, losslessBlockSize> decoded;
+
+    for (int done = 0; done < num;)
+    {
+        const auto frame = startFrame + done;
+        const auto block = frame / losslessBlockSize;
+        const auto offset = frame - block * losslessBlockSize;
+        const auto n = juce::jmin (getBlockLength (block) - offset, num - done);
+
+        decodeBlock (decoded.data(), c.data + c.blockOffsets[block], getBlockLength (block));
+        std::copy (decoded.begin() + offset, decoded.begin() + offset + n, dest + done);
+        done += n;
+    }
+}
+
+//==============================================================================
+void CompactCaptureBuffer::writeEncodedTake (juce::OutputStream& stream, int numFrames) const
+{
+    jassert (format == CaptureFormat::lossless24);
+
+    const auto numBlocks = (juce::jmin (numFrames, numSamples) + losslessBlockSize - 1) / losslessBlockSize;
+
+    for (auto& c : channels)
+    {
+        const auto numBytes = c.blockOffsets[numBlocks];
+        stream.writeInt ((int) numBytes);
+        stream.write (c.data, numBytes);
+    }
+}
+
+bool CompactCaptureBuffer::readEncodedTake (juce::InputStream& stream, int numFrames)
+{
+    jassert (format == CaptureFormat::lossless24);
+
+    if (numFrames < 0 || numFrames > numSamples)
+        return false;
+
+    const auto numBlocks = (numFrames + losslessBlockSize - 1) / losslessBlockSize;
+    const auto maxNumBytes = (juce::int64) numBlocks * (juce::int64) maxEncodedBlockBytes;
+
+    for (auto& c : channels)
+    {
+        const auto numBytes = stream.readInt();
+
+        if (numBytes < 0 || (juce::int64) numBytes > maxNumBytes
+            || stream.read (c.data, numBytes) != numBytes)
+            return false;
+
+        // The offsets aren't stored, as each block's header gives its size.
+        uint32_t offset = 0;
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            if (offset + 5 > (uint32_t) numBytes || c.data[offset + 4] > 32)
+                return false;
+
+            c.blockOffsets[block] = offset;
+            offset += 5 + (uint32_t) (((getBlockLength (block) - 1) * c.data[offset + 4] + 7) / 8);
+        }
+
+        if (offset != (uint32_t) numBytes)
+            return false;
+
+        c.blockOffsets[numBlocks] = offset;
+        c.numBytesEncoded = offset;
+        c.numStaged = 0;
+        c.decodedBlock = -1;
+    }
+
+    updateNumBytesUsed (numFrames);
+    return true;
+}
+
+//==============================================================================
+void CompactCaptureBuffer::writeLossless (Channel& c, const float* src, int startFrame, int numToWrite) noexcept
+{
+    if (startFrame == 0)
+    {
+        c.numStaged = 0;
+        c.numBytesEncoded = 0;
+        c.decodedBlock = -1;
+    }
+
+    jassert (startFrame % losslessBlockSize == c.numStaged);
+
+    for (int done = 0; done < numToWrite;)
+    {
+        const auto block = (startFrame + done) / losslessBlockSize;
+        const auto blockLength = getBlockLength (block);
+        const auto n = juce::jmin (blockLength - c.numStaged, numToWrite - done);
+
+        ReversatronKernels::quantise (c.staging.data() + c.numStaged, src + done, n, ReversatronKernels::int24Scale);
+        c.numStaged += n;
+        done += n;
+
+        // Blocks are encoded as soon as they fill, and the last (possibly
+        // short) block when the take ends.
+        if (c.numStaged == blockLength)
+        {
+            const auto offset = c.blockOffsets[block];
+            c.blockOffsets[block + 1] = offset + (uint32_t) encodeBlock (c.data + offset, c.staging.data(), blockLength);
+            c.numBytesEncoded = c.blockOffsets[block + 1];
+            c.numStaged = 0;
+        }
+    }
+}
+
+void CompactCaptureBuffer::readLossless (Channel& c, int firstFrame, float* dest, int num) noexcept
+{
+    // Walk backwards from the last frame wanted, one codec block at a time.
+    for (int done = 0; done < num;)
+    {
+        const auto frame = firstFrame + num - 1 - done;
+        const auto block = frame / losslessBlockSize;
+        const auto blockStart = block * losslessBlockSize;
+
+        if (c.decodedBlock != block)
+        {
+            decodeBlock (c.decoded.data(), c.data + c.blockOffsets[block], getBlockLength (block));
+            c.decodedBlock = block;
+        }
+
+        const auto runStart = juce::jmax (blockStart, firstFrame);
+        const auto n = frame - runStart + 1;
+
+        ReversatronKernels::reverseCopy (dest + done, c.decoded.data() + (runStart - blockStart), n);
+        done += n;
+    }
+}
+
+//==============================================================================
+int CompactCaptureBuffer::encodeBlock (uint8_t* dest, const int32_t* samples, int num) noexcept
+{
+    const auto first = static_cast<uint32_t> (samples[0]);
+    dest[0] = static_cast<uint8_t> (first);
+    dest[1] = static_cast<uint8_t> (first >> 8);
+    dest[2] = static_cast<uint8_t> (first >> 16);
+    dest[3] = static_cast<uint8_t> (first >> 24);
+
+    uint32_t deltas[losslessBlockSize];
+    uint32_t allBits = 0;
+
+    for (int i = 1; i < num; ++i)
+    {
+        deltas[i] = zigZag (samples[i] - samples[i - 1]);
+        allBits |= deltas[i];
+    }
+
+    int width = 0;
+
+    while (width < 32 && (allBits >> width) != 0)
+        ++width;
+
+    dest[4] = static_cast<uint8_t> (width);
+
+    auto* out = dest + 5;
+    uint64_t bitBuffer = 0;
+    int numBits = 0;
+
+    for (int i = 1; i < num && width > 0; ++i)
+    {
+        bitBuffer |= static_cast<uint64_t> (deltas[i]) << numBits;
+        numBits += width;
+
+        while (numBits >= 8)
+        {
+            *out++ = static_cast<uint8_t> (bitBuffer);
+            bitBuffer >>= 8;
+            numBits -= 8;
+        }
+    }
+
+    if (numBits > 0)
+        *out++ = static_cast<uint8_t> (bitBuffer);
+
+    return static_cast<int> (out - dest);
+}
+
+void CompactCaptureBuffer::decodeBlock (float* dest, const uint8_t* src, int num) noexcept
+{
+    constexpr auto scale = 1.0f / ReversatronKernels::int24Scale;
+
+    auto value = static_cast<int32_t> (static_cast<uint32_t> (src[0])
+                                     | (static_cast<uint32_t> (src[1]) << 8)
+                                     | (static_cast<uint32_t> (src[2]) << 16)
+                                     | (static_cast<uint32_t> (src[3]) << 24));
+    const int width = src[4];
+    dest[0] = static_cast<float> (value) * scale;
+
+    if (width == 0)
+    {
+        juce::FloatVectorOperations::fill (dest + 1, dest[0], num - 1);
+        return;
+    }
+
+    const auto* in = src + 5;
+    const auto mask = (static_cast<uint64_t> (1) << width) - 1;
+    uint64_t bitBuffer = 0;
+    int numBits = 0;
+
+    for (int i = 1; i < num; ++i)
+    {
+        while (numBits < width)
+        {
+            bitBuffer |= static_cast<uint64_t> (*in++) << numBits;
+            numBits += 8;
+        }
+
+        value += unZigZag (static_cast<uint32_t> (bitBuffer & mask));
+        bitBuffer >>= width;
+        numBits -= width;
+        dest[i] = static_cast<float> (value) * scale;
+    }
+}
@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    A reverse buffer that keeps the take in a compact fixed-point encoding.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "CaptureBuffer.h"
+
+//==============================================================================
+/**
+    Stores the take as 16-bit or packed 24-bit PCM, or as 24-bit PCM run
+    through a small block codec, and decodes it backwards on demand.
+
+    The lossless format splits each channel into blocks of 64 samples. Each
+    block holds its first sample followed by the zig-zagged deltas, bit-packed
+    at the narrowest width that fits the block. Decoding a block is one prefix
+    sum, so reversed reads stay cheap at any host block size. It is lossless
+    with respect to the 24-bit PCM format, and typically uses well under half
+    its space on real material. Storage is reserved for the worst case but
+    never touched ahead of the write position, so only the pages the encoder
+    has actually filled become resident.
+*/
+class CompactCaptureBuffer  : public CaptureBuffer
+{
+public:
+    CompactCaptureBuffer (int numChannels, int numSamples, CaptureFormat format);
+
+    /** False if the storage couldn't be allocated. */
+    bool isValid() const noexcept;
+
+    // Double precision input and output is converted by the base class.
+    using CaptureBuffer::writeChannel;
+    using CaptureBuffer::readReversed;
+    using CaptureBuffer::readTake;
+
+    int getBitsPerSample() const noexcept override;
+    void writeChannel (int channel, const float* source, int startFrame, int numToWrite) noexcept override;
+    void endWrite (int startFrame, int numToWrite) noexcept override;
+    void beginPlayback (int numFramesRecorded) noexcept override;
+    void readReversed (int channel, int position, float* dest, int num) noexcept override;
+    void readTake (int channel, int startFrame, float* dest, int num) override;
+
+    /** Bytes of sample data written so far, which is as much as has been
+        touched. Pages stay committed between takes, so this never goes down.
+    */
+    size_t getNumBytesUsed() const noexcept override;
+
+    /** Lossless format only: writes the encoded blocks covering frames
+        [0, numFrames) of each channel, which must all have been encoded
+        (numFrames is a whole number of blocks, or beginPlayback() has been
+        called).
+    */
+    void writeEncodedTake (juce::OutputStream& stream, int numFrames) const;
+
+    /** Lossless format only: reads back what writeEncodedTake() wrote, as a
+        take numFrames long. Returns false if the data doesn't fit.
+    */
+    bool readEncodedTake (juce::InputStream& stream, int numFrames);
+
+    static constexpr int losslessBlockSize = 64;
+
+    /** First sample (4 bytes), delta width (1 byte), then up to 63 deltas of at most 25 bits. */
+    static constexpr int maxEncodedBlockBytes = 5 + ((losslessBlockSize - 1) * 25 + 7) / 8;
+
+    /** Block codec used by the lossless format. encodeBlock() returns the
+        number of bytes written; decodeBlock() writes num floats.
+    */
+    static int encodeBlock (uint8_t* dest, const int32_t* samples, int num) noexcept;
+    static void decodeBlock (float* dest, const uint8_t* src, int num) noexcept;
+
+private:
+    struct Channel
+    {
+        juce::HeapBlock<uint8_t> data;
+        juce::HeapBlock<uint32_t> blockOffsets;
+
+        std::array<int32_t, losslessBlockSize> staging;
+        int numStaged = 0;
+        uint32_t numBytesEncoded = 0;
+
+        std::array<float, losslessBlockSize> decoded;
+        int decodedBlock = -1;
+    };
+
+    void writeLossless (Channel&, const float* src, int startFrame, int numToWrite) noexcept;
+    void updateNumBytesUsed (int numFramesWritten) noexcept;
+    void readLossless (Channel&, int firstFrame, float* dest, int num) noexcept;
+    int getBlockLength (int block) const noexcept;
+
+    const CaptureFormat format;
+    const int bytesPerSample;
+    std::vector<Channel> channels;
+    std::atomic<size_t> numBytesUsed { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CompactCaptureBuffer)
+};
@@ -0,0 +1,394 @@
+/*
+  ==============================================================================
+
+    A reverse buffer that spills the take to a memory-mapped temporary file.
+
+  ==============================================================================
+*/
+
+#include "DiskCaptureBuffer.h"
+#include "ReversatronKernels.h"
+
+#if JUCE_WINDOWS
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+ #include <winioctl.h>
+#endif
+
+//==============================================================================
+// One writer and one read-ahead thread are shared by every disk-backed buffer
+// in the process.
+struct DiskCaptureBuffer::StreamingThreads
+{
+    StreamingThreads()
+    {
+        writerThread.startThread();
+        readAheadThread.startThread();
+    }
+
+    ~StreamingThreads()
+    {
+        writerThread.stopThread (2000);
+        readAheadThread.stopThread (2000);
+    }
+
+    juce::TimeSliceThread writerThread { "ReversaTron disk writer" };
+    juce::TimeSliceThread readAheadThread { "ReversaTron read-ahead" };
+};
+
+struct DiskCaptureBuffer::Writer  : public juce::TimeSliceClient
+{
+    explicit Writer (DiskCaptureBuffer& o) : owner (o) {}
+    int useTimeSlice() override     { return owner.writeToFile(); }
+
+    DiskCaptureBuffer& owner;
+};
+
+struct DiskCaptureBuffer::ReadAhead  : public juce::TimeSliceClient
+{
+    explicit ReadAhead (DiskCaptureBuffer& o) : owner (o) {}
+    int useTimeSlice() override     { return owner.readAhead(); }
+
+    DiskCaptureBuffer& owner;
+};
+
+//==============================================================================
+namespace
+{
+    // Copies num samples into a ring starting at ring index start, wrapping
+    // at the end.
+    template <typename CopyFunction>
+    void forEachRingRun (int start, int num, int ringSize, CopyFunction&& copy)
+    {
+        const auto first = start & (ringSize - 1);
+        const auto numBeforeWrap = juce::jmin (num, ringSize - first);
+
+        copy (first, 0, numBeforeWrap);
+
+        if (numBeforeWrap < num)
+            copy (0, numBeforeWrap, num - numBeforeWrap);
+    }
+
+    // Creates the file at its full size without writing, or taking disk
+    // space for, any of it. POSIX filesystems leave the unwritten range as
+    // a hole; NTFS only does if the file is marked sparse before it grows.
+    bool createSparseFile (const juce::File& file, juce::int64 size)
+    {
+       #if JUCE_WINDOWS
+        auto handle = CreateFileW (file.getFullPathName().toWideCharPointer(), GENERIC_READ | GENERIC_WRITE, 0,
+                                   nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        if (handle == INVALID_HANDLE_VALUE)
+            return false;
+
+        // A filesystem without sparse files (FAT) refuses, and the file just
+        // takes its whole size on disk.
+        DWORD numBytesReturned = 0;
+        DeviceIoControl (handle, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &numBytesReturned, nullptr);
+
+        LARGE_INTEGER end;
+        end.QuadPart = size;
+        const auto extended = SetFilePointerEx (handle, end, nullptr, FILE_BEGIN) && SetEndOfFile (handle);
+        CloseHandle (handle);
+        return extended;
+       #else
+        // Seeking past the end and writing one byte leaves the rest a hole.
+        juce::FileOutputStream stream (file);
+
+        if (! stream.openedOk())
+            return false;
+
+        stream.setPosition (size - 1);
+        return stream.writeByte (0);
+       #endif
+    }
+}
+
+//==============================================================================
+DiskCaptureBuffer::DiskCaptureBuffer (int numChannelsToUse, int numSamplesToUse)
+    : CaptureBuffer (numChannelsToUse, numSamplesToUse),
+      recordRing (numChannelsToUse, ringSize),
+      playbackRing (numChannelsToUse, ringSize),
+      playbackReadyUntil (numSamplesToUse),
+      playbackConsumed (numSamplesToUse)
+{
+    recordRing.clear();
+    playbackRing.clear();
+
+    const auto fileSize = (juce::int64) numChannels * (juce::int64) numSamples * (juce::int64) sizeof (float);
+    const auto file = temporaryFile.getFile();
+
+    if (fileSize > 0)
+    {
+        if (! createSparseFile (file, fileSize))
+            return;
+
+        mappedFile = std::make_unique<juce::MemoryMappedFile> (file, juce::MemoryMappedFile::readWrite);
+
+        if (mappedFile->getData() == nullptr || (juce::int64) mappedFile->getSize() < fileSize)
+        {
+            mappedFile.reset();
+            return;
+        }
+    }
+
+    writer = std::make_unique<Writer> (*this);
+    reader = std::make_unique<ReadAhead> (*this);
+    threads->writerThread.addTimeSliceClient (writer.get());
+    threads->readAheadThread.addTimeSliceClient (reader.get());
+}
+
+DiskCaptureBuffer::~DiskCaptureBuffer()
+{
+    // Unmap before the temporary file is deleted.
+    if (writer != nullptr)
+        threads->writerThread.removeTimeSliceClient (writer.get());
+
+    if (reader != nullptr)
+        threads->readAheadThread.removeTimeSliceClient (reader.get());
+
+    mappedFile.reset();
+}
+
+bool DiskCaptureBuffer::isValid() const noexcept
+{
+    return numSamples == 0 || mappedFile != nullptr;
+}
+
+float* DiskCaptureBuffer::getMappedChannel (int channel) const noexcept
+{
+    return static_cast<float*> (mappedFile->getData()) + (size_t) channel * (size_t) numSamples;
+}
+
+//==============================================================================
+void DiskCaptureBuffer::beginWrite (int startFrame, int) noexcept
+{
+    if (startFrame == 0)
+    {
+        // Reset the counter before announcing the take, so the writer never
+        // sees the new take paired with the old take's progress.
+        recordedUntil = 0;
+        ++recordTake;
+
+        // Park the read-ahead thread, which may still be busy with a take
+        // that was stopped part way through playback.
+        playbackReadyUntil = numSamples;
+        playbackConsumed = numSamples;
+    }
+}
+
+void DiskCaptureBuffer::writeChannel (int channel, const float* source, int startFrame, int numToWrite) noexcept
+{
+    auto* ring = recordRing.getWritePointer (channel);
+
+    forEachRingRun (startFrame, numToWrite, ringSize, [&] (int ringIndex, int offset, int num)
+    {
+        juce::FloatVectorOperations::copy (ring + ringIndex, source + offset, num);
+    });
+
+    // The final ring's worth of the take is also written, reversed, straight
+    // into the playback ring so reversed output can start immediately.
+    const auto endFrame = startFrame + numToWrite;
+    const auto tailStart = juce::jmax (startFrame, numSamples - ringSize);
+
+    if (endFrame > tailStart)
+    {
+        const auto firstPosition = numSamples - endFrame;
+        const auto numTail = endFrame - tailStart;
+        const auto* src = source + (tailStart - startFrame);
+        auto* playback = playbackRing.getWritePointer (channel);
+
+        forEachRingRun (firstPosition, numTail, ringSize, [&] (int ringIndex, int offset, int num)
+        {
+            // Positions [offset, offset + num) of this run come from the
+            // last num frames before (numTail - offset).
+            ReversatronKernels::reverseCopy (playback + ringIndex, src + numTail - offset - num, num);
+        });
+    }
+}
+
+void DiskCaptureBuffer::endWrite (int startFrame, int numToWrite) noexcept
+{
+    recordedUntil = startFrame + numToWrite;
+}
+
+void DiskCaptureBuffer::beginPlayback (int numFramesRecorded) noexcept
+{
+    const auto firstPosition = numSamples - numFramesRecorded;
+    auto readyUntil = juce::jmin (numSamples, ringSize);
+
+    if (numFramesRecorded < numSamples)
+    {
+        // The take was cut short, so the tail write() reversed into the
+        // playback ring isn't the right one. The newest frames are still in
+        // the record ring though, so reverse those across instead.
+        const auto numToCopy = juce::jmin (ringSize, numFramesRecorded);
+        const auto firstFrame = numFramesRecorded - numToCopy;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const auto* record = recordRing.getReadPointer (channel);
+            auto* playback = playbackRing.getWritePointer (channel);
+
+            forEachRingRun (firstFrame, numToCopy, ringSize, [&] (int recordIndex, int offset, int num)
+            {
+                // Frames [firstFrame + offset, + num) land on this run of positions.
+                const auto runPosition = numSamples - (firstFrame + offset) - num;
+
+                forEachRingRun (runPosition, num, ringSize, [&] (int playbackIndex, int positionOffset, int numToReverse)
+                {
+                    ReversatronKernels::reverseCopy (playback + playbackIndex,
+                                                     record + recordIndex + num - positionOffset - numToReverse,
+                                                     numToReverse);
+                });
+            });
+        }
+
+        readyUntil = firstPosition + numToCopy;
+    }
+
+    // Consumed first, so the read-ahead thread never pairs the new ready
+    // count with the previous take's consumed count.
+    playbackConsumed = firstPosition;
+    playbackReadyUntil = readyUntil;
+}
+
+void DiskCaptureBuffer::readReversed (int channel, int position, float* dest, int num) noexcept
+{
+    const auto available = juce::jlimit (0, num, playbackReadyUntil.load() - position);
+    const auto* ring = playbackRing.getReadPointer (channel);
+
+    forEachRingRun (position, available, ringSize, [&] (int ringIndex, int offset, int numToCopy)
+    {
+        juce::FloatVectorOperations::copy (dest + offset, ring + ringIndex, numToCopy);
+    });
+
+    if (available < num)
+    {
+        juce::FloatVectorOperations::clear (dest + available, num - available);
+
+        if (channel == 0)
+            numUnderruns += num - available;
+    }
+}
+
+void DiskCaptureBuffer::releaseReversed (int position) noexcept
+{
+    playbackConsumed = position;
+}
+
+void DiskCaptureBuffer::readTake (int channel, int startFrame, float* dest, int num)
+{
+    // Straight from the file, bypassing the playback ring. Anything the
+    // writer skipped after an overrun reads back as whatever the file held.
+    flushWrites();
+
+    const auto available = juce::jlimit (0, num, writtenUntil.load() - startFrame);
+
+    if (available > 0)
+        juce::FloatVectorOperations::copy (dest, getMappedChannel (channel) + startFrame, available);
+
+    if (available < num)
+        juce::FloatVectorOperations::clear (dest + available, num - available);
+}
+
+void DiskCaptureBuffer::flushWrites()
+{
+    if (writer == nullptr)
+        return;
+
+    // Only waits for what had been recorded on entry, so that this returns
+    // while recording carries on. If a new take starts meanwhile, there's
+    // nothing left worth waiting for.
+    const auto take = recordTake.load();
+    const auto recorded = recordedUntil.load();
+
+    while (recordTake.load() == take && (writerTake.load() != take || writtenUntil.load() < recorded))
+        juce::Thread::sleep (1);
+}
+
+size_t DiskCaptureBuffer::getNumBytesUsed() const noexcept
+{
+    // Only the two rings live in RAM; the mapped file is the system's to page.
+    return 2 * (size_t) numChannels * (size_t) ringSize * sizeof (float);
+}
+
+//==============================================================================
+int DiskCaptureBuffer::writeToFile()
+{
+    const auto take = recordTake.load();
+    const auto recorded = recordedUntil.load();
+
+    if (take != writerTake.load())
+    {
+        // Progress is reset before the take is acknowledged, so flushWrites()
+        // never sees the new take paired with the old take's progress.
+        writtenUntil = 0;
+        writerTake = take;
+    }
+
+    auto written = writtenUntil.load();
+
+    if (recorded <= written)
+        return 5;
+
+    if (recorded - written > ringSize)
+    {
+        // The ring has already been overwritten - skip what was lost.
+        numOverruns += recorded - ringSize - written;
+        written = recorded - ringSize;
+    }
+
+    const auto numToWrite = juce::jmin (chunkSize, recorded - written);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        const auto* ring = recordRing.getReadPointer (channel);
+        auto* dest = getMappedChannel (channel) + written;
+
+        forEachRingRun (written, numToWrite, ringSize, [&] (int ringIndex, int offset, int num)
+        {
+            std::memcpy (dest + offset, ring + ringIndex, (size_t) num * sizeof (float));
+        });
+    }
+
+    writtenUntil = written + numToWrite;
+    return 0;
+}
+
+int DiskCaptureBuffer::readAhead()
+{
+    // Ready is read before consumed - see beginPlayback(). If playback has
+    // jumped ahead (a take carried over to a new sample rate resumes part
+    // way through), there's no point filling in what it skipped.
+    const auto readyUntil = playbackReadyUntil.load();
+    const auto consumed = playbackConsumed.load();
+    const auto ready = juce::jmax (readyUntil, consumed);
+    const auto limit = juce::jmin (numSamples, consumed + ringSize);
+
+    if (ready >= limit)
+        return 5;
+
+    // Position p needs recorded frame (numSamples - 1 - p) to be on disk.
+    if (numSamples - ready > writtenUntil.load())
+        return 1;
+
+    const auto end = juce::jmin (limit, ready + chunkSize);
+    const auto num = end - ready;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        const auto* src = getMappedChannel (channel) + (numSamples - end);
+        auto* ring = playbackRing.getWritePointer (channel);
+
+        forEachRingRun (ready, num, ringSize, [&] (int ringIndex, int offset, int numToCopy)
+        {
+            ReversatronKernels::reverseCopy (ring + ringIndex, src + num - offset - numToCopy, numToCopy);
+        });
+    }
+
+    playbackReadyUntil = end;
+    return 0;
+}
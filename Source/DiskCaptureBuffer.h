@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    A reverse buffer that spills the take to a memory-mapped temporary file.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "CaptureBuffer.h"
+
+//==============================================================================
+/**
+    Streams the take to disk so that only a couple of small rings stay
+    resident, however long the buffer is.
+
+    The audio thread writes each block into a record ring, which a writer
+    thread drains into a memory-mapped temporary file. For playback, a
+    read-ahead thread walks the file backwards and fills a second ring with
+    samples already in playback order, keeping it one ring's length ahead of
+    the audio thread. The last ring's worth of each take is written straight
+    into the playback ring while recording, so reversed output is available
+    from the first block without waiting for the disk.
+
+    Rings are indexed by absolute frame/position (masked to the ring size) and
+    handed between threads with atomic counters only.
+*/
+class DiskCaptureBuffer  : public CaptureBuffer
+{
+public:
+    DiskCaptureBuffer (int numChannels, int numSamples);
+    ~DiskCaptureBuffer() override;
+
+    /** False if the temporary file couldn't be created or mapped. */
+    bool isValid() const noexcept;
+
+    // Double precision input and output is converted by the base class.
+    using CaptureBuffer::writeChannel;
+    using CaptureBuffer::readReversed;
+    using CaptureBuffer::readTake;
+
+    void beginWrite (int startFrame, int numToWrite) noexcept override;
+    void writeChannel (int channel, const float* source, int startFrame, int numToWrite) noexcept override;
+    void endWrite (int startFrame, int numToWrite) noexcept override;
+    void beginPlayback (int numFramesRecorded) noexcept override;
+    void readReversed (int channel, int position, float* dest, int num) noexcept override;
+    void releaseReversed (int position) noexcept override;
+    void readTake (int channel, int startFrame, float* dest, int num) override;
+    void flushWrites() override;
+    size_t getNumBytesUsed() const noexcept override;
+    int getNumDroppedSamples() const noexcept override  { return getNumOverruns(); }
+
+    /** Frames lost because the writer fell more than a ring behind. */
+    int getNumOverruns() const noexcept     { return numOverruns.load(); }
+
+    /** Playback samples that weren't read ahead in time and came out silent. */
+    int getNumUnderruns() const noexcept    { return numUnderruns.load(); }
+
+private:
+    struct Writer;
+    struct ReadAhead;
+    struct StreamingThreads;
+
+    static constexpr int ringSize = 1 << 16;
+    static constexpr int ringMask = ringSize - 1;
+    static constexpr int chunkSize = 4096;
+
+    float* getMappedChannel (int channel) const noexcept;
+    int writeToFile();
+    int readAhead();
+
+    juce::TemporaryFile temporaryFile { ".reversatron" };
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+
+    juce::AudioBuffer<float> recordRing, playbackRing;
+
+    // Record side: the audio thread advances recordedUntil, the writer thread
+    // advances writtenUntil. recordTake changes whenever a new take starts.
+    std::atomic<int> recordedUntil { 0 }, writtenUntil { 0 };
+    std::atomic<uint32_t> recordTake { 0 }, writerTake { 0 };
+
+    // Playback side: the read-ahead thread advances playbackReadyUntil, the
+    // audio thread advances playbackConsumed.
+    std::atomic<int> playbackReadyUntil, playbackConsumed;
+
+    std::atomic<int> numOverruns { 0 }, numUnderruns { 0 };
+
+    juce::SharedResourcePointer<StreamingThreads> threads;
+    std::unique_ptr<Writer> writer;
+    std::unique_ptr<ReadAhead> reader;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DiskCaptureBuffer)
+};
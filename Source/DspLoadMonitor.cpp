@@ -0,0 +1,156 @@
+/*
+  ==============================================================================
+
+    Measures how close processBlock comes to its deadline.
+
+  ==============================================================================
+*/
+
+#include "DspLoadMonitor.h"
+#include "ReversatronKernels.h"
+#include <cstring>
+
+//==============================================================================
+template <typename SampleType>
+DspLoadMonitor::ScopedBlock<SampleType>::ScopedBlock (DspLoadMonitor& monitorToUse, const juce::AudioBuffer<SampleType>& bufferToScan, double rate) noexcept
+    : monitor (monitorToUse), buffer (bufferToScan), sampleRate (rate),
+      startTicks (juce::Time::getHighResolutionTicks())
+{
+    monitor.beginBlock();
+}
+
+template <typename SampleType>
+DspLoadMonitor::ScopedBlock<SampleType>::~ScopedBlock()
+{
+    const auto seconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+
+    // The scan happens after the clock stops, so it isn't counted as load.
+    int numNonFinite = 0, numDenormal = 0;
+
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        ReversatronKernels::countUnusualSamples (buffer.getReadPointer (channel), buffer.getNumSamples(), numNonFinite, numDenormal);
+
+    const auto budget = sampleRate > 0.0 ? buffer.getNumSamples() / sampleRate : 0.0;
+    monitor.recordBlock (seconds, budget, numNonFinite, numDenormal);
+}
+
+template class DspLoadMonitor::ScopedBlock<float>;
+template class DspLoadMonitor::ScopedBlock<double>;
+
+//==============================================================================
+void DspLoadMonitor::beginBlock() noexcept
+{
+    // Cleared here rather than as the block is recorded, so that anything
+    // noted during the block counts towards the new stats.
+    if (resetRequested.exchange (false))
+    {
+        current = {};
+        blockWorkerWaitSeconds = 0.0;
+    }
+}
+
+void DspLoadMonitor::recordBlock (double seconds, double budget, int numNonFinite, int numDenormal) noexcept
+{
+    const auto microseconds = seconds * 1.0e6;
+    const auto load = budget > 0.0 ? static_cast<float> (seconds / budget) : 0.0f;
+
+    ++current.numBlocks;
+
+    if (load > 1.0f)
+        ++current.numOverruns;
+
+    if (numNonFinite > 0)
+        ++current.numNonFiniteBlocks;
+
+    if (numDenormal > 0)
+        ++current.numDenormalBlocks;
+
+    auto bucket = 0;
+
+    for (auto limit = 1.0; microseconds >= limit && bucket < numHistogramBuckets - 1; limit *= 2.0)
+        ++bucket;
+
+    ++current.histogram[(size_t) bucket];
+
+    // One-pole smoothing with a time constant of about a second of audio.
+    const auto smoothing = static_cast<float> (juce::jlimit (0.0, 1.0, budget));
+    current.lastLoad = load;
+    current.averageLoad += (load - current.averageLoad) * smoothing;
+    current.peakLoad = juce::jmax (current.peakLoad, load);
+    current.worstBlockMicroseconds = juce::jmax (current.worstBlockMicroseconds, microseconds);
+
+    if (blockWorkerWaitSeconds > 0.0)
+    {
+        ++current.numWorkerWaitBlocks;
+        current.worstWorkerWaitMicroseconds = juce::jmax (current.worstWorkerWaitMicroseconds, blockWorkerWaitSeconds * 1.0e6);
+        blockWorkerWaitSeconds = 0.0;
+    }
+
+    publish();
+}
+
+void DspLoadMonitor::publish() noexcept
+{
+    static_assert (std::is_trivially_copyable_v<Stats>);
+
+    std::array<uint64_t, numStatsWords> words {};
+    std::memcpy (words.data(), &current, sizeof (Stats));
+
+    const auto sequence = publishSequence.load (std::memory_order_relaxed);
+    publishSequence.store (sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence (std::memory_order_release);
+
+    for (size_t i = 0; i < numStatsWords; ++i)
+        publishedWords[i].store (words[i], std::memory_order_relaxed);
+
+    publishSequence.store (sequence + 2, std::memory_order_release);
+}
+
+DspLoadMonitor::Stats DspLoadMonitor::getStats() const noexcept
+{
+    std::array<uint64_t, numStatsWords> words {};
+
+    for (;;)
+    {
+        const auto sequence = publishSequence.load (std::memory_order_acquire);
+
+        for (size_t i = 0; i < numStatsWords; ++i)
+            words[i] = publishedWords[i].load (std::memory_order_relaxed);
+
+        std::atomic_thread_fence (std::memory_order_acquire);
+
+        if ((sequence & 1) == 0 && publishSequence.load (std::memory_order_relaxed) == sequence)
+            break;
+
+        juce::Thread::yield();
+    }
+
+    Stats stats;
+    std::memcpy (static_cast<void*> (&stats), words.data(), sizeof (Stats));
+    return stats;
+}
+
+juce::var DspLoadMonitor::Stats::toVar() const
+{
+    auto* object = new juce::DynamicObject();
+    object->setProperty ("blocks", (juce::int64) numBlocks);
+    object->setProperty ("overruns", (juce::int64) numOverruns);
+    object->setProperty ("nonFiniteBlocks", (juce::int64) numNonFiniteBlocks);
+    object->setProperty ("denormalBlocks", (juce::int64) numDenormalBlocks);
+    object->setProperty ("waitedBlocks", (juce::int64) numWaitedBlocks);
+    object->setProperty ("droppedSamples", (juce::int64) numDroppedSamples);
+    object->setProperty ("lastLoad", lastLoad);
+    object->setProperty ("averageLoad", averageLoad);
+    object->setProperty ("peakLoad", peakLoad);
+    object->setProperty ("worstBlockUs", worstBlockMicroseconds);
+    object->setProperty ("workerWaitBlocks", (juce::int64) numWorkerWaitBlocks);
+    object->setProperty ("worstWorkerWaitUs", worstWorkerWaitMicroseconds);
+
+    juce::Array<juce::var> buckets;
+
+    for (auto count : histogram)
+        buckets.add ((juce::int64) count);
+
+    object->setProperty ("histogramUs", buckets);
+    return juce::var (object);
+}
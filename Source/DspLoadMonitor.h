@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    Measures how close processBlock comes to its deadline.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Per-block timing and sanity counters for the audio callback.
+
+    The audio thread times each block against its real-time budget
+    (numSamples / sampleRate) and scans the output for NaN, infinite and
+    denormal samples. The audio thread keeps the stats in a copy of its own,
+    and publishes the whole of it at the end of each block under a sequence
+    lock, so recording a block takes no locks, allocates nothing and never
+    waits, and getStats() always returns the stats as of one block.
+*/
+class DspLoadMonitor
+{
+public:
+    DspLoadMonitor() = default;
+
+    /** Block times are bucketed by powers of two of a microsecond: bucket 0
+        holds blocks under 1 us, bucket i those in [2^(i-1), 2^i) us, and the
+        last bucket everything longer.
+    */
+    static constexpr int numHistogramBuckets = 24;
+
+    struct Stats
+    {
+        uint64_t numBlocks = 0;
+        uint64_t numOverruns = 0;           // blocks that took longer than their duration
+        uint64_t numNonFiniteBlocks = 0;    // blocks with NaN or infinite output
+        uint64_t numDenormalBlocks = 0;     // blocks with denormal output
+        uint64_t numWaitedBlocks = 0;       // offline blocks that waited for the buffer allocator
+        uint64_t numDroppedSamples = 0;     // input frames the capture buffer couldn't store
+        uint64_t numWorkerWaitBlocks = 0;   // blocks that waited for a channel worker to finish
+        float lastLoad = 0.0f;              // block time / block duration
+        float averageLoad = 0.0f;           // smoothed over roughly the last second
+        float peakLoad = 0.0f;
+        double worstBlockMicroseconds = 0.0;
+        double worstWorkerWaitMicroseconds = 0.0;   // the longest any one block spent waiting for workers
+        std::array<uint64_t, numHistogramBuckets> histogram {};
+
+        /** A JSON-friendly copy, for the headless tools to dump. */
+        juce::var toVar() const;
+    };
+
+    /** Any thread other than the audio thread. Lock-free: if the audio
+        thread publishes meanwhile, the copy is taken again.
+    */
+    Stats getStats() const noexcept;
+
+    /** Any thread: clears the stats at the start of the next block. */
+    void reset() noexcept                   { resetRequested = true; }
+
+    /** Audio thread: counts a block that had to wait for another thread,
+        which only happens offline. Its time says more about that thread
+        than about the DSP, so benchmarks leave it out.
+    */
+    void noteBlockWaited() noexcept         { ++current.numWaitedBlocks; }
+
+    /** Audio thread: counts frames of input that were lost for want of
+        memory, or because the disk fell behind.
+    */
+    void noteDroppedSamples (int num) noexcept      { current.numDroppedSamples += (uint64_t) num; }
+
+    /** Audio thread: adds time spent waiting for a ChannelWorkerPool's
+        workers to the current block.
+    */
+    void noteWorkerWait (double seconds) noexcept    { blockWorkerWaitSeconds += seconds; }
+
+    //==============================================================================
+    /** Times the audio callback for its lifetime, then scans the buffer it
+        was given. There's one for each precision processBlock runs at.
+    */
+    template <typename SampleType>
+    class ScopedBlock
+    {
+    public:
+        ScopedBlock (DspLoadMonitor& monitor, const juce::AudioBuffer<SampleType>& buffer, double sampleRate) noexcept;
+        ~ScopedBlock();
+
+    private:
+        DspLoadMonitor& monitor;
+        const juce::AudioBuffer<SampleType>& buffer;
+        const double sampleRate;
+        const juce::int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedBlock)
+    };
+
+private:
+    void beginBlock() noexcept;
+    void recordBlock (double seconds, double budget, int numNonFinite, int numDenormal) noexcept;
+    void publish() noexcept;
+
+    // Audio thread only.
+    Stats current;
+    double blockWorkerWaitSeconds = 0.0;
+
+    // The last published copy of current, as raw words so that each can be
+    // an atomic. The sequence count is odd while the audio thread is part
+    // way through writing them, so a reader tries again.
+    static constexpr size_t numStatsWords = (sizeof (Stats) + sizeof (uint64_t) - 1) / sizeof (uint64_t);
+    std::atomic<uint32_t> publishSequence { 0 };
+    std::array<std::atomic<uint64_t>, numStatsWords> publishedWords {};
+
+    std::atomic<bool> resetRequested { false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DspLoadMonitor)
+};
@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    Watches the input for the level or transient that starts a take.
+
+  ==============================================================================
+*/
+
+#include "InputTrigger.h"
+#include "ReversatronKernels.h"
+
+//==============================================================================
+void InputTrigger::prepare (double sampleRate) noexcept
+{
+    envelope = 0.0f;
+    envelopeCoefficient = static_cast<float> (1.0 - std::exp (-subBlockSize / (envelopeSeconds * sampleRate)));
+}
+
+template <typename SampleType>
+int InputTrigger::process (const SampleType* const* channels, int numChannels, int startSample, int numSamples,
+                           Mode mode, float threshold, bool armed) noexcept
+{
+    if (mode == Mode::manual)
+        return numSamples;
+
+    if (mode == Mode::level)
+        return armed ? findFirstAbove (channels, numChannels, startSample, numSamples, threshold)
+                     : numSamples;
+
+    for (int done = 0; done < numSamples; done += subBlockSize)
+    {
+        const auto num = juce::jmin (subBlockSize, numSamples - done);
+        auto peak = 0.0f;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            peak = juce::jmax (peak, ReversatronKernels::findPeak (channels[channel] + startSample + done, num));
+
+        // Compared with the level before this sub-block, so that the
+        // transient itself doesn't raise the bar it has to clear.
+        const auto level = juce::jmax (threshold, transientRatio * envelope);
+        envelope += (peak - envelope) * envelopeCoefficient * static_cast<float> (num) / subBlockSize;
+
+        if (armed && peak >= level)
+            return done + findFirstAbove (channels, numChannels, startSample + done, num, level);
+    }
+
+    return numSamples;
+}
+
+template <typename SampleType>
+int InputTrigger::findFirstAbove (const SampleType* const* channels, int numChannels, int startSample,
+                                  int numSamples, float threshold) noexcept
+{
+    // Each channel only needs looking at up to the earliest frame found so far.
+    auto first = numSamples;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        first = ReversatronKernels::findFirstAbove (channels[channel] + startSample, first, threshold);
+
+    return first;
+}
+
+template int InputTrigger::process (const float* const*, int, int, int, Mode, float, bool) noexcept;
+template int InputTrigger::process (const double* const*, int, int, int, Mode, float, bool) noexcept;
@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+
+    Watches the input for the level or transient that starts a take.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Finds the first frame of input that should start an armed take.
+
+    In level mode that's the first sample on any channel at or above the
+    threshold. In transient mode it's the first sample of a sudden jump: the
+    input is looked at in sub-blocks of subBlockSize frames, and one whose
+    peak (across every channel) reaches the threshold and is transientRatio
+    times the recent level triggers. The recent level is a peak envelope,
+    updated once per sub-block, which keeps the recursive part of the
+    follower off the per-sample path; the peaks themselves are found with
+    vectorised kernels. Once a sub-block has triggered, the exact frame is
+    found within it, so takes still start sample-accurately.
+
+    The envelope follows the input whether or not anything is armed, so that
+    it has settled by the time something is. Audio thread only.
+*/
+class InputTrigger
+{
+public:
+    enum class Mode
+    {
+        manual = 0,
+        level,
+        transient
+    };
+
+    /** Sets the envelope up for a sample rate, and forgets the input so far. */
+    void prepare (double sampleRate) noexcept;
+
+    /** Looks at numSamples frames of each channel from startSample. Returns
+        the offset of the frame that starts the take, or numSamples if it
+        isn't armed or nothing triggers. The threshold is a gain. It's
+        available for float and double samples.
+    */
+    template <typename SampleType>
+    int process (const SampleType* const* channels, int numChannels, int startSample, int numSamples,
+                 Mode mode, float threshold, bool armed) noexcept;
+
+private:
+    static constexpr int subBlockSize = 32;
+    static constexpr float transientRatio = 4.0f;       // 12 dB over the recent level
+    static constexpr double envelopeSeconds = 0.1;
+
+    template <typename SampleType>
+    static int findFirstAbove (const SampleType* const* channels, int numChannels, int startSample,
+                               int numSamples, float threshold) noexcept;
+
+    float envelope = 0.0f;
+    float envelopeCoefficient = 1.0f;       // per full sub-block
+};
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    A pair of reverse buffers that swap roles every period.
+
+  ==============================================================================
+*/
+
+#include "PingPongCaptureBuffer.h"
+
+//==============================================================================
+PingPongCaptureBuffer::PingPongCaptureBuffer (std::unique_ptr<CaptureBuffer> first, std::unique_ptr<CaptureBuffer> second)
+    : CaptureBuffer (first->getNumChannels(), first->getNumSamples())
+{
+    jassert (second->getNumChannels() == numChannels && second->getNumSamples() == numSamples);
+
+    buffers[0] = std::move (first);
+    buffers[1] = std::move (second);
+}
+
+void PingPongCaptureBuffer::beginWrite (int startFrame, int numToWrite) noexcept
+{
+    getRecordSide().beginWrite (startFrame, numToWrite);
+}
+
+void PingPongCaptureBuffer::reserveFrames (int startFrame, int numToWrite)
+{
+    getRecordSide().reserveFrames (startFrame, numToWrite);
+}
+
+void PingPongCaptureBuffer::writeChannel (int channel, const float* source, int startFrame, int numToWrite) noexcept
+{
+    getRecordSide().writeChannel (channel, source, startFrame, numToWrite);
+}
+
+void PingPongCaptureBuffer::writeChannel (int channel, const double* source, int startFrame, int numToWrite) noexcept
+{
+    getRecordSide().writeChannel (channel, source, startFrame, numToWrite);
+}
+
+void PingPongCaptureBuffer::endWrite (int startFrame, int numToWrite) noexcept
+{
+    getRecordSide().endWrite (startFrame, numToWrite);
+}
+
+void PingPongCaptureBuffer::beginPlayback (int numFramesRecorded) noexcept
+{
+    getRecordSide().beginPlayback (numFramesRecorded);
+    recordIndex = 1 - recordIndex;
+}
+
+const float* PingPongCaptureBuffer::getReadPointer (int channel, int startFrame, int num) const noexcept
+{
+    return getPlaybackSide().getReadPointer (channel, startFrame, num);
+}
+
+const double* PingPongCaptureBuffer::getDoubleReadPointer (int channel, int startFrame, int num) const noexcept
+{
+    return getPlaybackSide().getDoubleReadPointer (channel, startFrame, num);
+}
+
+void PingPongCaptureBuffer::readReversed (int channel, int position, float* dest, int num) noexcept
+{
+    getPlaybackSide().readReversed (channel, position, dest, num);
+}
+
+void PingPongCaptureBuffer::readReversed (int channel, int position, double* dest, int num) noexcept
+{
+    getPlaybackSide().readReversed (channel, position, dest, num);
+}
+
+void PingPongCaptureBuffer::releaseReversed (int position) noexcept
+{
+    getPlaybackSide().releaseReversed (position);
+}
+
+void PingPongCaptureBuffer::readTake (int channel, int startFrame, float* dest, int num)
+{
+    // The last take, which is the one playing.
+    getPlaybackSide().readTake (channel, startFrame, dest, num);
+}
+
+void PingPongCaptureBuffer::readTake (int channel, int startFrame, double* dest, int num)
+{
+    getPlaybackSide().readTake (channel, startFrame, dest, num);
+}
+
+void PingPongCaptureBuffer::release() noexcept
+{
+    buffers[0]->release();
+    buffers[1]->release();
+}
+
+size_t PingPongCaptureBuffer::getNumBytesUsed() const noexcept
+{
+    return buffers[0]->getNumBytesUsed() + buffers[1]->getNumBytesUsed();
+}
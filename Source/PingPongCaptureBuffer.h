@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+
+    A pair of reverse buffers that swap roles every period.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "CaptureBuffer.h"
+
+//==============================================================================
+/**
+    Records into one buffer while playing the other back, for uninterrupted
+    reversed output one buffer length behind the input.
+
+    Writes go to the recording side, and the read calls come from the
+    playback side. beginPlayback() finishes the take on the recording side
+    and then swaps the two, so the take just captured starts playing while
+    the next one records over the take that has just finished playing.
+*/
+class PingPongCaptureBuffer  : public CaptureBuffer
+{
+public:
+    /** Both buffers must have the same size. */
+    PingPongCaptureBuffer (std::unique_ptr<CaptureBuffer> first, std::unique_ptr<CaptureBuffer> second);
+
+    bool isDoubleBuffered() const noexcept override    { return true; }
+    int getBitsPerSample() const noexcept override     { return getRecordSide().getBitsPerSample(); }
+    int getNumDroppedSamples() const noexcept override { return buffers[0]->getNumDroppedSamples() + buffers[1]->getNumDroppedSamples(); }
+
+    void beginWrite (int startFrame, int numToWrite) noexcept override;
+    void reserveFrames (int startFrame, int numToWrite) override;
+    void writeChannel (int channel, const float* source, int startFrame, int numToWrite) noexcept override;
+    void writeChannel (int channel, const double* source, int startFrame, int numToWrite) noexcept override;
+    void endWrite (int startFrame, int numToWrite) noexcept override;
+    void beginPlayback (int numFramesRecorded) noexcept override;
+    const float* getReadPointer (int channel, int startFrame, int num) const noexcept override;
+    const double* getDoubleReadPointer (int channel, int startFrame, int num) const noexcept override;
+    void readReversed (int channel, int position, float* dest, int num) noexcept override;
+    void readReversed (int channel, int position, double* dest, int num) noexcept override;
+    void releaseReversed (int position) noexcept override;
+    void release() noexcept override;
+    void readTake (int channel, int startFrame, float* dest, int num) override;
+    void readTake (int channel, int startFrame, double* dest, int num) override;
+    size_t getNumBytesUsed() const noexcept override;
+
+private:
+    CaptureBuffer& getRecordSide() const noexcept     { return *buffers[recordIndex]; }
+    CaptureBuffer& getPlaybackSide() const noexcept   { return *buffers[1 - recordIndex]; }
+
+    std::unique_ptr<CaptureBuffer> buffers[2];
+    int recordIndex = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PingPongCaptureBuffer)
+};
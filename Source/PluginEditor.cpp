@@ -1,131 +1,504 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin editor.
-
-  ==============================================================================
-*/
-
-#include "PluginProcessor.h"
-#include "PluginEditor.h"
-
-//==============================================================================
-ReversatronAudioProcessorEditor::ReversatronAudioProcessorEditor (ReversatronAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
-{
-    // Make sure that before the constructor has finished, you've set the
-    // editor's size to whatever you need it to be.
-    setSize (400, 300);
-    
-    bufferLengthSliderAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.getApvts(), "bufferLength", bufferLengthSlider);
-    crossfadeTimeSliderAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.getApvts(), "crossfadeTime", crossfadeTimeSlider);
-    
-    addAndMakeVisible (&bufferLengthLabel);
-    bufferLengthLabel.setText("Buffer Length (s)", juce::dontSendNotification);
-    addAndMakeVisible (&crossfadeTimeLabel);
-    crossfadeTimeLabel.setText("Crossfade (s)", juce::dontSendNotification);
-    
-    addAndMakeVisible (&bufferLengthSlider);
-    bufferLengthSlider.setSliderStyle(juce::Slider::RotaryVerticalDrag);
-    bufferLengthSlider.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 100, 30);
-    bufferLengthSlider.setRange(0.5f, 500.0f, 0.01f);
-    
-    addAndMakeVisible (&crossfadeTimeSlider);
-    crossfadeTimeSlider.setSliderStyle(juce::Slider::RotaryVerticalDrag);
-    crossfadeTimeSlider.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 100, 30);
-    crossfadeTimeSlider.setRange(0.0f, 250.0f, 0.01f);
-    
-    addAndMakeVisible (&runningInfo);
-    runningInfo.setText("Stopped", juce::dontSendNotification);
-    
-    addAndMakeVisible (&timeInfo);
-    
-    addAndMakeVisible (&startStop);
-    startStop.setButtonText ("START");
-    startStop.onClick = [this] { startStopButtonClicked(); };
-}
-
-ReversatronAudioProcessorEditor::~ReversatronAudioProcessorEditor()
-{
-	
-}
-
-//==============================================================================
-void ReversatronAudioProcessorEditor::paint (juce::Graphics& g)
-{
-    // (Our component is opaque, so we must completely fill the background with a solid colour)
-    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
-
-    g.setColour (juce::Colours::white);
-}
-
-void ReversatronAudioProcessorEditor::resized()
-{
-    // This is generally where you'll want to lay out the positions of any
-    // subcomponents in your editor..
-    bufferLengthLabel.setBounds(50, 10, 100, 20);
-    crossfadeTimeLabel.setBounds(200, 10, 100, 20);
-    bufferLengthSlider.setBounds(50, 30, 100, 100);
-    crossfadeTimeSlider.setBounds(200, 30, 100, 100);
-    startStop.setBounds(50, 150, 100,30);
-    runningInfo.setBounds(50, 200, 250, 20);
-    timeInfo.setBounds(50, 250, 250, 20);
-}
-
-void ReversatronAudioProcessorEditor::startStopButtonClicked()
-{
-	if (audioProcessor.status == audioProcessor.RECORDING || audioProcessor.status == audioProcessor.PLAYBACK)
-	{
-		startStop.setButtonText ("START");
-		audioProcessor.status = audioProcessor.STOPPED;
-		runningInfo.setText("Stopped", juce::dontSendNotification);
-		timeInfo.setText("Countdown: (Stopped)", juce::dontSendNotification);
-		stopTimer();
-		bufferLengthSlider.setEnabled(true);
-		crossfadeTimeSlider.setEnabled(true);
-	}
-	else if (audioProcessor.status == audioProcessor.STOPPED)
-	{
-		float timeInSeconds = *audioProcessor.getApvts().getRawParameterValue("bufferLength");
-		if (timeInSeconds < 0.5f)
-			timeInSeconds = 0.5f;
-		else if (timeInSeconds > 500.0f)
-			timeInSeconds = 500.0f;
-		
-		float crossfade = *audioProcessor.getApvts().getRawParameterValue("crossfadeTime");
-		if (crossfade < 0.0f)
-			crossfade = 0.0f;
-		else if (crossfade > 250.0f)
-			crossfade = 250.0f;
-		
-		audioProcessor.crossfadeTime = crossfade;
-		audioProcessor.setupAudioBuffer(timeInSeconds);
-		startStop.setButtonText ("STOP");
-		audioProcessor.status = audioProcessor.RECORDING;
-		audioProcessor.frame = 0;
-		startTimerHz(10);
-		
-		bufferLengthSlider.setEnabled(false);
-		crossfadeTimeSlider.setEnabled(false);
-	}
-	
-}
-
-void ReversatronAudioProcessorEditor::timerCallback()
-{
-	if (audioProcessor.status == audioProcessor.RECORDING)
-	{
-		runningInfo.setText("Now recording", juce::dontSendNotification);
-		timeInfo.setText("Countdown: " + juce::String(static_cast<int>(audioProcessor.seconds - (audioProcessor.frame / audioProcessor.sampleRate))), juce::dontSendNotification);
-	}
-	else if (audioProcessor.status == audioProcessor.PLAYBACK)
-	{
-		runningInfo.setText("Now playing back reversed", juce::dontSendNotification);
-		timeInfo.setText("Countdown: " + juce::String(static_cast<int>(audioProcessor.seconds - (audioProcessor.frame / audioProcessor.sampleRate))), juce::dontSendNotification);
-	}
-	else if (audioProcessor.status == audioProcessor.STOPPED)
-	{
-		runningInfo.setText("Stopped", juce::dontSendNotification);
-		timeInfo.setText("Countdown: (Stopped)", juce::dontSendNotification);
-	}
-}
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin editor.
+
+  ==============================================================================
+*/
+
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+
+//==============================================================================
+ReversatronAudioProcessorEditor::ReversatronAudioProcessorEditor (ReversatronAudioProcessor& p)
+    : AudioProcessorEditor (&p), audioProcessor (p), waveformView (p)
+{
+    // Make sure that before the constructor has finished, you've set the
+    // editor's size to whatever you need it to be.
+    setSize (500, 530);
+    
+    bufferLengthSliderAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.getApvts(), "bufferLength", bufferLengthSlider);
+    crossfadeTimeSliderAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.getApvts(), "crossfadeTime", crossfadeTimeSlider);
+    playbackSpeedSliderAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.getApvts(), "playbackSpeed", playbackSpeedSlider);
+    
+    addAndMakeVisible (&bufferLengthLabel);
+    bufferLengthLabel.setText("Buffer Length (s)", juce::dontSendNotification);
+    addAndMakeVisible (&crossfadeTimeLabel);
+    crossfadeTimeLabel.setText("Crossfade (s)", juce::dontSendNotification);
+    addAndMakeVisible (&storageLabel);
+    storageLabel.setText("Storage", juce::dontSendNotification);
+    addAndMakeVisible (&playbackSpeedLabel);
+    playbackSpeedLabel.setText("Playback Speed (x)", juce::dontSendNotification);
+    
+    addAndMakeVisible (&bufferLengthSlider);
+    bufferLengthSlider.setSliderStyle(juce::Slider::RotaryVerticalDrag);
+    bufferLengthSlider.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 100, 30);
+    bufferLengthSlider.setRange(0.5f, 500.0f, 0.01f);
+    
+    addAndMakeVisible (&crossfadeTimeSlider);
+    crossfadeTimeSlider.setSliderStyle(juce::Slider::RotaryVerticalDrag);
+    crossfadeTimeSlider.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 100, 30);
+    crossfadeTimeSlider.setRange(0.0f, 250.0f, 0.01f);
+    
+    // Range and skew come from the parameter, via the attachment.
+    addAndMakeVisible (&playbackSpeedSlider);
+    playbackSpeedSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    playbackSpeedSlider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 45, 20);
+    
+    addAndMakeVisible (&storageBox);
+    storageBox.addItemList(audioProcessor.getApvts().getParameter("storage")->getAllValueStrings(), 1);
+    storageBoxAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(audioProcessor.getApvts(), "storage", storageBox);
+    
+    addAndMakeVisible (&captureFormatBox);
+    captureFormatBox.addItemList(audioProcessor.getApvts().getParameter("captureFormat")->getAllValueStrings(), 1);
+    captureFormatBoxAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(audioProcessor.getApvts(), "captureFormat", captureFormatBox);
+    
+    addAndMakeVisible (&modeBox);
+    modeBox.addItemList(audioProcessor.getApvts().getParameter("mode")->getAllValueStrings(), 1);
+    modeBoxAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(audioProcessor.getApvts(), "mode", modeBox);
+    
+    addAndMakeVisible (&interpolationBox);
+    interpolationBox.addItemList(audioProcessor.getApvts().getParameter("interpolation")->getAllValueStrings(), 1);
+    interpolationBoxAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(audioProcessor.getApvts(), "interpolation", interpolationBox);
+    
+    addAndMakeVisible (&sliceLengthBox);
+    sliceLengthBox.addItemList(audioProcessor.getApvts().getParameter("sliceLength")->getAllValueStrings(), 1);
+    sliceLengthBoxAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(audioProcessor.getApvts(), "sliceLength", sliceLengthBox);
+    
+    addAndMakeVisible (&runningInfo);
+    runningInfo.setText("Stopped", juce::dontSendNotification);
+    
+    addAndMakeVisible (&timeInfo);
+    
+    addAndMakeVisible (&dspInfo);
+    dspInfo.setJustificationType (juce::Justification::centredRight);
+    
+    addAndMakeVisible (&memoryInfo);
+    
+    // The budget is shared by every instance, so it's a setting rather than
+    // a parameter.
+    addAndMakeVisible (&memoryBudgetBox);
+    memoryBudgetBox.setTooltip ("Memory budget for every ReversaTron instance");
+    
+    for (auto megabytes : { 0, 256, 512, 1024, 2048, 4096, 8192, 16384 })
+        memoryBudgetBox.addItem (megabytes == 0 ? "No limit" : juce::File::descriptionOfSizeInBytes ((juce::int64) megabytes << 20), megabytes + 1);
+    
+    memoryBudgetBox.setSelectedId ((int) (audioProcessor.getMemoryBudget() >> 20) + 1, juce::dontSendNotification);
+    memoryBudgetBox.onChange = [this] { audioProcessor.setMemoryBudget ((juce::int64) (memoryBudgetBox.getSelectedId() - 1) << 20); };
+    
+    addAndMakeVisible (&waveformView);
+    
+    addAndMakeVisible (&startStop);
+    startStop.setButtonText ("START");
+    startStop.onClick = [this] { startStopButtonClicked(); };
+    
+    addAndMakeVisible (&retrigger);
+    retrigger.setButtonText ("RETRIGGER");
+    retrigger.onClick = [this] { audioProcessor.retriggerTake(); };
+    
+    addAndMakeVisible (&reverseNow);
+    reverseNow.setButtonText ("REVERSE NOW");
+    reverseNow.onClick = [this] { audioProcessor.switchToPlayback(); };
+    
+    // Auto-record: the threshold is in dB and the pre-roll in ms. Ranges
+    // come from the parameters, via the attachments.
+    addAndMakeVisible (&triggerLabel);
+    triggerLabel.setText("Trigger", juce::dontSendNotification);
+    
+    addAndMakeVisible (&triggerBox);
+    triggerBox.addItemList(audioProcessor.getApvts().getParameter("trigger")->getAllValueStrings(), 1);
+    triggerBoxAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(audioProcessor.getApvts(), "trigger", triggerBox);
+    
+    addAndMakeVisible (&triggerThresholdSlider);
+    triggerThresholdSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    triggerThresholdSlider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 45, 20);
+    triggerThresholdSlider.setTooltip("Trigger threshold (dB)");
+    triggerThresholdSliderAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.getApvts(), "triggerThreshold", triggerThresholdSlider);
+    
+    addAndMakeVisible (&preRollSlider);
+    preRollSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    preRollSlider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 45, 20);
+    preRollSlider.setTooltip("Pre-roll (ms)");
+    preRollSliderAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.getApvts(), "preRoll", preRollSlider);
+    
+    // Layered playback: how many reverse voices, and for the one picked in
+    // the box, where it starts (ms), its gain (dB), how long it plays and
+    // its fade (s).
+    addAndMakeVisible (&voicesLabel);
+    voicesLabel.setText("Voices", juce::dontSendNotification);
+    
+    for (auto* slider : { &voicesSlider, &voiceOffsetSlider, &voiceGainSlider, &voiceLengthSlider, &voiceFadeSlider })
+    {
+        addAndMakeVisible (slider);
+        slider->setSliderStyle(juce::Slider::LinearHorizontal);
+        slider->setTextBoxStyle(juce::Slider::TextBoxRight, false, 45, 20);
+    }
+    
+    voiceOffsetSlider.setTooltip("Voice offset (ms)");
+    voiceGainSlider.setTooltip("Voice gain (dB)");
+    voiceLengthSlider.setTooltip("Voice length (s), 0 to play to the end of the take");
+    voiceFadeSlider.setTooltip("Voice fade (s)");
+    voicesSliderAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.getApvts(), "voices", voicesSlider);
+    
+    addAndMakeVisible (&voiceSlotBox);
+    
+    for (int voice = 2; voice <= ReverseVoicePool::maxVoices; ++voice)
+        voiceSlotBox.addItem("Voice " + juce::String(voice), voice);
+    
+    voiceSlotBox.onChange = [this] { showVoiceParameters (voiceSlotBox.getSelectedId()); };
+    voiceSlotBox.setSelectedId(2, juce::sendNotificationSync);
+    
+    // In retroactive mode, each REVERSE NOW also goes into the bank, and
+    // these play the takes in it again.
+    addAndMakeVisible (&bankLabel);
+    bankLabel.setText("Bank", juce::dontSendNotification);
+    
+    for (int i = 0; i < (int) bankButtons.size(); ++i)
+    {
+        auto& button = bankButtons[(size_t) i];
+        addAndMakeVisible (&button);
+        button.setButtonText (juce::String (i + 1));
+        button.onClick = [this, i] { audioProcessor.recallTake (i); };
+    }
+    
+    // Exports the running take to a file, while it carries on running.
+    addAndMakeVisible (&exportButton);
+    exportButton.setButtonText ("EXPORT");
+    exportButton.onClick = [this] { exportButtonClicked(); };
+    
+    addAndMakeVisible (&exportReversedToggle);
+    exportReversedToggle.setButtonText ("Reversed");
+    exportReversedToggle.setToggleState (true, juce::dontSendNotification);
+    
+    // The editor can be reopened part way through a take.
+    setTakeControlsRunning(audioProcessor.isTakeRunning());
+    
+    // The DSP load is shown whether or not a take is running.
+    startTimerHz(10);
+}
+
+ReversatronAudioProcessorEditor::~ReversatronAudioProcessorEditor()
+{
+	
+}
+
+//==============================================================================
+void ReversatronAudioProcessorEditor::paint (juce::Graphics& g)
+{
+    // (Our component is opaque, so we must completely fill the background with a solid colour)
+    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
+
+    g.setColour (juce::Colours::white);
+}
+
+void ReversatronAudioProcessorEditor::resized()
+{
+    // This is generally where you'll want to lay out the positions of any
+    // subcomponents in your editor..
+    bufferLengthLabel.setBounds(50, 10, 100, 20);
+    crossfadeTimeLabel.setBounds(200, 10, 100, 20);
+    bufferLengthSlider.setBounds(50, 30, 100, 100);
+    crossfadeTimeSlider.setBounds(200, 30, 100, 100);
+    storageLabel.setBounds(350, 10, 120, 20);
+    storageBox.setBounds(350, 30, 120, 25);
+    captureFormatBox.setBounds(350, 65, 120, 25);
+    modeBox.setBounds(350, 100, 120, 25);
+    interpolationBox.setBounds(350, 135, 120, 25);
+    playbackSpeedLabel.setBounds(350, 165, 140, 20);
+    playbackSpeedSlider.setBounds(350, 185, 140, 25);
+    sliceLengthBox.setBounds(350, 220, 120, 25);
+    memoryInfo.setBounds(50, 225, 180, 20);
+    memoryBudgetBox.setBounds(235, 222, 105, 25);
+    startStop.setBounds(50, 150, 100,30);
+    retrigger.setBounds(160, 150, 80, 30);
+    reverseNow.setBounds(250, 150, 90, 30);
+    runningInfo.setBounds(50, 200, 250, 20);
+    timeInfo.setBounds(50, 250, 250, 20);
+    dspInfo.setBounds(300, 250, 190, 20);
+    bankLabel.setBounds(50, 282, 45, 20);
+    
+    for (int i = 0; i < (int) bankButtons.size(); ++i)
+        bankButtons[(size_t) i].setBounds(100 + 50 * i, 280, 45, 25);
+    
+    exportButton.setBounds(310, 280, 90, 25);
+    exportReversedToggle.setBounds(405, 280, 85, 25);
+    
+    triggerLabel.setBounds(50, 317, 45, 20);
+    triggerBox.setBounds(100, 315, 100, 25);
+    triggerThresholdSlider.setBounds(210, 315, 140, 25);
+    preRollSlider.setBounds(360, 315, 130, 25);
+    voicesLabel.setBounds(50, 352, 45, 20);
+    voicesSlider.setBounds(100, 350, 100, 25);
+    voiceSlotBox.setBounds(210, 350, 90, 25);
+    voiceOffsetSlider.setBounds(310, 350, 180, 25);
+    voiceGainSlider.setBounds(100, 385, 130, 25);
+    voiceLengthSlider.setBounds(240, 385, 125, 25);
+    voiceFadeSlider.setBounds(375, 385, 115, 25);
+    waveformView.setBounds(10, 420, 480, 100);
+}
+
+void ReversatronAudioProcessorEditor::showVoiceParameters(int voice)
+{
+    // The old attachments have to go before the new ones are made.
+    auto& apvts = audioProcessor.getApvts();
+    voiceOffsetSliderAttachment.reset();
+    voiceGainSliderAttachment.reset();
+    voiceLengthSliderAttachment.reset();
+    voiceFadeSliderAttachment.reset();
+    
+    voiceOffsetSliderAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(apvts, ReversatronAudioProcessor::getVoiceParameterID(voice, "Offset"), voiceOffsetSlider);
+    voiceGainSliderAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(apvts, ReversatronAudioProcessor::getVoiceParameterID(voice, "Gain"), voiceGainSlider);
+    voiceLengthSliderAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(apvts, ReversatronAudioProcessor::getVoiceParameterID(voice, "Length"), voiceLengthSlider);
+    voiceFadeSliderAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(apvts, ReversatronAudioProcessor::getVoiceParameterID(voice, "Fade"), voiceFadeSlider);
+}
+
+void ReversatronAudioProcessorEditor::startStopButtonClicked()
+{
+	if (audioProcessor.isTakeRunning())
+	{
+		audioProcessor.stopTake();
+		setTakeControlsRunning(false);
+	}
+	else
+	{
+		float timeInSeconds = *audioProcessor.getApvts().getRawParameterValue("bufferLength");
+		if (timeInSeconds < 0.5f)
+			timeInSeconds = 0.5f;
+		else if (timeInSeconds > 500.0f)
+			timeInSeconds = 500.0f;
+		
+		float crossfade = *audioProcessor.getApvts().getRawParameterValue("crossfadeTime");
+		if (crossfade < 0.0f)
+			crossfade = 0.0f;
+		else if (crossfade > 250.0f)
+			crossfade = 250.0f;
+		
+		audioProcessor.startTake(timeInSeconds, crossfade);
+		setTakeControlsRunning(true);
+	}
+	
+}
+
+void ReversatronAudioProcessorEditor::setTakeControlsRunning(bool running)
+{
+	if (running)
+	{
+		startStop.setButtonText ("STOP");
+	}
+	else
+	{
+		startStop.setButtonText ("START");
+		runningInfo.setText("Stopped", juce::dontSendNotification);
+		timeInfo.setText("Countdown: (Stopped)", juce::dontSendNotification);
+	}
+	
+	// Slices follow the host's beat grid, so there's nothing to retrigger.
+	retrigger.setEnabled(running && modeBox.getSelectedItemIndex() != 2);
+	// Ping-pong periods always run for the whole take length. The length
+	// and crossfade stay live, as the running take follows them.
+	reverseNow.setEnabled(running && (modeBox.getSelectedItemIndex() == 0 || modeBox.getSelectedItemIndex() == 3));
+	updateBankButtons();
+	updateExportButton();
+	storageBox.setEnabled(! running);
+	captureFormatBox.setEnabled(! running);
+	modeBox.setEnabled(! running);
+}
+
+void ReversatronAudioProcessorEditor::timerCallback()
+{
+	updateDspInfo();
+	updateMemoryInfo();
+	updateBankButtons();
+	updateExportButton();
+	
+	// The last snapshot can still show a take that has just been stopped.
+	if (! audioProcessor.isTakeRunning())
+		return;
+	
+	// Everything shown here comes from the snapshot the audio thread
+	// publishes at the end of each block.
+	// A take records up to its loop boundary, and plays back to the end of
+	// the buffer.
+	const auto transport = audioProcessor.getTransportSnapshot();
+	auto secondsLeft = static_cast<int>((transport.takeLength - static_cast<double>(transport.frame)) / transport.sampleRate);
+	
+	// Playback runs through the take at the playback speed.
+	if (transport.status == ReversatronAudioProcessor::PLAYBACK)
+		secondsLeft = static_cast<int>((transport.bufferLength - static_cast<double>(transport.frame))
+		                               / (transport.sampleRate * *audioProcessor.getApvts().getRawParameterValue("playbackSpeed")));
+	
+	if (audioProcessor.isAwaitingBuffer())
+	{
+		runningInfo.setText("Preparing buffer", juce::dontSendNotification);
+		timeInfo.setText("Countdown: " + juce::String(static_cast<int>(*audioProcessor.getApvts().getRawParameterValue("bufferLength"))), juce::dontSendNotification);
+	}
+	else if (transport.status == ReversatronAudioProcessor::RECORDING)
+	{
+		runningInfo.setText("Now recording", juce::dontSendNotification);
+		timeInfo.setText("Countdown: " + juce::String(secondsLeft), juce::dontSendNotification);
+	}
+	else if (transport.status == ReversatronAudioProcessor::PLAYBACK)
+	{
+		runningInfo.setText("Now playing back reversed", juce::dontSendNotification);
+		timeInfo.setText("Countdown: " + juce::String(secondsLeft), juce::dontSendNotification);
+	}
+	else if (transport.status == ReversatronAudioProcessor::CONTINUOUS)
+	{
+		runningInfo.setText("Recording, playing back the last take reversed", juce::dontSendNotification);
+		timeInfo.setText("Next swap: " + juce::String(secondsLeft), juce::dontSendNotification);
+	}
+	else if (transport.status == ReversatronAudioProcessor::SLICING)
+	{
+		runningInfo.setText("Reversing slices", juce::dontSendNotification);
+		timeInfo.setText("Latency: " + juce::String(juce::roundToInt(1000.0 * audioProcessor.getLatencySamples() / transport.sampleRate)) + " ms", juce::dontSendNotification);
+	}
+	else if (transport.status == ReversatronAudioProcessor::CAPTURING)
+	{
+		if (transport.bankSlot >= 0)
+			runningInfo.setText("Playing bank take " + juce::String(transport.bankSlot + 1) + " reversed", juce::dontSendNotification);
+		else
+			runningInfo.setText("Listening, ready to reverse", juce::dontSendNotification);
+		
+		timeInfo.setText(transport.bankSlot >= 0 ? "Countdown: " + juce::String(secondsLeft) : "Countdown: (Listening)", juce::dontSendNotification);
+	}
+	else if (transport.status == ReversatronAudioProcessor::ARMED)
+	{
+		runningInfo.setText("Waiting for input", juce::dontSendNotification);
+		timeInfo.setText("Countdown: (Armed)", juce::dontSendNotification);
+	}
+	else if (transport.status == ReversatronAudioProcessor::STOPPED)
+	{
+		runningInfo.setText("Stopped", juce::dontSendNotification);
+		timeInfo.setText("Countdown: (Stopped)", juce::dontSendNotification);
+	}
+}
+
+void ReversatronAudioProcessorEditor::updateDspInfo()
+{
+	const auto stats = audioProcessor.getDspLoadStats();
+	
+	auto text = "DSP " + juce::String(juce::roundToInt(stats.averageLoad * 100.0f)) + "%"
+	          + " (peak " + juce::String(juce::roundToInt(stats.peakLoad * 100.0f)) + "%)";
+	
+	if (stats.numOverruns > 0)
+		text << ", " << juce::String((juce::int64) stats.numOverruns) << " late";
+	
+	if (stats.numNonFiniteBlocks > 0)
+		text << ", NaN/inf!";
+	
+	// Input lost because the memory budget ran out or the disk fell behind.
+	if (stats.numDroppedSamples > 0)
+		text << ", dropped " << juce::String((juce::int64) stats.numDroppedSamples);
+	
+	// The host saved the session without the running take.
+	const auto saveFailed = audioProcessor.didLastTakeSaveFail();
+	
+	if (saveFailed)
+		text << ", take not saved!";
+	
+	dspInfo.setText(text, juce::dontSendNotification);
+	dspInfo.setColour(juce::Label::textColourId, stats.numOverruns > 0 || stats.numNonFiniteBlocks > 0 || stats.numDroppedSamples > 0 || saveFailed
+	                                                 ? juce::Colours::orange
+	                                                 : juce::Colours::white);
+}
+
+void ReversatronAudioProcessorEditor::updateBankButtons()
+{
+	// Only takes captured since the ring was last reset can be recalled.
+	const auto transport = audioProcessor.getTransportSnapshot();
+	const auto canRecall = audioProcessor.isTakeRunning() && modeBox.getSelectedItemIndex() == 3;
+	
+	for (int i = 0; i < (int) bankButtons.size(); ++i)
+	{
+		auto& button = bankButtons[(size_t) i];
+		button.setEnabled(canRecall && (transport.bankTakes & (1u << i)) != 0);
+		button.setToggleState(canRecall && transport.bankSlot == i, juce::dontSendNotification);
+	}
+}
+
+void ReversatronAudioProcessorEditor::exportButtonClicked()
+{
+	// While an export runs, the button cancels it.
+	if (audioProcessor.getExportProgress().isRunning)
+	{
+		audioProcessor.cancelExport();
+		return;
+	}
+	
+	const auto possible = audioProcessor.canExportTake();
+	
+	if (possible.failed())
+	{
+		juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::InfoIcon, "Export", possible.getErrorMessage());
+		return;
+	}
+	
+	const auto reversed = exportReversedToggle.getToggleState();
+	const auto defaultFile = juce::File::getSpecialLocation(juce::File::userMusicDirectory)
+	                             .getChildFile(reversed ? "ReversaTron take (reversed).wav" : "ReversaTron take.wav");
+	
+	exportChooser = std::make_unique<juce::FileChooser>("Export take", defaultFile, "*.wav;*.flac");
+	exportChooser->launchAsync(juce::FileBrowserComponent::saveMode
+	                             | juce::FileBrowserComponent::canSelectFiles
+	                             | juce::FileBrowserComponent::warnAboutOverwriting,
+	                           [this, reversed] (const juce::FileChooser& chooser)
+	{
+		auto file = chooser.getResult();
+		
+		if (file == juce::File())
+			return;
+		
+		if (! file.hasFileExtension("wav;flac"))
+			file = file.withFileExtension("wav");
+		
+		const auto result = audioProcessor.exportTake(file, reversed);
+		
+		if (result.failed())
+			juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon, "Export", result.getErrorMessage());
+		
+		updateExportButton();
+	});
+}
+
+void ReversatronAudioProcessorEditor::updateExportButton()
+{
+	// The button stays enabled in slice reverse, so that clicking it says
+	// why there's nothing to export.
+	const auto progress = audioProcessor.getExportProgress();
+	
+	if (progress.isWaitingForTake)
+	{
+		exportButton.setButtonText("WAITING");
+		exportButton.setEnabled(true);
+	}
+	else if (progress.isRunning)
+	{
+		exportButton.setButtonText("CANCEL " + juce::String(juce::roundToInt(progress.proportion * 100.0f)) + "%");
+		exportButton.setEnabled(true);
+	}
+	else
+	{
+		exportButton.setButtonText("EXPORT");
+		exportButton.setEnabled(audioProcessor.isTakeRunning());
+		
+		if (wasExporting && progress.error.isNotEmpty())
+			juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon, "Export failed", progress.error);
+	}
+	
+	wasExporting = progress.isRunning;
+}
+
+void ReversatronAudioProcessorEditor::updateMemoryInfo()
+{
+	const auto usage = audioProcessor.getMemoryUsage();
+	
+	auto text = "Memory " + juce::File::descriptionOfSizeInBytes(usage.numBytes);
+	
+	if (usage.shared.numAccounts > 1)
+		text << " (all " << juce::File::descriptionOfSizeInBytes(usage.shared.numBytes) << ")";
+	
+	memoryInfo.setText(text, juce::dontSendNotification);
+	memoryInfo.setColour(juce::Label::textColourId, usage.shared.numRefused > 0
+	                                                    ? juce::Colours::orange
+	                                                    : juce::Colours::white);
+}
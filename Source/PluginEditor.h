@@ -1,48 +1,102 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin editor.
-
-  ==============================================================================
-*/
-
-#pragma once
-
-#include <JuceHeader.h>
-#include "PluginProcessor.h"
-
-//==============================================================================
-/**
-*/
-class ReversatronAudioProcessorEditor  : public juce::AudioProcessorEditor
-													, juce::Timer
-{
-public:
-    ReversatronAudioProcessorEditor (ReversatronAudioProcessor&);
-    ~ReversatronAudioProcessorEditor() override;
-
-    //==============================================================================
-    void paint (juce::Graphics&) override;
-    void resized() override;
-    void startTimer();
-    void timerCallback() override;
-    void startStopButtonClicked();
-
-private:
-    // This reference is provided as a quick way for your editor to
-    // access the processor object that created it.
-    ReversatronAudioProcessor& audioProcessor;
-    
-    juce::Slider bufferLengthSlider;
-    juce::Slider crossfadeTimeSlider;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> bufferLengthSliderAttachment;
-    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> crossfadeTimeSliderAttachment;
-    
-    juce::Label bufferLengthLabel;
-    juce::Label crossfadeTimeLabel;
-    juce::TextButton startStop;
-    juce::Label runningInfo;
-    juce::Label timeInfo;
-
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ReversatronAudioProcessorEditor)
-};
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "WaveformView.h"
+
+//==============================================================================
+/**
+*/
+class ReversatronAudioProcessorEditor  : public juce::AudioProcessorEditor
+													, juce::Timer
+{
+public:
+    ReversatronAudioProcessorEditor (ReversatronAudioProcessor&);
+    ~ReversatronAudioProcessorEditor() override;
+
+    //==============================================================================
+    void paint (juce::Graphics&) override;
+    void resized() override;
+    void startTimer();
+    void timerCallback() override;
+    void startStopButtonClicked();
+    void setTakeControlsRunning(bool running);
+    void updateDspInfo();
+    void updateMemoryInfo();
+    void updateBankButtons();
+    void exportButtonClicked();
+    void updateExportButton();
+    void showVoiceParameters(int voice);
+
+private:
+    // This reference is provided as a quick way for your editor to
+    // access the processor object that created it.
+    ReversatronAudioProcessor& audioProcessor;
+    
+    juce::Slider bufferLengthSlider;
+    juce::Slider crossfadeTimeSlider;
+    juce::Slider playbackSpeedSlider;
+    juce::Slider triggerThresholdSlider;
+    juce::Slider preRollSlider;
+    juce::Slider voicesSlider;
+    juce::Slider voiceOffsetSlider;
+    juce::Slider voiceGainSlider;
+    juce::Slider voiceLengthSlider;
+    juce::Slider voiceFadeSlider;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> bufferLengthSliderAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> crossfadeTimeSliderAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> playbackSpeedSliderAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> triggerThresholdSliderAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> preRollSliderAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> voicesSliderAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> voiceOffsetSliderAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> voiceGainSliderAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> voiceLengthSliderAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> voiceFadeSliderAttachment;
+    
+    juce::ComboBox storageBox;
+    juce::ComboBox captureFormatBox;
+    juce::ComboBox modeBox;
+    juce::ComboBox interpolationBox;
+    juce::ComboBox sliceLengthBox;
+    juce::ComboBox memoryBudgetBox;
+    juce::ComboBox triggerBox;
+    juce::ComboBox voiceSlotBox;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> storageBoxAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> captureFormatBoxAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> modeBoxAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> interpolationBoxAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> sliceLengthBoxAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> triggerBoxAttachment;
+    
+    juce::Label bufferLengthLabel;
+    juce::Label crossfadeTimeLabel;
+    juce::Label storageLabel;
+    juce::Label playbackSpeedLabel;
+    juce::Label triggerLabel;
+    juce::Label voicesLabel;
+    juce::TextButton startStop;
+    juce::TextButton retrigger;
+    juce::TextButton reverseNow;
+    juce::Label bankLabel;
+    std::array<juce::TextButton, RetroCapture::numBankSlots> bankButtons;
+    juce::TextButton exportButton;
+    juce::ToggleButton exportReversedToggle;
+    std::unique_ptr<juce::FileChooser> exportChooser;
+    bool wasExporting = false;
+    juce::Label runningInfo;
+    juce::Label timeInfo;
+    juce::Label dspInfo;
+    juce::Label memoryInfo;
+    WaveformView waveformView;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ReversatronAudioProcessorEditor)
+};
@@ -1,314 +1,1719 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin processor.
-
-  ==============================================================================
-*/
-
-#include "PluginProcessor.h"
-#include "PluginEditor.h"
-//#include <iostream>
-
-//==============================================================================
-ReversatronAudioProcessor::ReversatronAudioProcessor()
-#ifndef JucePlugin_PreferredChannelConfigurations
-     : AudioProcessor (BusesProperties()
-                     #if ! JucePlugin_IsMidiEffect
-                      #if ! JucePlugin_IsSynth
-                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
-                      #endif
-                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
-                     #endif
-                       ),
-                       apvts(*this, nullptr, "Parameters", addParameters())
-#endif
-{
-	apvts.state = juce::ValueTree("Parameters");
-	seconds = 10.0f;
-	status = STOPPED;
-	frame = 0;
-	sampleRate = 44100.0;
-}
-
-ReversatronAudioProcessor::~ReversatronAudioProcessor()
-{
-}
-
-//==============================================================================
-const juce::String ReversatronAudioProcessor::getName() const
-{
-    return JucePlugin_Name;
-}
-
-bool ReversatronAudioProcessor::acceptsMidi() const
-{
-   #if JucePlugin_WantsMidiInput
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-bool ReversatronAudioProcessor::producesMidi() const
-{
-   #if JucePlugin_ProducesMidiOutput
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-bool ReversatronAudioProcessor::isMidiEffect() const
-{
-   #if JucePlugin_IsMidiEffect
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-double ReversatronAudioProcessor::getTailLengthSeconds() const
-{
-    return 0.0;
-}
-
-int ReversatronAudioProcessor::getNumPrograms()
-{
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
-}
-
-int ReversatronAudioProcessor::getCurrentProgram()
-{
-    return 0;
-}
-
-void ReversatronAudioProcessor::setCurrentProgram (int index)
-{
-}
-
-const juce::String ReversatronAudioProcessor::getProgramName (int index)
-{
-    return {};
-}
-
-void ReversatronAudioProcessor::changeProgramName (int index, const juce::String& newName)
-{
-}
-
-//==============================================================================
-void ReversatronAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
-{
-    // Use this method as the place to do any pre-playback
-    // initialisation that you need..
-    reversatronBuffer.setSize(getTotalNumInputChannels(), static_cast<int> (getSampleRate() * seconds));
-    sampleRate = getSampleRate();
-    //std::cout << "Buffer Channels: " << std::to_string(reversatronBuffer.getNumChannels()) << std::endl;
-	//std::cout << "Buffer Size: " << std::to_string(reversatronBuffer.getNumSamples()) << std::endl;
-	//std::cout << "Sample Rate: " << std::to_string(sampleRate) << std::endl;
-}
-
-void ReversatronAudioProcessor::releaseResources()
-{
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
-}
-
-#ifndef JucePlugin_PreferredChannelConfigurations
-bool ReversatronAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
-{
-  #if JucePlugin_IsMidiEffect
-    juce::ignoreUnused (layouts);
-    return true;
-  #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
-        return false;
-
-    // This checks if the input layout matches the output layout
-   #if ! JucePlugin_IsSynth
-    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
-        return false;
-   #endif
-
-    return true;
-  #endif
-}
-#endif
-
-void ReversatronAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
-{
-    juce::ScopedNoDenormals noDenormals;
-    auto totalNumInputChannels  = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
-
-    // In case we have more outputs than inputs, this code clears any output
-    // channels that didn't contain input data, (because these aren't
-    // guaranteed to be empty - they may contain garbage).
-    // This is here to avoid people getting screaming feedback
-    // when they first compile a plugin, but obviously you don't need to keep
-    // this code if your algorithm always overwrites all the output channels.
-    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
-        buffer.clear (i, 0, buffer.getNumSamples());
-
-    // This is the place where you'd normally do the guts of your plugin's
-    // audio processing...
-    // Make sure to reset the state if your inner loop is processing
-    // the samples and the outer loop is handling the channels.
-    // Alternatively, you can process the samples with the channels
-    // interleaved by keeping the same state.
-    
-    
-    uint64_t numSamples = buffer.getNumSamples();
-    uint64_t initialFrame = frame;
-    
-    float crossfade = crossfadeTime;
-    double currentSampleRate = getSampleRate();
-    if ( ( crossfade * currentSampleRate ) > (reversatronBuffer.getNumSamples() / 2))
-    {
-        crossfade = (reversatronBuffer.getNumSamples() / 2) / currentSampleRate;
-    }
-    
-    if (status == RECORDING)
-    {
-		for (int channel = 0; channel < totalNumInputChannels; ++channel)
-		{
-			auto* channelData = buffer.getReadPointer (channel);
-			
-			frame = initialFrame;
-
-			for (int sample = 0; sample < numSamples ; ++sample)
-			{
-				if (frame < reversatronBuffer.getNumSamples())
-				{
-					reversatronBuffer.setSample(channel, frame, buffer.getSample(channel, sample));
-					frame++;
-				}
-			}
-		}
-	}
-	
-	else if (status == PLAYBACK)
-	{
-		for (int channel = 0; channel < totalNumInputChannels; ++channel)
-		{
-			auto* channelData = buffer.getWritePointer (channel);
-			
-			frame = initialFrame;
-
-			for (int sample = 0; sample < numSamples ; ++sample)
-			{
-				if (frame < reversatronBuffer.getNumSamples())
-				{
-                    if ( frame < (crossfade * currentSampleRate) )
-                    {
-						// We're within the fade time from the start of playback
-						// Fade out buffer, fade in reservatron buffer
-                        float gain = frame / (crossfade * currentSampleRate);
-                        float bufferSample = buffer.getSample(channel, sample) * (1.0f - gain);
-                        float reversatronBufferSample = reversatronBuffer.getSample(channel, reversatronBuffer.getNumSamples() - frame - 1) * gain;
-                        buffer.setSample(channel, sample, bufferSample + reversatronBufferSample);
-                    }
-                    else if (frame > (reversatronBuffer.getNumSamples() - (crossfade * currentSampleRate)))
-                    {
-						// We're within the fade time towards the end of playback
-						// Fade in buffer, fade out reservatron buffer
-                        float gain = (frame - (reversatronBuffer.getNumSamples() - (crossfade * currentSampleRate))) / (crossfade * currentSampleRate);
-                        float bufferSample = buffer.getSample(channel, sample) * gain;
-                        float reversatronBufferSample = reversatronBuffer.getSample(channel, reversatronBuffer.getNumSamples() - frame - 1) * (1.0f - gain);
-                        buffer.setSample(channel, sample, bufferSample + reversatronBufferSample);
-                    }
-					else
-                    {   
-                        buffer.setSample(channel, sample, reversatronBuffer.getSample(channel, reversatronBuffer.getNumSamples() - frame - 1));
-                    }
-					frame++;
-				}
-			}
-		}
-	}
-	
-	if (frame >= reversatronBuffer.getNumSamples())
-	{
-		frame = 0;
-		if (status == PLAYBACK)
-		{
-			status = RECORDING;
-		}
-		else if (status == RECORDING)
-		{
-			status = PLAYBACK;
-		}
-	}
-}
-
-//==============================================================================
-bool ReversatronAudioProcessor::hasEditor() const
-{
-    return true; // (change this to false if you choose to not supply an editor)
-}
-
-juce::AudioProcessorEditor* ReversatronAudioProcessor::createEditor()
-{
-    return new ReversatronAudioProcessorEditor (*this);
-}
-
-//==============================================================================
-void ReversatronAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
-{
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
-    auto state = apvts.copyState();
-    std::unique_ptr<juce::XmlElement> xml (state.createXml());
-    copyXmlToBinary(*xml, destData);
-}
-
-void ReversatronAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
-{
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
-    std::unique_ptr<juce::XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
-    if (xmlState.get() != nullptr)
-        if (xmlState->hasTagName (apvts.state.getType()))
-            apvts.replaceState (juce::ValueTree::fromXml (*xmlState));
-}
-
-juce::AudioProcessorValueTreeState::ParameterLayout ReversatronAudioProcessor::addParameters()
-{
-    juce::AudioProcessorValueTreeState::ParameterLayout paramLayout;
-    
-    paramLayout.add(std::make_unique<juce::AudioParameterFloat>("bufferLength", "Buffer Length", 0.5f, 500.0f, 10.0f));
-    paramLayout.add(std::make_unique<juce::AudioParameterFloat>("crossfadeTime", "Crossfade Time", 0.0f, 250.0f, 2.0f));
-    
-    return paramLayout;
-}
-
-AudioProcessorValueTreeState& ReversatronAudioProcessor::getApvts()
-{
-    return apvts;
-}
-
-
-void ReversatronAudioProcessor::setupAudioBuffer(float timeInSeconds)
-{
-	seconds = timeInSeconds;
-	sampleRate = getSampleRate();
-	reversatronBuffer.setSize(getTotalNumInputChannels(), static_cast<int> (getSampleRate() * seconds));
-    //std::cout << "Buffer Channels: " << std::to_string(reversatronBuffer.getNumChannels()) << std::endl;
-	//std::cout << "Buffer Size: " << std::to_string(reversatronBuffer.getNumSamples()) << std::endl;
-	//std::cout << "Sample Rate: " << std::to_string(sampleRate) << std::endl;
-	
-}
-
-//==============================================================================
-// This creates new instances of the plugin..
-juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
-{
-    return new ReversatronAudioProcessor();
-}
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin processor.
+
+  ==============================================================================
+*/
+
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+#include "ReversatronKernels.h"
+//#include <iostream>
+
+//==============================================================================
+ReversatronAudioProcessor::ReversatronAudioProcessor()
+#ifndef JucePlugin_PreferredChannelConfigurations
+     : AudioProcessor (BusesProperties()
+                     #if ! JucePlugin_IsMidiEffect
+                      #if ! JucePlugin_IsSynth
+                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                      #endif
+                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
+                     #endif
+                       ),
+                       apvts(*this, nullptr, "Parameters", addParameters())
+#endif
+{
+	apvts.state = juce::ValueTree("Parameters");
+	reversatronBuffer = std::make_unique<MemoryCaptureBuffer<float>>(0, 0, bufferAllocator.getSegmentPool());
+	playbackSpeedParameter = apvts.getRawParameterValue("playbackSpeed");
+	interpolationParameter = apvts.getRawParameterValue("interpolation");
+	modeParameter = apvts.getRawParameterValue("mode");
+	sliceLengthParameter = apvts.getRawParameterValue("sliceLength");
+	bufferLengthParameter = apvts.getRawParameterValue("bufferLength");
+	crossfadeTimeParameter = apvts.getRawParameterValue("crossfadeTime");
+	triggerParameter = apvts.getRawParameterValue("trigger");
+	triggerThresholdParameter = apvts.getRawParameterValue("triggerThreshold");
+	preRollParameter = apvts.getRawParameterValue("preRoll");
+	voicesParameter = apvts.getRawParameterValue("voices");
+	
+	for (int voice = 2; voice <= ReverseVoicePool::maxVoices; ++voice)
+	{
+		auto& parameters = voiceParameters[(size_t) (voice - 2)];
+		parameters.offset = apvts.getRawParameterValue(getVoiceParameterID(voice, "Offset"));
+		parameters.gain = apvts.getRawParameterValue(getVoiceParameterID(voice, "Gain"));
+		parameters.length = apvts.getRawParameterValue(getVoiceParameterID(voice, "Length"));
+		parameters.fade = apvts.getRawParameterValue(getVoiceParameterID(voice, "Fade"));
+	}
+	startTimer (updatePollIntervalMs);
+}
+
+ReversatronAudioProcessor::~ReversatronAudioProcessor()
+{
+    stopTimer();
+    
+    // The allocator's worker may be reading the buffer, so it's left to free it.
+    bufferAllocator.retireBuffer (reversatronBuffer.release());
+}
+
+//==============================================================================
+const juce::String ReversatronAudioProcessor::getName() const
+{
+    return JucePlugin_Name;
+}
+
+bool ReversatronAudioProcessor::acceptsMidi() const
+{
+   #if JucePlugin_WantsMidiInput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+bool ReversatronAudioProcessor::producesMidi() const
+{
+   #if JucePlugin_ProducesMidiOutput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+bool ReversatronAudioProcessor::isMidiEffect() const
+{
+   #if JucePlugin_IsMidiEffect
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+double ReversatronAudioProcessor::getTailLengthSeconds() const
+{
+    return 0.0;
+}
+
+bool ReversatronAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
+}
+
+int ReversatronAudioProcessor::getNumPrograms()
+{
+    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
+                // so this should be at least 1, even if you're not really implementing programs.
+}
+
+int ReversatronAudioProcessor::getCurrentProgram()
+{
+    return 0;
+}
+
+void ReversatronAudioProcessor::setCurrentProgram (int index)
+{
+}
+
+const juce::String ReversatronAudioProcessor::getProgramName (int index)
+{
+    return {};
+}
+
+void ReversatronAudioProcessor::changeProgramName (int index, const juce::String& newName)
+{
+}
+
+//==============================================================================
+void ReversatronAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
+{
+    // Use this method as the place to do any pre-playback
+    // initialisation that you need..
+    // The buffer is built on the allocator thread and swapped in by the
+    // first processBlock call after it's ready. Hosts call this again for all
+    // sorts of reasons, so the buffer (and the take in it) is only replaced
+    // if it no longer fits; a take running when the sample rate changes is
+    // resampled into the new buffer rather than lost.
+    const auto spec = getBufferSpec();
+    
+    if (restoredTake != nullptr)
+    {
+        restoreTake();
+    }
+    else if (spec != requestedSpec)
+    {
+        auto carryOver = takeForCarryOver (spec, sampleRate);
+        const auto oldLength = carryOver != nullptr ? carryOver->takeLength : 0;
+        
+        requestedSpec = spec;
+        pendingCarryOver.generation = bufferAllocator.requestBuffer (spec, std::move (carryOver));
+        pendingCarryOver.isActive = oldLength > 0;
+        pendingCarryOver.oldLength = oldLength;
+    }
+    
+    preparedSampleRate = sampleRate;
+    loadMonitor.reset();
+    crossfadeSmoother.reset (sampleRate, crossfadeSmoothingSeconds);
+    
+    // Hosts want the latency before playback starts, so it's worked out
+    // from the last tempo seen; the audio thread corrects it if the host's
+    // tempo turns out to be different.
+    const auto latency = isSliceModeSelected()
+                           ? getSliceLength (getSliceBeats (hostBeatsPerBar), hostBpm, sampleRate, spec.numSamples, samplesPerBlock)
+                           : 0;
+    requiredLatency = latency;
+    setLatencySamples (latency);
+    sliceMode = isSliceModeSelected();
+    retroMode = isRetroModeSelected();
+    slicer.reset();
+    retroCapture.reset (reversatronBuffer->getNumSamples());
+    bufferAllocator.getTakeArchiver().noteTakeReplaced();
+    
+    const auto numChannels = getTotalNumInputChannels();
+    const auto numWorkers = numChannels >= minChannelsForWorkers
+                              ? juce::jmin (juce::SystemStats::getNumCpus() - 1, numChannels / channelsPerWorker - 1)
+                              : 0;
+    
+    if (numWorkers <= 0)
+        channelWorkers.reset();
+    else if (channelWorkers == nullptr || channelWorkers->getNumWorkers() != numWorkers
+               || ! channelWorkers->isPreparedFor (sampleRate, samplesPerBlock))
+        channelWorkers = std::make_unique<ChannelWorkerPool> (numWorkers, sampleRate, samplesPerBlock);
+    
+    playbackScratch.allocate ((size_t) (2 * playbackScratchSize * (numWorkers + 1)), false);
+    
+    inputTrigger.prepare (sampleRate);
+    preRollCapacity = juce::jmax (1, static_cast<int> (std::ceil (maxPreRollSeconds * sampleRate)));
+    preRollRing.allocate ((size_t) (preRollCapacity * juce::jmax (1, numChannels)), false);
+    preRollFrame = 0;
+    numPreRollFrames = 0;
+    //std::cout << "Buffer Channels: " << std::to_string(reversatronBuffer.getNumChannels()) << std::endl;
+	//std::cout << "Buffer Size: " << std::to_string(reversatronBuffer.getNumSamples()) << std::endl;
+	//std::cout << "Sample Rate: " << std::to_string(sampleRate) << std::endl;
+}
+
+void ReversatronAudioProcessor::releaseResources()
+{
+    // When playback stops, you can use this as an opportunity to free up any
+    // spare memory, etc.
+}
+
+#ifndef JucePlugin_PreferredChannelConfigurations
+bool ReversatronAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
+{
+  #if JucePlugin_IsMidiEffect
+    juce::ignoreUnused (layouts);
+    return true;
+  #else
+    // This is the place where you check if the layout is supported.
+    // Any layout works, from mono up to maxChannels (7.1.4, ambisonics and
+    // so on), as long as input and output match.
+    const auto numChannels = layouts.getMainOutputChannelSet().size();
+    
+    if (numChannels == 0 || numChannels > maxChannels)
+        return false;
+
+    // This checks if the input layout matches the output layout
+   #if ! JucePlugin_IsSynth
+    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
+        return false;
+   #endif
+
+    return true;
+  #endif
+}
+#endif
+
+void ReversatronAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer&)
+{
+    processSamples (buffer);
+}
+
+void ReversatronAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer&)
+{
+    processSamples (buffer);
+}
+
+template <typename SampleType>
+void ReversatronAudioProcessor::processSamples (juce::AudioBuffer<SampleType>& buffer)
+{
+    juce::ScopedNoDenormals noDenormals;
+    const DspLoadMonitor::ScopedBlock loadMeasurement (loadMonitor, buffer, getSampleRate());
+    auto totalNumInputChannels  = getTotalNumInputChannels();
+    auto totalNumOutputChannels = getTotalNumOutputChannels();
+
+    // In case we have more outputs than inputs, this code clears any output
+    // channels that didn't contain input data, (because these aren't
+    // guaranteed to be empty - they may contain garbage).
+    // This is here to avoid people getting screaming feedback
+    // when they first compile a plugin, but obviously you don't need to keep
+    // this code if your algorithm always overwrites all the output channels.
+    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
+        buffer.clear (i, 0, buffer.getNumSamples());
+
+    installPreparedBuffer();
+    bufferAllocator.getSegmentPool().trim();
+    
+    playbackSpeed = static_cast<double> (playbackSpeedParameter->load());
+    interpolationQuality = static_cast<SampleInterpolator::Quality> (static_cast<int> (interpolationParameter->load()));
+    updateLoopTiming (buffer.getNumSamples());
+    updateTrigger();
+    
+    if (isSliceModeSelected() != sliceMode || isRetroModeSelected() != retroMode)
+    {
+        // A running take carries on in the new mode, from scratch, and the
+        // message thread is asked for a buffer that suits it.
+        sliceMode = isSliceModeSelected();
+        retroMode = isRetroModeSelected();
+        slicer.reset();
+        retroCapture.reset (reversatronBuffer->getNumSamples());
+        bufferAllocator.getTakeArchiver().noteTakeReplaced();
+        requestMessageThreadUpdate();
+        
+        if (status != STOPPED)
+        {
+            status = getRunningStatus();
+            frame = 0;
+            playbackPhase = 0.0;
+        }
+    }
+    
+    updateSliceTiming();
+
+    if (isNonRealtime())
+    {
+        // Offline there's no deadline, so rather than passing audio through
+        // or dropping samples, wait for the allocator whenever it has fallen
+        // behind.
+        const auto mustWait = bufferAllocator.getSegmentPool().needsRefill() || bufferAllocator.isRequestPending();
+
+        if (bufferAllocator.getSegmentPool().needsRefill())
+            bufferAllocator.waitForWorker();
+
+        while (bufferAllocator.isRequestPending())
+        {
+            bufferAllocator.waitForWorker();
+            installPreparedBuffer();
+        }
+
+        if (mustWait)
+            loadMonitor.noteBlockWaited();
+    }
+
+    const auto numSamples = buffer.getNumSamples();
+    const auto blockStart = samplesProcessed;
+    samplesProcessed += numSamples;
+
+    // While a new buffer is being prepared the input just passes through,
+    // but commands are still applied so the transport is where the editor
+    // expects once the buffer arrives.
+    if (bufferAllocator.isRequestPending())
+    {
+        applyTransportCommands (blockStart, numSamples, numSamples);
+        publishTransportState();
+        return;
+    }
+
+    const auto numChannels = juce::jmin (totalNumInputChannels, reversatronBuffer->getNumChannels());
+
+    // Fetched here, as getWritePointer() mustn't be called from the workers.
+    auto* const* channelData = buffer.getArrayOfWritePointers();
+
+    // The block is split wherever a command falls, so each one takes effect
+    // on exactly the sample it was scheduled for.
+    for (int position = 0; position < numSamples;)
+    {
+        const auto spanEnd = applyTransportCommands (blockStart, position, numSamples);
+
+        if (sliceMode)
+        {
+            processSlices (buffer, numChannels, position, spanEnd - position);
+        }
+        else if (retroMode)
+        {
+            processRetro (buffer, numChannels, position, spanEnd - position);
+        }
+        else
+        {
+            if (status == STOPPED || status == ARMED)
+            {
+                bufferAllocator.getTakeArchiver().noteTakeReplaced();
+                reversatronBuffer->release();
+            }
+
+            // An armed take starts part way through the span if the input
+            // triggers it there.
+            const auto numWaiting = processTrigger (channelData, numChannels, position, spanEnd - position);
+            processSpan (channelData, numChannels, position + numWaiting, spanEnd - position - numWaiting);
+        }
+        position = spanEnd;
+    }
+
+    publishTransportState();
+}
+
+int ReversatronAudioProcessor::applyTransportCommands (juce::int64 blockStart, int position, int numSamples)
+{
+    // Applies every command due at or before this sample, and returns the
+    // offset of the next one (or the end of the block).
+    while (auto* command = transportCommands.peek())
+    {
+        const auto offset = command->sampleTime - blockStart;
+
+        if (offset > position)
+            return static_cast<int> (juce::jmin (offset, static_cast<juce::int64> (numSamples)));
+
+        applyTransportCommand (*command);
+        transportCommands.pop();
+    }
+
+    return numSamples;
+}
+
+void ReversatronAudioProcessor::applyTransportCommand (const TransportCommand& command)
+{
+    // Any take being carried over to a new sample rate is superseded, and
+    // playback always starts on a whole frame.
+    pendingCarryOver.isActive = false;
+    playbackPhase = 0.0;
+
+    switch (command.type)
+    {
+        case TransportCommand::start:
+            crossfadeSmoother.setCurrentAndTargetValue (command.crossfadeSeconds);
+            crossfadeTime = command.crossfadeSeconds;
+            status = getRunningStatus();
+            frame = 0;
+            break;
+
+        case TransportCommand::stop:
+            status = STOPPED;
+            frame = 0;
+            hasStopped = true;
+            retroCapture.stop();
+            break;
+
+        case TransportCommand::retrigger:
+            // Slices follow the beat grid, so there's nothing to restart. In
+            // retroactive mode the take playing starts again.
+            if (status == CAPTURING)
+            {
+                retroCapture.retrigger();
+            }
+            else if (status != STOPPED && status != SLICING)
+            {
+                status = getRunningStatus();
+                frame = 0;
+            }
+            break;
+
+        case TransportCommand::switchToPlayback:
+            // Ping-pong periods always run for the whole take length. In
+            // retroactive mode the last take's worth of input is reversed.
+            if (status == CAPTURING)
+            {
+                // The capture may go into the slot of a take being read.
+                bufferAllocator.getTakeArchiver().noteTakeReplaced();
+                retroCapture.capture (static_cast<int> (juce::jmin (loopLength, static_cast<uint64_t> (std::numeric_limits<int>::max()))));
+            }
+            else if (status == RECORDING && frame > 0 && ! reversatronBuffer->isDoubleBuffered())
+                beginPlayback (frame);
+            break;
+
+        case TransportCommand::recall:
+            if (status == CAPTURING)
+                retroCapture.recall (command.slot);
+            break;
+
+        case TransportCommand::resume:
+        {
+            // The transport is set up as it was in the saved take, then
+            // moved to the matching point in the buffer it's restored into,
+            // either now or once that arrives.
+            const auto& point = command.resumePoint;
+            const auto savedLength = static_cast<uint64_t> (point.takeLength);
+
+            crossfadeSmoother.setCurrentAndTargetValue (command.crossfadeSeconds);
+            crossfadeTime = command.crossfadeSeconds;
+            status = point.isPlaying ? PLAYBACK : RECORDING;
+            playbackStart = point.isPlaying ? savedLength - static_cast<uint64_t> (point.numFramesRecorded) : 0;
+            playbackEnd = savedLength;
+            frame = point.isPlaying ? juce::jlimit (playbackStart, savedLength, static_cast<uint64_t> (juce::jmax ((juce::int64) 0, point.position)))
+                                    : static_cast<uint64_t> (point.numFramesRecorded);
+
+            if (reversatronBuffer->generation == point.generation)
+            {
+                resumeCarriedOverTake (point.takeLength, reversatronBuffer->getNumSamples());
+            }
+            else
+            {
+                pendingCarryOver.isActive = true;
+                pendingCarryOver.generation = point.generation;
+                pendingCarryOver.oldLength = point.takeLength;
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+template <typename SampleType>
+void ReversatronAudioProcessor::processSpan (SampleType* const* channelData, int numChannels, int startSample, int numSamples)
+{
+    auto& capture = *reversatronBuffer;
+    const auto bufferLength = static_cast<uint64_t> (capture.getNumSamples());
+
+    if (bufferLength == 0)
+        return;
+
+    while (numSamples > 0 && status != STOPPED && status != ARMED)
+    {
+        // The loop boundary moves with the buffer length, which only ever
+        // changes where the take ends, up to the room the buffer was built
+        // with. A ping-pong period has to keep the length it started with,
+        // as the last take plays back alongside it.
+        if (status == RECORDING && (frame == 0 || ! capture.isDoubleBuffered()))
+            takeLength = juce::jmin (loopLength, bufferLength);
+
+        // Moved back past the frame being recorded: the take ends here.
+        if (status == RECORDING && frame >= takeLength)
+        {
+            endTakePhase (capture);
+            continue;
+        }
+
+        // Off 1x (or between frames after a speed change), playback steps
+        // through the take at a fractional rate. Ping-pong stays at 1x, as
+        // its playback has to keep pace with the take being recorded.
+        const auto phaseEnd = status == PLAYBACK ? playbackEnd : takeLength;
+        const auto isResampling = status == PLAYBACK && (playbackSpeed != 1.0 || playbackPhase > 0.0);
+        const auto numToProcess = isResampling
+            ? juce::jlimit (1, numSamples, static_cast<int> (std::ceil ((static_cast<double> (phaseEnd - frame) - playbackPhase) / playbackSpeed)))
+            : static_cast<int> (juce::jmin (static_cast<uint64_t> (numSamples), phaseEnd - frame));
+        const auto isRecording = status == RECORDING || status == CONTINUOUS;
+        const auto isPlaying = status == PLAYBACK || status == CONTINUOUS;
+
+        // In ping-pong mode, frame counts through the period, and the last
+        // take plays from playbackStart.
+        const auto position = status == CONTINUOUS ? playbackStart + frame : frame;
+
+        if (isRecording)
+        {
+            if (frame == 0)
+            {
+                ++takeNumber;
+                bufferAllocator.getTakeArchiver().noteTakeReplaced();
+            }
+            
+            // Summarised before rendering, which overwrites the input in place.
+            waveformOverview.addFrames (channelData, numChannels, startSample, frame, numToProcess, static_cast<int> (takeLength));
+            capture.beginWrite (static_cast<int> (frame), numToProcess);
+        }
+
+        forEachChannel<SampleType> (numChannels, [&] (int channel, SampleType* scratch)
+        {
+            auto* data = channelData[channel] + startSample;
+
+            // In ping-pong mode the input is recorded before the reversed
+            // take is rendered over it.
+            if (isRecording)
+                capture.writeChannel (channel, data, static_cast<int> (frame), numToProcess);
+
+            if (isResampling)
+            {
+                renderResampledChannel (channel, data, numToProcess, scratch);
+            }
+            else if (isPlaying)
+            {
+                renderReversedChannel (channel, position, data, numToProcess, scratch);
+                layerVoices.mixChannel (capture, channel, static_cast<int> (playbackStart), static_cast<int> (position - playbackStart),
+                                        data, numToProcess, scratch, 2 * playbackScratchSize);
+            }
+        });
+
+        if (isRecording)
+            capture.endWrite (static_cast<int> (frame), numToProcess);
+
+        if (isResampling)
+        {
+            advanceResampledPlayback (numToProcess);
+        }
+        else
+        {
+            if (isPlaying)
+                capture.releaseReversed (static_cast<int> (juce::jmin (playbackEnd, position + static_cast<uint64_t> (numToProcess))));
+
+            frame += static_cast<uint64_t> (numToProcess);
+        }
+
+        startSample += numToProcess;
+        numSamples -= numToProcess;
+
+        // Switch over on the sample the take fills or empties, rather than
+        // at the next block.
+        if (frame >= phaseEnd)
+            endTakePhase (capture);
+    }
+}
+
+void ReversatronAudioProcessor::endTakePhase (CaptureBuffer& capture)
+{
+    const auto bufferLength = static_cast<uint64_t> (capture.getNumSamples());
+
+    if (status == PLAYBACK)
+    {
+        status = getRunningStatus();
+        frame = 0;
+        playbackPhase = 0.0;
+    }
+    else if (capture.isDoubleBuffered())
+    {
+        // The take just recorded starts playing back, and the next one
+        // records into the buffer that has just finished. If the new period
+        // is shorter, the last take is cut short (and faded out) at its end;
+        // if it's longer, the input passes through once it has played.
+        bufferAllocator.getTakeArchiver().noteTakeReplaced();
+        capture.beginPlayback (static_cast<int> (takeLength));
+        waveformOverview.beginPlayback (static_cast<int> (takeLength), true);
+        const auto nextLength = juce::jmin (loopLength, bufferLength);
+
+        status = CONTINUOUS;
+        frame = 0;
+        playbackStart = bufferLength - takeLength;
+        playbackEnd = playbackStart + juce::jmin (takeLength, nextLength);
+        takeLength = nextLength;
+        setUpLayerVoices();
+    }
+    else
+    {
+        beginPlayback (frame);
+    }
+}
+
+template <typename SampleType, typename ChannelFunction>
+void ReversatronAudioProcessor::forEachChannel (int numChannels, ChannelFunction&& function)
+{
+    // Each thread gets its own slice of the scratch buffer.
+    auto job = [&] (int channel, int workerIndex)
+    {
+        function (channel, reinterpret_cast<SampleType*> (playbackScratch + 2 * workerIndex * playbackScratchSize));
+    };
+
+    if (channelWorkers != nullptr && numChannels >= minChannelsForWorkers)
+    {
+        if (const auto secondsWaited = channelWorkers->run (numChannels, job); secondsWaited > 0.0)
+            loadMonitor.noteWorkerWait (secondsWaited);
+
+        return;
+    }
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        job (channel, 0);
+}
+
+void ReversatronAudioProcessor::beginPlayback (uint64_t numFramesRecorded)
+{
+    // A take cut short plays back from the position of its last recorded
+    // frame, so what comes out is still the recording reversed.
+    playbackEnd = static_cast<uint64_t> (reversatronBuffer->getNumSamples());
+    playbackStart = playbackEnd - numFramesRecorded;
+    frame = playbackStart;
+    playbackPhase = 0.0;
+    status = PLAYBACK;
+    setUpLayerVoices();
+    reversatronBuffer->beginPlayback (static_cast<int> (numFramesRecorded));
+    waveformOverview.beginPlayback (static_cast<int> (numFramesRecorded), false);
+}
+
+void ReversatronAudioProcessor::advanceResampledPlayback (int numSamples)
+{
+    const auto position = static_cast<double> (frame) + playbackPhase + numSamples * playbackSpeed;
+
+    frame = static_cast<uint64_t> (position);
+    playbackPhase = position - static_cast<double> (frame);
+
+    // The interpolator still needs a few positions behind the next one.
+    const auto firstNeeded = static_cast<int> (frame) - SampleInterpolator::numSamplesBefore;
+    reversatronBuffer->releaseReversed (juce::jmax (static_cast<int> (playbackStart), firstNeeded));
+}
+
+ReversatronAudioProcessor::PlaybackFades ReversatronAudioProcessor::getPlaybackFades() const noexcept
+{
+    // Fades are measured in positions through the take, so at other speeds
+    // they last proportionally shorter or longer.
+    PlaybackFades fades;
+    fades.length = juce::jmin (static_cast<double> (crossfadeTime) * getSampleRate(),
+                               static_cast<double> ((playbackEnd - playbackStart) / 2));
+    fades.fadeInEnd = playbackStart + static_cast<uint64_t> (std::ceil (fades.length));
+    fades.fadeOutStart = juce::jmax (fades.fadeInEnd, static_cast<uint64_t> (std::floor (static_cast<double> (playbackEnd) - fades.length)) + 1);
+    fades.gainStep = fades.length > 0.0 ? static_cast<float> (1.0 / fades.length) : 0.0f;
+    return fades;
+}
+
+void ReversatronAudioProcessor::setUpLayerVoices() noexcept
+{
+    layerVoices.clear();
+    
+    if (! reversatronBuffer->isRandomAccess())
+        return;
+    
+    // Voices 2 onwards, each from its own parameters. A voice can't play
+    // past the end of the take, and one that starts beyond it is left out.
+    const auto sampleRate = getSampleRate();
+    const auto playbackLength = static_cast<int> (playbackEnd - playbackStart);
+    const auto numVoices = juce::jlimit (1, ReverseVoicePool::maxVoices, juce::roundToInt (voicesParameter->load()));
+    
+    for (int i = 0; i < numVoices - 1; ++i)
+    {
+        const auto& parameters = voiceParameters[(size_t) i];
+        const auto lengthSeconds = parameters.length->load();
+        
+        ReverseVoicePool::Voice voice;
+        voice.offset = juce::roundToInt (parameters.offset->load() * 0.001 * sampleRate);
+        
+        const auto available = playbackLength - voice.offset;
+        voice.length = lengthSeconds > 0.0f ? juce::jmin (available, juce::roundToInt (lengthSeconds * sampleRate)) : available;
+        voice.fadeLength = juce::jmin (juce::roundToInt (parameters.fade->load() * sampleRate), voice.length / 2);
+        voice.gain = juce::Decibels::decibelsToGain (parameters.gain->load());
+        layerVoices.addVoice (voice);
+    }
+}
+
+template <typename SampleType>
+void ReversatronAudioProcessor::renderReversedChannel (int channel, uint64_t startPosition, SampleType* dest, int numSamples, SampleType* scratch)
+{
+    // The playback span is split into up to three segments - fade in, plain
+    // reverse and fade out - so the per-sample branch and gain maths turn into
+    // one gain ramp per segment. Anything past the end of the take (in a
+    // ping-pong period longer than the last take) is left as it is.
+    auto& capture = *reversatronBuffer;
+    const auto bufferLength = static_cast<uint64_t> (capture.getNumSamples());
+    const auto fades = getPlaybackFades();
+    const auto fadeLength = fades.length;
+    const auto fadeInEnd = fades.fadeInEnd;
+    const auto fadeOutStart = fades.fadeOutStart;
+    const auto gainStep = fades.gainStep;
+
+    for (int offset = 0; offset < numSamples;)
+    {
+        const auto position = startPosition + static_cast<uint64_t> (offset);
+
+        if (position >= playbackEnd)
+            break;
+
+        uint64_t segmentEnd;
+        float wetGain = 1.0f, wetGainStep = 0.0f;
+        bool isFade = true;
+
+        if (position < fadeInEnd)
+        {
+            // Fade out buffer, fade in reversatron buffer
+            segmentEnd = fadeInEnd;
+            wetGain = static_cast<float> (static_cast<double> (position - playbackStart) / fadeLength);
+            wetGainStep = gainStep;
+        }
+        else if (position < fadeOutStart)
+        {
+            segmentEnd = fadeOutStart;
+            isFade = false;
+        }
+        else
+        {
+            // Fade in buffer, fade out reversatron buffer
+            segmentEnd = playbackEnd;
+            wetGain = static_cast<float> (static_cast<double> (playbackEnd - position) / fadeLength);
+            wetGainStep = -gainStep;
+        }
+
+        const auto segmentLength = static_cast<int> (juce::jmin (static_cast<uint64_t> (numSamples - offset), segmentEnd - position));
+
+        // Playback position p reads sample (bufferLength - 1 - p), so the
+        // segment covers this forward run of the recording, read backwards.
+        const auto sourceStart = static_cast<int> (bufferLength - position - static_cast<uint64_t> (segmentLength));
+
+        auto* segmentDest = dest + offset;
+
+        if (auto* src = capture.getReadPointerAs<SampleType> (channel, sourceStart, segmentLength))
+        {
+            if (isFade)
+                ReversatronKernels::reverseCrossfade (segmentDest, src, segmentLength, wetGain, wetGainStep);
+            else
+                ReversatronKernels::reverseCopy (segmentDest, src, segmentLength);
+        }
+        else if (! isFade)
+        {
+            capture.readReversed (channel, static_cast<int> (position), segmentDest, segmentLength);
+        }
+        else
+        {
+            // Backends that can't hand out a pointer are read into the
+            // scratch buffer first, one scratch-sized chunk at a time.
+            for (int done = 0; done < segmentLength; done += playbackScratchSize)
+            {
+                const auto num = juce::jmin (playbackScratchSize, segmentLength - done);
+                capture.readReversed (channel, static_cast<int> (position) + done, scratch, num);
+                ReversatronKernels::crossfade (segmentDest + done, scratch, num,
+                                               wetGain + static_cast<float> (done) * wetGainStep, wetGainStep);
+            }
+        }
+
+        offset += segmentLength;
+    }
+}
+
+template <typename SampleType>
+void ReversatronAudioProcessor::renderResampledChannel (int channel, SampleType* dest, int numSamples, SampleType* scratch)
+{
+    // Works through the span in chunks: the playback positions each chunk
+    // touches are read into the first half of the scratch slice, interpolated
+    // into the second half, and then mixed in with the same three-segment
+    // fades as renderReversedChannel(). The cost per sample is fixed by the
+    // interpolator's tap count, whatever the speed.
+    auto& capture = *reversatronBuffer;
+    const auto takeEnd = static_cast<int> (playbackEnd);
+    const auto fades = getPlaybackFades();
+    constexpr auto before = SampleInterpolator::numSamplesBefore;
+    constexpr auto after = SampleInterpolator::numSamplesAfter;
+    const auto maxChunk = juce::jlimit (1, playbackScratchSize,
+                                        static_cast<int> ((playbackScratchSize - before - after - 2) / playbackSpeed));
+
+    auto* window = scratch;
+    auto* wet = scratch + playbackScratchSize;
+    auto position = static_cast<double> (frame) + playbackPhase;
+
+    for (int offset = 0; offset < numSamples;)
+    {
+        const auto num = juce::jmin (maxChunk, numSamples - offset);
+        const auto base = static_cast<int> (position);
+        const auto first = base - before;
+        const auto last = static_cast<int> (position + (num - 1) * playbackSpeed) + after;
+
+        // Only the take's own positions are read; either side is silence.
+        const auto readStart = juce::jlimit (first, last + 1, static_cast<int> (playbackStart));
+        const auto readEnd = juce::jlimit (readStart, last + 1, takeEnd);
+
+        juce::FloatVectorOperations::clear (window, readStart - first);
+        juce::FloatVectorOperations::clear (window + (readEnd - first), last + 1 - readEnd);
+
+        if (readEnd > readStart)
+            capture.readReversed (channel, readStart, window + (readStart - first), readEnd - readStart);
+
+        interpolator->process (interpolationQuality, wet, window + before, num, position - base, playbackSpeed);
+
+        // Output sample i sits at position + i * playbackSpeed; split the
+        // chunk where that crosses the ends of the fades.
+        auto samplesBefore = [&] (uint64_t boundary)
+        {
+            return juce::jlimit (0, num, static_cast<int> (std::ceil ((static_cast<double> (boundary) - position) / playbackSpeed)));
+        };
+
+        const auto fadeInEnd = samplesBefore (fades.fadeInEnd);
+        const auto fadeOutStart = juce::jmax (fadeInEnd, samplesBefore (fades.fadeOutStart));
+        auto* chunkDest = dest + offset;
+
+        if (fadeInEnd > 0)
+            ReversatronKernels::crossfade (chunkDest, wet, fadeInEnd,
+                                           static_cast<float> ((position - static_cast<double> (playbackStart)) / fades.length),
+                                           fades.gainStep * static_cast<float> (playbackSpeed));
+
+        if (fadeOutStart > fadeInEnd)
+            juce::FloatVectorOperations::copy (chunkDest + fadeInEnd, wet + fadeInEnd, fadeOutStart - fadeInEnd);
+
+        if (num > fadeOutStart)
+            ReversatronKernels::crossfade (chunkDest + fadeOutStart, wet + fadeOutStart, num - fadeOutStart,
+                                           static_cast<float> ((takeEnd - (position + fadeOutStart * playbackSpeed)) / fades.length),
+                                           -fades.gainStep * static_cast<float> (playbackSpeed));
+
+        offset += num;
+        position += num * playbackSpeed;
+    }
+}
+
+template <typename SampleType>
+void ReversatronAudioProcessor::processSlices (juce::AudioBuffer<SampleType>& buffer, int numChannels, int startSample, int numSamples)
+{
+    auto& ring = *reversatronBuffer;
+    const auto ringLength = ring.getNumSamples();
+
+    // Until a buffer that can be used as a ring arrives (see
+    // updateFromMessageThread()), the input passes straight through.
+    if (ringLength == 0 || ! ring.isRandomAccess())
+        return;
+
+    slicer.setActive (status == SLICING);
+
+    auto* const* channelData = buffer.getArrayOfWritePointers();
+
+    while (numSamples > 0)
+    {
+        const auto numToProcess = slicer.getNumToProcess (numSamples, ringLength);
+        const auto ringFrame = slicer.getRingFrame (ringLength);
+
+        ring.beginWrite (ringFrame, numToProcess);
+
+        forEachChannel<SampleType> (numChannels, [&] (int channel, SampleType* scratch)
+        {
+            auto* data = channelData[channel] + startSample;
+
+            // Recorded first, as the output reads back as little as one frame.
+            ring.writeChannel (channel, data, ringFrame, numToProcess);
+            slicer.renderChannel (ring, channel, data, numToProcess, scratch, 2 * playbackScratchSize);
+        });
+
+        ring.endWrite (ringFrame, numToProcess);
+        slicer.advance (numToProcess);
+
+        startSample += numToProcess;
+        numSamples -= numToProcess;
+    }
+}
+
+template <typename SampleType>
+void ReversatronAudioProcessor::processRetro (juce::AudioBuffer<SampleType>& buffer, int numChannels, int startSample, int numSamples)
+{
+    auto& ring = *reversatronBuffer;
+
+    // Until a buffer that can be used as a ring arrives (see
+    // updateFromMessageThread()), the input passes straight through.
+    if (ring.getNumSamples() == 0 || ! ring.isRandomAccess())
+    {
+        requestMessageThreadUpdate();
+        return;
+    }
+
+    retroCapture.setFadeLength (juce::roundToInt (crossfadeTime * getSampleRate()));
+
+    auto* const* channelData = buffer.getArrayOfWritePointers();
+
+    while (numSamples > 0)
+    {
+        const auto numToProcess = retroCapture.getNumToProcess (numSamples);
+        const auto ringFrame = retroCapture.getRingFrame();
+
+        ring.beginWrite (ringFrame, numToProcess);
+        retroCapture.beginCopies (ring, numToProcess);
+
+        forEachChannel<SampleType> (numChannels, [&] (int channel, SampleType* scratch)
+        {
+            auto* data = channelData[channel] + startSample;
+
+            // Recorded, and the bank brought up to date, before the output
+            // is rendered over the input.
+            ring.writeChannel (channel, data, ringFrame, numToProcess);
+            retroCapture.copyChannel (ring, channel);
+            retroCapture.renderChannel (ring, channel, data, numToProcess, scratch, 2 * playbackScratchSize);
+        });
+
+        ring.endWrite (ringFrame, numToProcess);
+        retroCapture.advance (numToProcess);
+
+        startSample += numToProcess;
+        numSamples -= numToProcess;
+    }
+}
+
+void ReversatronAudioProcessor::updateLoopTiming (int numSamples) noexcept
+{
+    // Both are read once a block. A loop boundary that lands on the next
+    // block boundary is near enough for a take seconds long, and the
+    // crossfade time is ramped across blocks rather than jumping.
+    const auto lengthSeconds = juce::jlimit (minBufferLengthSeconds, maxBufferLengthSeconds, bufferLengthParameter->load());
+    loopLength = static_cast<uint64_t> (juce::jmax (1, juce::roundToInt (lengthSeconds * getSampleRate())));
+
+    crossfadeSmoother.setTargetValue (juce::jlimit (0.0f, 250.0f, crossfadeTimeParameter->load()));
+    crossfadeTime = crossfadeSmoother.skip (numSamples);
+}
+
+bool ReversatronAudioProcessor::isSliceModeSelected() const noexcept
+{
+    return static_cast<int> (modeParameter->load()) == sliceModeIndex;
+}
+
+bool ReversatronAudioProcessor::isRetroModeSelected() const noexcept
+{
+    return static_cast<int> (modeParameter->load()) == retroModeIndex;
+}
+
+bool ReversatronAudioProcessor::isRingModeSelected() const noexcept
+{
+    // Both record into a ring that keeps running between takes.
+    return isSliceModeSelected() || isRetroModeSelected();
+}
+
+ReversatronAudioProcessor::RunningMode ReversatronAudioProcessor::getRunningStatus() const noexcept
+{
+    // What a running take does in the current mode, or when it's recorded
+    // a take: the trigger only applies to takes that are recorded first.
+    if (sliceMode)
+        return SLICING;
+
+    if (retroMode)
+        return CAPTURING;
+
+    return triggerMode != InputTrigger::Mode::manual ? ARMED : RECORDING;
+}
+
+void ReversatronAudioProcessor::updateTrigger() noexcept
+{
+    triggerMode = static_cast<InputTrigger::Mode> (static_cast<int> (triggerParameter->load()));
+    triggerThreshold = juce::Decibels::decibelsToGain (triggerThresholdParameter->load());
+    preRollLength = juce::jlimit (0, preRollCapacity, juce::roundToInt (preRollParameter->load() * 0.001 * getSampleRate()));
+
+    // Turning the trigger off while armed starts recording straight away.
+    if (status == ARMED && triggerMode == InputTrigger::Mode::manual)
+    {
+        status = RECORDING;
+        frame = 0;
+    }
+}
+
+template <typename SampleType>
+int ReversatronAudioProcessor::processTrigger (SampleType* const* channelData, int numChannels, int startSample, int numSamples)
+{
+    // The detector sees every span, armed or not, so that its envelope is
+    // settled by the time it's needed. Returns how many frames are left
+    // waiting before the take starts.
+    const auto numBefore = inputTrigger.process (channelData, numChannels, startSample, numSamples,
+                                                 triggerMode, triggerThreshold, status == ARMED);
+
+    if (status != ARMED)
+        return 0;
+
+    storePreRoll (channelData, numChannels, startSample, numBefore);
+
+    if (numBefore < numSamples)
+        startTriggeredTake<SampleType> (numChannels);
+
+    return numBefore;
+}
+
+template <typename SampleType>
+void ReversatronAudioProcessor::storePreRoll (const SampleType* const* channelData, int numChannels, int startSample, int numSamples) noexcept
+{
+    if (preRollLength == 0)
+        return;
+
+    // Only the last ring's worth of a long span can end up in the pre-roll.
+    if (numSamples > preRollCapacity)
+    {
+        startSample += numSamples - preRollCapacity;
+        numSamples = preRollCapacity;
+    }
+
+    auto* ring = reinterpret_cast<SampleType*> (preRollRing.get());
+    numPreRollFrames = juce::jmin (preRollCapacity, numPreRollFrames + numSamples);
+
+    for (int done = 0; done < numSamples;)
+    {
+        const auto num = juce::jmin (numSamples - done, preRollCapacity - preRollFrame);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            juce::FloatVectorOperations::copy (ring + channel * preRollCapacity + preRollFrame,
+                                               channelData[channel] + startSample + done, num);
+
+        preRollFrame = (preRollFrame + num) % preRollCapacity;
+        done += num;
+    }
+}
+
+template <typename SampleType>
+void ReversatronAudioProcessor::startTriggeredTake (int numChannels)
+{
+    // The take starts with the pre-roll, oldest frame first, recorded
+    // straight from the ring in up to two runs; the caller records the
+    // rest of the span from the triggering frame on.
+    status = RECORDING;
+    frame = 0;
+
+    auto* ring = reinterpret_cast<SampleType*> (preRollRing.get());
+    const auto numFrames = juce::jmin (numPreRollFrames, preRollLength);
+    const auto first = (preRollFrame - numFrames + preRollCapacity) % preRollCapacity;
+    std::array<SampleType*, maxChannels> runChannels {};
+
+    for (int done = 0; done < numFrames;)
+    {
+        const auto ringFrame = (first + done) % preRollCapacity;
+        const auto num = juce::jmin (numFrames - done, preRollCapacity - ringFrame);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            runChannels[(size_t) channel] = ring + channel * preRollCapacity + ringFrame;
+
+        processSpan (runChannels.data(), numChannels, 0, num);
+        done += num;
+    }
+
+    numPreRollFrames = 0;
+}
+
+double ReversatronAudioProcessor::getSliceBeats (double beatsPerBar) const noexcept
+{
+    // 1/16, 1/8, 1/4, 1/2 or a bar, in quarter-note beats.
+    const auto choice = static_cast<int> (sliceLengthParameter->load());
+    return choice >= 4 ? beatsPerBar : 0.25 * static_cast<double> (1 << choice);
+}
+
+int ReversatronAudioProcessor::getSliceLength (double sliceBeats, double bpm, double sampleRate, int ringLength, int blockSize) noexcept
+{
+    // The ring has to hold four slices plus a block (see SliceReverser).
+    constexpr auto minSliceLength = 32;
+    const auto maxSliceLength = juce::jmax (minSliceLength, (ringLength - 2 * blockSize) / 4);
+    return juce::jlimit (minSliceLength, maxSliceLength, juce::roundToInt (sliceBeats * 60.0 / bpm * sampleRate));
+}
+
+void ReversatronAudioProcessor::updateSliceTiming() noexcept
+{
+    auto bpm = hostBpm.load();
+    auto beatsPerBar = hostBeatsPerBar.load();
+    auto ppq = -1.0;
+    auto isSynced = false;
+
+    if (auto* playHead = getPlayHead())
+    {
+        if (const auto position = playHead->getPosition())
+        {
+            bpm = juce::jlimit (20.0, 999.0, position->getBpm().orFallback (bpm));
+
+            if (const auto signature = position->getTimeSignature())
+                beatsPerBar = signature->numerator * 4.0 / juce::jmax (1, signature->denominator);
+
+            if (const auto hostPpq = position->getPpqPosition())
+            {
+                ppq = *hostPpq;
+                isSynced = position->getIsPlaying();
+            }
+        }
+    }
+
+    hostBpm = bpm;
+    hostBeatsPerBar = beatsPerBar;
+
+    if (! sliceMode)
+    {
+        if (requiredLatency.exchange (0) != 0)
+            requestMessageThreadUpdate();
+
+        return;
+    }
+
+    // Slice mode needs a ring; the message thread asks for one.
+    auto& ring = *reversatronBuffer;
+
+    if (! ring.isRandomAccess() || ring.getNumSamples() == 0)
+    {
+        if (! bufferAllocator.isRequestPending())
+            requestMessageThreadUpdate();
+
+        return;
+    }
+
+    const auto sliceBeats = getSliceBeats (beatsPerBar);
+    const auto sliceLength = getSliceLength (sliceBeats, bpm, getSampleRate(), ring.getNumSamples(), getBlockSize());
+
+    slicer.setTiming (sliceLength, juce::roundToInt (crossfadeTime * getSampleRate()));
+
+    // While the host is playing, slice boundaries fall on its beat grid.
+    if (isSynced)
+    {
+        const auto beatsToBoundary = sliceBeats - std::fmod (ppq, sliceBeats);
+        slicer.syncNextSlice (juce::roundToInt (beatsToBoundary * 60.0 / bpm * getSampleRate()) % sliceLength);
+    }
+
+    if (requiredLatency.exchange (sliceLength) != sliceLength)
+        requestMessageThreadUpdate();
+}
+
+void ReversatronAudioProcessor::timerCallback()
+{
+    if (updateNeeded.exchange (false, std::memory_order_acquire))
+        updateFromMessageThread();
+}
+
+void ReversatronAudioProcessor::updateFromMessageThread()
+{
+    setLatencySamples (requiredLatency.load());
+
+    // Switching to slice or retroactive mode doesn't go through startTake(),
+    // so this is where it gets its ring. Once a take has stopped, its buffer
+    // is swapped for an empty one so that the memory goes back to the arena;
+    // the audio thread has to have got to the stop first, as it may be
+    // scheduled ahead.
+    const auto isStopped = ! takeRunning && getTransportSnapshot().status == STOPPED;
+
+    if (isRingModeSelected() || isStopped)
+    {
+        const auto spec = getBufferSpec();
+
+        if (spec != requestedSpec)
+            requestBuffer (spec);
+    }
+}
+
+void ReversatronAudioProcessor::publishTransportState() noexcept
+{
+    // Status and frame share one word so the editor never sees one without
+    // the other.
+    // In retroactive mode, the take shown is the one playing from the bank.
+    const auto shownFrame = retroMode ? static_cast<uint64_t> (retroCapture.getPlaybackPosition()) : frame;
+    
+    publishedTransport = (static_cast<uint64_t> (status) << 56) | (shownFrame & ((uint64_t (1) << 56) - 1));
+    publishedBufferLength = reversatronBuffer->getNumSamples();
+    publishedTakeLength = retroMode ? retroCapture.getPlayingLength() : static_cast<int> (takeLength);
+    publishedPlaybackPosition = status == CONTINUOUS ? playbackStart + frame : shownFrame;
+    publishedSampleRate = getSampleRate();
+    publishedSampleTime = samplesProcessed;
+    publishedBankSlot = retroMode ? retroCapture.getPlayingSlot() : -1;
+    publishedBankTakes = retroMode ? retroCapture.getStoredSlots() : 0u;
+
+    // Now the stop is visible, the message thread can let the take's memory go.
+    if (hasStopped)
+    {
+        hasStopped = false;
+        requestMessageThreadUpdate();
+    }
+
+    const auto numDropped = reversatronBuffer->getNumDroppedSamples();
+
+    if (numDropped > numDroppedSamplesSeen)
+    {
+        loadMonitor.noteDroppedSamples (numDropped - numDroppedSamplesSeen);
+        numDroppedSamplesSeen = numDropped;
+    }
+
+    // Tells the archiver which frames of the buffer hold a take that can be
+    // read for saving or exporting. While a new buffer is on its way, the
+    // transport may already describe the take going into it, so the last
+    // report stands. Only record then reverse takes are kept with sessions,
+    // and slice reverse has no one take at all.
+    if (bufferAllocator.isRequestPending())
+        return;
+    
+    const auto bufferLength = reversatronBuffer->getNumSamples();
+    TakeArchiver::Progress progress;
+    progress.generation = reversatronBuffer->generation;
+    
+    if (retroMode)
+    {
+        progress.isFinished = retroCapture.getTakeFrames (progress.firstFrame, progress.numFramesRecorded);
+    }
+    else if (reversatronBuffer->isDoubleBuffered())
+    {
+        // The last ping-pong take, which is what's playing.
+        if (status == CONTINUOUS)
+            progress.numFramesRecorded = bufferLength - static_cast<int> (playbackStart);
+        
+        progress.isFinished = true;
+    }
+    else if (! sliceMode)
+    {
+        if (status == RECORDING)
+            progress.numFramesRecorded = static_cast<int> (frame);
+        else if (status == PLAYBACK)
+            progress.numFramesRecorded = bufferLength - static_cast<int> (playbackStart);
+        
+        progress.isFinished = status == PLAYBACK;
+        progress.isSessionTake = true;
+    }
+    
+    bufferAllocator.getTakeArchiver().publishProgress (progress);
+}
+
+ReversatronAudioProcessor::TransportSnapshot ReversatronAudioProcessor::getTransportSnapshot() const noexcept
+{
+    const auto packed = publishedTransport.load();
+
+    TransportSnapshot snapshot;
+    snapshot.status = static_cast<RunningMode> (packed >> 56);
+    snapshot.frame = packed & ((uint64_t (1) << 56) - 1);
+    snapshot.bufferLength = publishedBufferLength.load();
+    snapshot.takeLength = publishedTakeLength.load();
+    snapshot.playbackPosition = publishedPlaybackPosition.load();
+    snapshot.sampleRate = publishedSampleRate.load();
+    snapshot.sampleTime = publishedSampleTime.load();
+    snapshot.bankSlot = publishedBankSlot.load();
+    snapshot.bankTakes = publishedBankTakes.load();
+    return snapshot;
+}
+
+void ReversatronAudioProcessor::installPreparedBuffer()
+{
+    // Only swap if the old buffer can be handed back, as it mustn't be freed
+    // on this thread.
+    if (! bufferAllocator.canRetireBuffer())
+        return;
+
+    if (auto* prepared = bufferAllocator.takePreparedBuffer())
+    {
+        const auto oldLength = pendingCarryOver.oldLength;
+        const auto resumes = pendingCarryOver.isActive && prepared->generation == pendingCarryOver.generation;
+        pendingCarryOver.isActive = false;
+
+        bufferAllocator.retireBuffer (reversatronBuffer.release());
+        reversatronBuffer.reset (prepared);
+        numDroppedSamplesSeen = 0;
+        slicer.reset();
+        retroCapture.reset (prepared->getNumSamples());
+
+        if (resumes)
+        {
+            resumeCarriedOverTake (oldLength, prepared->getNumSamples());
+        }
+        else
+        {
+            // There's nothing to play back in a new buffer, so a running
+            // take starts recording again.
+            if (status == PLAYBACK || status == CONTINUOUS)
+                status = getRunningStatus();
+
+            frame = 0;
+            playbackStart = 0;
+            playbackEnd = 0;
+            playbackPhase = 0.0;
+        }
+    }
+}
+
+void ReversatronAudioProcessor::resumeCarriedOverTake (int oldLength, int newLength)
+{
+    // The allocator has resampled the take to the new length (see
+    // CaptureCarryOver::scale()), so the transport picks up from the
+    // matching point in it.
+    if (status == PLAYBACK)
+    {
+        const auto numPlaying = CaptureCarryOver::scale (oldLength - static_cast<int> (playbackStart), oldLength, newLength);
+        const auto numLeft = CaptureCarryOver::scale (oldLength - static_cast<int> (frame), oldLength, newLength);
+
+        playbackStart = static_cast<uint64_t> (newLength - numPlaying);
+        playbackEnd = static_cast<uint64_t> (newLength);
+        frame = juce::jmax (playbackStart, static_cast<uint64_t> (newLength - numLeft));
+        reversatronBuffer->releaseReversed (static_cast<int> (frame));
+        setUpLayerVoices();
+    }
+    else
+    {
+        frame = static_cast<uint64_t> (CaptureCarryOver::scale (static_cast<int> (frame), oldLength, newLength));
+        playbackStart = 0;
+    }
+}
+
+std::unique_ptr<CaptureCarryOver> ReversatronAudioProcessor::takeForCarryOver (const CaptureBufferSpec& newSpec, double newSampleRate)
+{
+    // Only a take that's still running in a buffer of the same kind is worth
+    // resampling: anything else would have been reset by the new buffer
+    // anyway. Ping-pong takes restart.
+    auto& capture = *reversatronBuffer;
+    const auto isSameKind = newSpec.numChannels == capture.getNumChannels() && newSpec.storage == requestedSpec.storage
+                         && newSpec.format == requestedSpec.format && ! newSpec.doubleBuffered && ! capture.isDoubleBuffered();
+
+    if (preparedSampleRate <= 0.0 || newSampleRate == preparedSampleRate || ! isSameKind
+        || bufferAllocator.isRequestPending() || capture.getNumSamples() == 0
+        || ! (status == PLAYBACK || (status == RECORDING && frame > 0)))
+        return {};
+
+    auto carryOver = std::make_unique<CaptureCarryOver>();
+    carryOver->isPlaying = status == PLAYBACK;
+    carryOver->takeLength = capture.getNumSamples();
+    carryOver->numFramesRecorded = status == PLAYBACK ? capture.getNumSamples() - static_cast<int> (playbackStart)
+                                                      : static_cast<int> (frame);
+
+    // The audio thread isn't running during prepareToPlay, so the buffer can
+    // be swapped for an empty one here.
+    carryOver->source = std::move (reversatronBuffer);
+    reversatronBuffer = std::make_unique<MemoryCaptureBuffer<float>> (0, 0, bufferAllocator.getSegmentPool());
+    return carryOver;
+}
+
+void ReversatronAudioProcessor::requestBuffer (const CaptureBufferSpec& spec)
+{
+    requestedSpec = spec;
+    bufferAllocator.requestBuffer (spec);
+}
+
+//==============================================================================
+bool ReversatronAudioProcessor::hasEditor() const
+{
+    return true; // (change this to false if you choose to not supply an editor)
+}
+
+juce::AudioProcessorEditor* ReversatronAudioProcessor::createEditor()
+{
+    return new ReversatronAudioProcessorEditor (*this);
+}
+
+//==============================================================================
+void ReversatronAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
+{
+    // You should use this method to store your parameters in the memory block.
+    // You could do that either as raw data, or use the XML or ValueTree classes
+    // as intermediaries to make it easy to save and load complex data.
+    auto state = apvts.copyState();
+    std::unique_ptr<juce::XmlElement> xml (state.createXml());
+    copyXmlToBinary(*xml, destData);
+    
+    if (! takeRunning)
+    {
+        takeSaveFailed = false;
+        return;
+    }
+    
+    // The running take follows the parameters. The allocator's worker reads
+    // it out of the capture buffer a chunk at a time, while the audio thread
+    // carries on, so nothing here waits for the audio thread.
+    const auto parametersSize = destData.getSize();
+    const auto transport = getTransportSnapshot();
+    TakeArchiver::TakeInfo take;
+    
+    {
+        juce::MemoryOutputStream stream (destData, true);
+        stream.writeInt (takeChunkMagic);
+        stream.writeInt (takeChunkVersion);
+        stream.writeFloat (seconds);
+        stream.writeFloat (crossfadeSeconds);
+        stream.writeInt64 (transport.status == PLAYBACK ? static_cast<juce::int64> (transport.frame) : -1);
+        bool failed = false;
+        take = bufferAllocator.getTakeArchiver().write (stream, takeSaveTimeoutMs, failed);
+        takeSaveFailed = failed;
+    }
+    
+    if (take.numFramesRecorded == 0)
+        destData.setSize (parametersSize);
+}
+
+void ReversatronAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    // You should use this method to restore your parameters from this memory block,
+    // whose contents will have been created by the getStateInformation() call.
+    std::unique_ptr<juce::XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
+    if (xmlState.get() != nullptr)
+        if (xmlState->hasTagName (apvts.state.getType()))
+            apvts.replaceState (juce::ValueTree::fromXml (*xmlState));
+    
+    // A saved take follows the XML, which copyXmlToBinary() writes as a
+    // magic number, its length and the text plus a terminator.
+    if (xmlState == nullptr || sizeInBytes < 9)
+        return;
+    
+    const auto xmlSize = 9 + (int) juce::ByteOrder::littleEndianInt (static_cast<const char*> (data) + 4);
+    
+    if (xmlSize >= sizeInBytes)
+        return;
+    
+    juce::MemoryInputStream stream (static_cast<const char*> (data) + xmlSize, (size_t) (sizeInBytes - xmlSize), false);
+    
+    if (stream.readInt() != takeChunkMagic || stream.readInt() != takeChunkVersion)
+        return;
+    
+    const auto savedSeconds = stream.readFloat();
+    const auto savedCrossfade = stream.readFloat();
+    const auto position = stream.readInt64();
+    
+    // Only the saved data is copied here; decoding it (and resampling it,
+    // if the sample rate has changed) happens on the allocator's worker.
+    const auto maxTakeLength = static_cast<int> (maxBufferLengthSeconds * maxRestoredSampleRate);
+
+    if (auto take = TakeArchiver::read (stream, maxChannels, maxTakeLength))
+    {
+        seconds = juce::jlimit (minBufferLengthSeconds, maxBufferLengthSeconds, savedSeconds);
+        crossfadeSeconds = juce::jlimit (0.0f, 250.0f, savedCrossfade);
+        restoredTake = std::move (take);
+        restoredPosition = position;
+        takeRunning = true;
+        
+        if (preparedSampleRate > 0.0)
+            restoreTake();
+    }
+}
+
+void ReversatronAudioProcessor::restoreTake()
+{
+    auto take = std::move (restoredTake);
+    const auto spec = getBufferSpec();
+    
+    // Only single-buffered takes are saved; if the mode has been changed
+    // since, there's nothing to pick up.
+    if (spec.doubleBuffered || isRingModeSelected() || spec.numSamples <= 0)
+    {
+        stopTake();
+        return;
+    }
+    
+    TransportCommand command;
+    command.type = TransportCommand::resume;
+    command.crossfadeSeconds = crossfadeSeconds;
+    command.resumePoint.takeLength = take->takeLength;
+    command.resumePoint.numFramesRecorded = take->numFramesRecorded;
+    command.resumePoint.position = restoredPosition;
+    command.resumePoint.isPlaying = take->isPlaying;
+    
+    requestedSpec = spec;
+    command.resumePoint.generation = bufferAllocator.requestBuffer (spec, std::move (take));
+    postTransportCommand (command);
+}
+
+juce::AudioProcessorValueTreeState::ParameterLayout ReversatronAudioProcessor::addParameters()
+{
+    juce::AudioProcessorValueTreeState::ParameterLayout paramLayout;
+    
+    paramLayout.add(std::make_unique<juce::AudioParameterFloat>("bufferLength", "Buffer Length", minBufferLengthSeconds, maxBufferLengthSeconds, 10.0f));
+    paramLayout.add(std::make_unique<juce::AudioParameterFloat>("crossfadeTime", "Crossfade Time", 0.0f, 250.0f, 2.0f));
+    paramLayout.add(std::make_unique<juce::AudioParameterChoice>("storage", "Storage", juce::StringArray { "Memory", "Disk" }, 0));
+    paramLayout.add(std::make_unique<juce::AudioParameterChoice>("captureFormat", "Capture Format", juce::StringArray { "32-bit float", "16-bit", "24-bit", "24-bit lossless", "64-bit float" }, 0));
+    paramLayout.add(std::make_unique<juce::AudioParameterChoice>("mode", "Mode", juce::StringArray { "Record then reverse", "Ping-pong", "Slice reverse", "Retroactive" }, 0));
+    paramLayout.add(std::make_unique<juce::AudioParameterChoice>("sliceLength", "Slice Length", juce::StringArray { "1/16", "1/8", "1/4", "1/2", "1 bar" }, 2));
+    
+    // Skewed so that 1x sits in the middle of the range.
+    juce::NormalisableRange<float> speedRange (0.25f, 4.0f);
+    speedRange.setSkewForCentre (1.0f);
+    paramLayout.add(std::make_unique<juce::AudioParameterFloat>("playbackSpeed", "Playback Speed", speedRange, 1.0f));
+    paramLayout.add(std::make_unique<juce::AudioParameterChoice>("interpolation", "Interpolation", juce::StringArray { "Linear", "Windowed sinc" }, 1));
+    paramLayout.add(std::make_unique<juce::AudioParameterChoice>("trigger", "Trigger", juce::StringArray { "Manual", "Level", "Transient" }, 0));
+    paramLayout.add(std::make_unique<juce::AudioParameterFloat>("triggerThreshold", "Trigger Threshold", -60.0f, 0.0f, -30.0f));
+    paramLayout.add(std::make_unique<juce::AudioParameterFloat>("preRoll", "Pre-roll", 0.0f, 250.0f, 0.0f));
+    paramLayout.add(std::make_unique<juce::AudioParameterInt>("voices", "Voices", 1, ReverseVoicePool::maxVoices, 1));
+    
+    // By default the voices start evenly spaced, each 6 dB quieter than the
+    // one before, play to the end of the take and fade like it.
+    for (int voice = 2; voice <= ReverseVoicePool::maxVoices; ++voice)
+    {
+        const auto name = "Voice " + juce::String (voice) + " ";
+        const auto layer = (float) (voice - 1);
+        paramLayout.add(std::make_unique<juce::AudioParameterFloat>(getVoiceParameterID (voice, "Offset"), name + "Offset", 0.0f, 10000.0f, 250.0f * layer));
+        paramLayout.add(std::make_unique<juce::AudioParameterFloat>(getVoiceParameterID (voice, "Gain"), name + "Gain", -48.0f, 0.0f, -6.0f * layer));
+        paramLayout.add(std::make_unique<juce::AudioParameterFloat>(getVoiceParameterID (voice, "Length"), name + "Length", 0.0f, maxBufferLengthSeconds, 0.0f));
+        paramLayout.add(std::make_unique<juce::AudioParameterFloat>(getVoiceParameterID (voice, "Fade"), name + "Fade", 0.0f, 250.0f, 2.0f));
+    }
+    
+    return paramLayout;
+}
+
+AudioProcessorValueTreeState& ReversatronAudioProcessor::getApvts()
+{
+    return apvts;
+}
+
+juce::String ReversatronAudioProcessor::getVoiceParameterID (int voice, const juce::String& name)
+{
+    return "voice" + juce::String (voice) + name;
+}
+
+
+CaptureBufferSpec ReversatronAudioProcessor::getBufferSpec()
+{
+    CaptureBufferSpec spec;
+    spec.numChannels = getTotalNumInputChannels();
+    
+    // With no take running (and no ring to keep recording) there's nothing
+    // to record, so the buffer is an empty one that holds no memory.
+    if (! takeRunning && ! isRingModeSelected())
+        return spec;
+    
+    // Sized from the length the take started with rather than the live
+    // parameter, so that automating it doesn't change the spec and make
+    // prepareToPlay() replace the buffer. Memory buffers only take segments
+    // as they record, but compact and disk buffers commit all of it.
+    const auto reservedSeconds = juce::jmin (maxBufferLengthSeconds, seconds + bufferHeadroomSeconds);
+    spec.numSamples = static_cast<int> (getSampleRate() * reservedSeconds);
+    spec.storage = static_cast<CaptureStorage> (static_cast<int> (*apvts.getRawParameterValue("storage")));
+    spec.format = static_cast<CaptureFormat> (static_cast<int> (*apvts.getRawParameterValue("captureFormat")));
+    spec.doubleBuffered = static_cast<int> (*apvts.getRawParameterValue("mode")) == 1;
+    
+    // Slice reverse and retroactive modes use the buffer as a ring, which
+    // only plain in-memory storage allows (at either precision). The ring is
+    // recorded all the way round, so it's kept to the take length set when
+    // it started; in retroactive mode the bank follows it (see RetroCapture).
+    if (isRingModeSelected())
+    {
+        const auto takeSamples = static_cast<int> (getSampleRate() * seconds);
+        spec.numSamples = isSliceModeSelected() ? takeSamples : RetroCapture::getBufferLength (takeSamples);
+        spec.storage = CaptureStorage::memory;
+
+        if (spec.format != CaptureFormat::float64)
+            spec.format = CaptureFormat::float32;
+    }
+    
+    return spec;
+}
+
+bool ReversatronAudioProcessor::isAwaitingBuffer() const noexcept
+{
+    return bufferAllocator.isRequestPending();
+}
+
+void ReversatronAudioProcessor::setupAudioBuffer(float timeInSeconds)
+{
+	seconds = timeInSeconds;
+	
+	// In slice reverse and retroactive modes the ring keeps running between
+	// takes, so it's only replaced if it has to be.
+	const auto spec = getBufferSpec();
+	
+	if (! isRingModeSelected() || spec != requestedSpec)
+		requestBuffer(spec);
+    //std::cout << "Buffer Channels: " << std::to_string(reversatronBuffer.getNumChannels()) << std::endl;
+	//std::cout << "Buffer Size: " << std::to_string(reversatronBuffer.getNumSamples()) << std::endl;
+	
+}
+
+void ReversatronAudioProcessor::postTransportCommand (TransportCommand::Type type, juce::int64 sampleTime, float crossfadeSeconds)
+{
+    TransportCommand command;
+    command.type = type;
+    command.sampleTime = sampleTime;
+    command.crossfadeSeconds = crossfadeSeconds;
+    postTransportCommand (command);
+}
+
+void ReversatronAudioProcessor::postTransportCommand (const TransportCommand& command)
+{
+    // The queue only fills if the audio thread has stalled, in which case
+    // dropping a button press is the least bad option.
+    const auto pushed = transportCommands.push (command);
+    jassert (pushed);
+    juce::ignoreUnused (pushed);
+}
+
+void ReversatronAudioProcessor::startTake(float timeInSeconds, float crossfadeInSeconds, juce::int64 sampleTime)
+{
+    // The running take follows the parameters, so they're moved to match.
+    auto setParameter = [this] (const juce::String& id, float value)
+    {
+        auto* parameter = apvts.getParameter (id);
+        
+        if (parameter->convertFrom0to1 (parameter->getValue()) != value)
+            parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+    };
+    
+    setParameter ("bufferLength", timeInSeconds);
+    setParameter ("crossfadeTime", crossfadeInSeconds);
+    
+    crossfadeSeconds = crossfadeInSeconds;
+    takeRunning = true;
+    setupAudioBuffer (timeInSeconds);
+    postTransportCommand (TransportCommand::start, sampleTime, crossfadeInSeconds);
+}
+
+void ReversatronAudioProcessor::stopTake(juce::int64 sampleTime)
+{
+    postTransportCommand (TransportCommand::stop, sampleTime);
+    takeRunning = false;
+}
+
+void ReversatronAudioProcessor::retriggerTake(juce::int64 sampleTime)
+{
+    postTransportCommand (TransportCommand::retrigger, sampleTime);
+}
+
+void ReversatronAudioProcessor::switchToPlayback(juce::int64 sampleTime)
+{
+    postTransportCommand (TransportCommand::switchToPlayback, sampleTime);
+}
+
+void ReversatronAudioProcessor::recallTake(int slot, juce::int64 sampleTime)
+{
+    TransportCommand command;
+    command.type = TransportCommand::recall;
+    command.sampleTime = sampleTime;
+    command.slot = slot;
+    postTransportCommand (command);
+}
+
+bool ReversatronAudioProcessor::isTakeRunning() const noexcept
+{
+    return takeRunning;
+}
+
+bool ReversatronAudioProcessor::didLastTakeSaveFail() const noexcept
+{
+    return takeSaveFailed;
+}
+
+DspLoadMonitor::Stats ReversatronAudioProcessor::getDspLoadStats() const noexcept
+{
+    return loadMonitor.getStats();
+}
+
+void ReversatronAudioProcessor::resetDspLoadStats() noexcept
+{
+    loadMonitor.reset();
+}
+
+const WaveformOverview& ReversatronAudioProcessor::getWaveformOverview() const noexcept
+{
+    return waveformOverview;
+}
+
+ReversatronAudioProcessor::MemoryUsage ReversatronAudioProcessor::getMemoryUsage() const noexcept
+{
+    const auto& account = bufferAllocator.getSegmentPool().getAccount();
+
+    MemoryUsage usage;
+    usage.numBytes = account.getNumBytes();
+    usage.shared = account.getArena().getUsage();
+    return usage;
+}
+
+void ReversatronAudioProcessor::setMemoryBudget (juce::int64 numBytes)
+{
+    bufferAllocator.getSegmentPool().getAccount().getArena().setBudget (numBytes);
+}
+
+juce::int64 ReversatronAudioProcessor::getMemoryBudget() const noexcept
+{
+    return bufferAllocator.getSegmentPool().getAccount().getArena().getBudget();
+}
+
+void ReversatronAudioProcessor::setIgnoresMemoryBudget (bool shouldIgnore) noexcept
+{
+    bufferAllocator.getSegmentPool().getAccount().setIgnoresBudget (shouldIgnore);
+}
+
+void ReversatronAudioProcessor::setReservesWholeBuffers (bool shouldReserve) noexcept
+{
+    bufferAllocator.setReservesWholeBuffers (shouldReserve);
+}
+
+juce::Result ReversatronAudioProcessor::exportTake (const juce::File& file, bool reversed)
+{
+    const auto possible = canExportTake();
+
+    if (possible.failed())
+        return possible;
+
+    TakeExporter::Options options;
+    options.file = file;
+    options.reversed = reversed;
+    options.sampleRate = getSampleRate();
+    options.crossfadeSeconds = juce::jlimit (0.0f, 250.0f, crossfadeTimeParameter->load());
+    return takeExporter.start (options);
+}
+
+juce::Result ReversatronAudioProcessor::canExportTake() const
+{
+    if (isSliceModeSelected())
+        return juce::Result::fail ("Slice reverse plays a stream of slices rather than one take, so there's nothing to export.");
+
+    return juce::Result::ok();
+}
+
+void ReversatronAudioProcessor::cancelExport()
+{
+    takeExporter.cancel();
+}
+
+TakeExporter::Progress ReversatronAudioProcessor::getExportProgress() const
+{
+    return takeExporter.getProgress();
+}
+
+int ReversatronAudioProcessor::getRequiredLatencySamples() const noexcept
+{
+    return requiredLatency.load();
+}
+
+//==============================================================================
+// This creates new instances of the plugin..
+juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
+{
+    return new ReversatronAudioProcessor();
+}
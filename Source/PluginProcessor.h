@@ -1,82 +1,419 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin processor.
-
-  ==============================================================================
-*/
-
-#pragma once
-
-#include <JuceHeader.h>
-
-//==============================================================================
-/**
-*/
-class ReversatronAudioProcessor  : public juce::AudioProcessor
-{
-public:
-    //==============================================================================
-    ReversatronAudioProcessor();
-    ~ReversatronAudioProcessor() override;
-
-    //==============================================================================
-    void prepareToPlay (double sampleRate, int samplesPerBlock) override;
-    void releaseResources() override;
-
-   #ifndef JucePlugin_PreferredChannelConfigurations
-    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
-   #endif
-
-    void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
-
-    //==============================================================================
-    juce::AudioProcessorEditor* createEditor() override;
-    bool hasEditor() const override;
-
-    //==============================================================================
-    const juce::String getName() const override;
-
-    bool acceptsMidi() const override;
-    bool producesMidi() const override;
-    bool isMidiEffect() const override;
-    double getTailLengthSeconds() const override;
-
-    //==============================================================================
-    int getNumPrograms() override;
-    int getCurrentProgram() override;
-    void setCurrentProgram (int index) override;
-    const juce::String getProgramName (int index) override;
-    void changeProgramName (int index, const juce::String& newName) override;
-
-    //==============================================================================
-    void getStateInformation (juce::MemoryBlock& destData) override;
-    void setStateInformation (const void* data, int sizeInBytes) override;
-    
-    AudioProcessorValueTreeState& getApvts();
-    void setupAudioBuffer(const float timeInSeconds);
-    
-    enum RunningMode
-    {
-		STOPPED = 0,
-		RECORDING = 1,
-		PLAYBACK = 2,
-		RUNING_MODE_COUNT = 4
-	};
-	
-	uint32_t status;
-    uint64_t frame;
-    double sampleRate;
-    float crossfadeTime;
-    float seconds;
-
-private:
-    //==============================================================================
-    
-    juce::AudioProcessorValueTreeState apvts;
-    juce::AudioProcessorValueTreeState::ParameterLayout addParameters();
-    
-    juce::AudioBuffer<float> reversatronBuffer;
-    
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ReversatronAudioProcessor)
-};
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin processor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CaptureBufferAllocator.h"
+#include "ChannelWorkerPool.h"
+#include "DspLoadMonitor.h"
+#include "InputTrigger.h"
+#include "RetroCapture.h"
+#include "ReverseVoicePool.h"
+#include "SampleInterpolator.h"
+#include "SliceReverser.h"
+#include "TakeExporter.h"
+#include "TransportCommandQueue.h"
+#include "WaveformOverview.h"
+
+//==============================================================================
+/**
+*/
+class ReversatronAudioProcessor  : public juce::AudioProcessor,
+                                   private juce::Timer
+{
+public:
+    //==============================================================================
+    ReversatronAudioProcessor();
+    ~ReversatronAudioProcessor() override;
+
+    //==============================================================================
+    void prepareToPlay (double sampleRate, int samplesPerBlock) override;
+    void releaseResources() override;
+
+   #ifndef JucePlugin_PreferredChannelConfigurations
+    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
+   #endif
+
+    void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
+
+    //==============================================================================
+    juce::AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override;
+
+    //==============================================================================
+    const juce::String getName() const override;
+
+    bool acceptsMidi() const override;
+    bool producesMidi() const override;
+    bool isMidiEffect() const override;
+    double getTailLengthSeconds() const override;
+
+    //==============================================================================
+    int getNumPrograms() override;
+    int getCurrentProgram() override;
+    void setCurrentProgram (int index) override;
+    const juce::String getProgramName (int index) override;
+    void changeProgramName (int index, const juce::String& newName) override;
+
+    //==============================================================================
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+    
+    AudioProcessorValueTreeState& getApvts();
+    
+    /** The ID of one of a layered voice's parameters, e.g. "voice2Offset".
+        Voice 1 is the main playback head, so the voices that have their
+        own parameters are 2 to ReverseVoicePool::maxVoices.
+    */
+    static juce::String getVoiceParameterID (int voice, const juce::String& name);
+    void setupAudioBuffer(const float timeInSeconds);
+    bool isAwaitingBuffer() const noexcept;
+    
+    enum RunningMode
+    {
+		STOPPED = 0,
+		RECORDING = 1,
+		PLAYBACK = 2,
+		CONTINUOUS = 3,     // ping-pong: recording the next take while playing back the last
+		SLICING = 4,        // slice reverse: reversing tempo-synced slices as they're recorded
+		CAPTURING = 5,      // retroactive: ready to reverse what has just been recorded
+		ARMED = 6,          // waiting for the input to trigger the take
+		RUNING_MODE_COUNT = 7
+	};
+	
+    /** The transport as last published by the audio thread. */
+    struct TransportSnapshot
+    {
+        RunningMode status = STOPPED;
+        uint64_t frame = 0;
+        int bufferLength = 0;           // the capacity reserved, in frames
+        int takeLength = 0;             // where the take being recorded stops
+        uint64_t playbackPosition = 0;  // the position being played back
+        double sampleRate = 44100.0;
+        juce::int64 sampleTime = 0;     // samples processed up to the end of the last block
+        int bankSlot = -1;              // retroactive mode: the bank take playing, if any
+        uint32_t bankTakes = 0;         // retroactive mode: one bit per bank slot holding a take
+    };
+    
+    TransportSnapshot getTransportSnapshot() const noexcept;
+    
+    // Transport controls, called from the message thread. Each is queued for
+    // the audio thread and applied at sampleTime (see TransportSnapshot), or
+    // at the start of the next block if that has already passed.
+    void startTake(float timeInSeconds, float crossfadeInSeconds, juce::int64 sampleTime = TransportCommand::asSoonAsPossible);
+    void stopTake(juce::int64 sampleTime = TransportCommand::asSoonAsPossible);
+    void retriggerTake(juce::int64 sampleTime = TransportCommand::asSoonAsPossible);
+    void switchToPlayback(juce::int64 sampleTime = TransportCommand::asSoonAsPossible);
+    void recallTake(int slot, juce::int64 sampleTime = TransportCommand::asSoonAsPossible);
+    bool isTakeRunning() const noexcept;
+    
+    /** True if the last time the state was saved, the running take couldn't
+        be saved with it (see TakeArchiver::write()).
+    */
+    bool didLastTakeSaveFail() const noexcept;
+    
+    /** Timing and output sanity counters for processBlock; safe from any thread. */
+    DspLoadMonitor::Stats getDspLoadStats() const noexcept;
+    void resetDspLoadStats() noexcept;
+    
+    /** Peaks of the current takes, for drawing; built on the audio thread. */
+    const WaveformOverview& getWaveformOverview() const noexcept;
+    
+    /** Capture memory held by this instance, and by every instance in the
+        process together (see CaptureMemoryArena).
+    */
+    struct MemoryUsage
+    {
+        juce::int64 numBytes = 0;
+        CaptureMemoryArena::Usage shared;
+    };
+    
+    MemoryUsage getMemoryUsage() const noexcept;
+    
+    /** The memory budget shared by every instance; 0 means no limit. */
+    void setMemoryBudget (juce::int64 numBytes);
+    juce::int64 getMemoryBudget() const noexcept;
+
+    /** For the headless tools: lets this instance use as much memory as it
+        needs, whatever budget the plugin has been given, without changing
+        the budget saved for the plugin.
+    */
+    void setIgnoresMemoryBudget (bool shouldIgnore) noexcept;
+
+    /** For the headless tools: allocates in-memory buffers whole, before
+        the take starts (see CaptureBufferAllocator::setReservesWholeBuffers()).
+        Call before prepareToPlay().
+    */
+    void setReservesWholeBuffers (bool shouldReserve) noexcept;
+    
+    /** The latency the processor needs at the moment: one slice in slice
+        reverse mode, otherwise none. It's worked out on the audio thread from
+        the host's tempo, and passed on to setLatencySamples() asynchronously.
+    */
+    int getRequiredLatencySamples() const noexcept;
+    
+    /** Writes the running take to a WAV or FLAC file (going by its
+        extension) in the background: reversed or as recorded, faded in and
+        out by the crossfade time. A take that's still recording is exported
+        once it's finished. In ping-pong mode that's the take playing back,
+        and in retroactive mode the bank take playing, or else the last one
+        captured. Fails, saying why, if there's no take to export or an export
+        is already running.
+    */
+    juce::Result exportTake (const juce::File& file, bool reversed);
+
+    /** Whether the selected mode has a take that could be exported, and if
+        not, why not.
+    */
+    juce::Result canExportTake() const;
+    void cancelExport();
+    TakeExporter::Progress getExportProgress() const;
+
+private:
+    //==============================================================================
+    
+    juce::AudioProcessorValueTreeState apvts;
+    juce::AudioProcessorValueTreeState::ParameterLayout addParameters();
+    
+    // The buffer length parameter's range. Buffers are built for the length
+    // a take starts with plus some headroom, so the length can be raised a
+    // little while the take runs; past that, the take stops at the end of
+    // the buffer, and the next one gets a buffer to suit.
+    static constexpr float minBufferLengthSeconds = 0.5f;
+    static constexpr float maxBufferLengthSeconds = 500.0f;
+    static constexpr float bufferHeadroomSeconds = 60.0f;
+    
+    // Message thread state. Hosts call getStateInformation() from other
+    // threads as well, so what it reads is atomic.
+    std::atomic<float> seconds { 10.0f };
+    std::atomic<float> crossfadeSeconds { 2.0f };
+    std::atomic<bool> takeRunning { false };
+    CaptureBufferSpec requestedSpec;
+    double preparedSampleRate = 0.0;
+    
+    // Audio thread state
+    RunningMode status = STOPPED;
+    uint64_t frame = 0;
+    uint64_t playbackStart = 0;
+    uint32_t takeNumber = 0;
+    float crossfadeTime = 2.0f;
+    juce::int64 samplesProcessed = 0;
+    bool hasStopped = false;        // a stop to pass on to updateFromMessageThread()
+    
+    // The loop boundary. takeLength is where the take being recorded stops:
+    // it follows loopLength, read from the buffer length parameter at the
+    // start of each block, except in ping-pong mode where it only moves
+    // between periods. playbackEnd is where the take being played back stops.
+    uint64_t loopLength = 0;
+    uint64_t takeLength = 0;
+    uint64_t playbackEnd = 0;
+    std::atomic<float>* bufferLengthParameter = nullptr;
+    
+    // The crossfade time follows its parameter, smoothed from block to block
+    // so that automating it doesn't make the fades jump.
+    static constexpr double crossfadeSmoothingSeconds = 0.1;
+    juce::SmoothedValue<float> crossfadeSmoother { 2.0f };
+    std::atomic<float>* crossfadeTimeParameter = nullptr;
+    
+    void updateLoopTiming (int numSamples) noexcept;
+    
+    // Variable-speed playback: the fractional part of the playback position,
+    // and the speed and interpolation quality read at the start of each block.
+    double playbackPhase = 0.0;
+    double playbackSpeed = 1.0;
+    SampleInterpolator::Quality interpolationQuality = SampleInterpolator::Quality::windowedSinc;
+    std::atomic<float>* playbackSpeedParameter = nullptr;
+    std::atomic<float>* interpolationParameter = nullptr;
+    juce::SharedResourcePointer<SampleInterpolator> interpolator;
+    
+    // Layered playback: extra reverse voices mixed over the main head, set
+    // up from their parameters whenever playback starts. Each has its own
+    // offset, gain, length and fade. They need a random access buffer, and
+    // only play at 1x.
+    struct VoiceParameters
+    {
+        std::atomic<float>* offset = nullptr;   // ms into the take
+        std::atomic<float>* gain = nullptr;     // dB
+        std::atomic<float>* length = nullptr;   // seconds, or 0 to play to the end of the take
+        std::atomic<float>* fade = nullptr;     // seconds
+    };
+    
+    ReverseVoicePool layerVoices;
+    std::atomic<float>* voicesParameter = nullptr;
+    std::array<VoiceParameters, ReverseVoicePool::maxVoices - 1> voiceParameters;
+    
+    void setUpLayerVoices() noexcept;
+    
+    // Slice reverse mode. The tempo is the last one the host reported.
+    static constexpr int sliceModeIndex = 2;
+    bool sliceMode = false;
+    SliceReverser slicer;
+    std::atomic<float>* modeParameter = nullptr;
+    std::atomic<float>* sliceLengthParameter = nullptr;
+    std::atomic<double> hostBpm { 120.0 }, hostBeatsPerBar { 4.0 };
+    std::atomic<int> requiredLatency { 0 };
+    
+    bool isSliceModeSelected() const noexcept;
+    double getSliceBeats (double beatsPerBar) const noexcept;
+    static int getSliceLength (double sliceBeats, double bpm, double sampleRate, int ringLength, int blockSize) noexcept;
+    void updateSliceTiming() noexcept;
+    template <typename SampleType>
+    void processSlices (juce::AudioBuffer<SampleType>& buffer, int numChannels, int startSample, int numSamples);
+    
+    // The audio thread can't post messages, as that takes the platform's
+    // queue lock, so it sets a flag that a timer on the message thread polls.
+    static constexpr int updatePollIntervalMs = 20;
+    std::atomic<bool> updateNeeded { false };
+    
+    void requestMessageThreadUpdate() noexcept    { updateNeeded.store (true, std::memory_order_release); }
+    void timerCallback() override;
+    void updateFromMessageThread();
+    
+    // Retroactive mode. The ring records whenever the mode is selected;
+    // while a take is running, REVERSE NOW plays back what it holds.
+    static constexpr int retroModeIndex = 3;
+    bool retroMode = false;
+    RetroCapture retroCapture;
+    
+    bool isRetroModeSelected() const noexcept;
+    bool isRingModeSelected() const noexcept;
+    RunningMode getRunningStatus() const noexcept;
+    template <typename SampleType>
+    void processRetro (juce::AudioBuffer<SampleType>& buffer, int numChannels, int startSample, int numSamples);
+    
+    // Auto-record. With the trigger on, a take (or a retrigger, or the
+    // recording after a playback) arms rather than recording, and starts on
+    // the frame the input triggers it. The pre-roll ring keeps the input
+    // heard while armed, so the take can start up to preRollLength frames
+    // before that. It's sized for doubles, so that it does for either
+    // precision.
+    static constexpr double maxPreRollSeconds = 0.25;
+    InputTrigger inputTrigger;
+    InputTrigger::Mode triggerMode = InputTrigger::Mode::manual;
+    float triggerThreshold = 0.0f;
+    int preRollLength = 0;
+    std::atomic<float>* triggerParameter = nullptr;
+    std::atomic<float>* triggerThresholdParameter = nullptr;
+    std::atomic<float>* preRollParameter = nullptr;
+    juce::HeapBlock<double> preRollRing;
+    int preRollCapacity = 0, preRollFrame = 0, numPreRollFrames = 0;
+    
+    void updateTrigger() noexcept;
+    template <typename SampleType>
+    int processTrigger (SampleType* const* channelData, int numChannels, int startSample, int numSamples);
+    template <typename SampleType>
+    void storePreRoll (const SampleType* const* channelData, int numChannels, int startSample, int numSamples) noexcept;
+    template <typename SampleType>
+    void startTriggeredTake (int numChannels);
+    
+    TransportCommandQueue transportCommands;
+    std::atomic<uint64_t> publishedTransport { 0 };
+    std::atomic<int> publishedBufferLength { 0 }, publishedTakeLength { 0 };
+    std::atomic<uint64_t> publishedPlaybackPosition { 0 };
+    std::atomic<double> publishedSampleRate { 44100.0 };
+    std::atomic<juce::int64> publishedSampleTime { 0 };
+    std::atomic<int> publishedBankSlot { -1 };
+    std::atomic<uint32_t> publishedBankTakes { 0 };
+    
+    void postTransportCommand (TransportCommand::Type type, juce::int64 sampleTime, float crossfadeSeconds = 0.0f);
+    void postTransportCommand (const TransportCommand& command);
+    int applyTransportCommands (juce::int64 blockStart, int position, int numSamples);
+    void applyTransportCommand (const TransportCommand& command);
+    
+    // The engine is compiled once for each precision the host can process
+    // at; both processBlock() overloads come down to processSamples().
+    template <typename SampleType>
+    void processSamples (juce::AudioBuffer<SampleType>& buffer);
+    template <typename SampleType>
+    void processSpan (SampleType* const* channelData, int numChannels, int startSample, int numSamples);
+    void beginPlayback (uint64_t numFramesRecorded);
+    void endTakePhase (CaptureBuffer& capture);
+    void advanceResampledPlayback (int numSamples);
+    void publishTransportState() noexcept;
+    
+    CaptureBufferAllocator bufferAllocator;
+    std::unique_ptr<CaptureBuffer> reversatronBuffer;
+    TakeExporter takeExporter { bufferAllocator.getTakeArchiver() };
+    
+    // A take handed to the allocator to be resampled after a sample rate
+    // change; the transport resumes from the matching point once the buffer
+    // with this generation is installed, unless a command intervenes.
+    struct PendingCarryOver
+    {
+        bool isActive = false;
+        uint32_t generation = 0;
+        int oldLength = 0;
+    };
+    
+    PendingCarryOver pendingCarryOver;
+    
+    // The installed buffer's dropped samples already passed to loadMonitor.
+    int numDroppedSamplesSeen = 0;
+    
+    void installPreparedBuffer();
+    void resumeCarriedOverTake (int oldLength, int newLength);
+    std::unique_ptr<CaptureCarryOver> takeForCarryOver (const CaptureBufferSpec& newSpec, double newSampleRate);
+    void requestBuffer (const CaptureBufferSpec& spec);
+    CaptureBufferSpec getBufferSpec();
+    
+    // A take read back from a saved session. It's handed to the allocator to
+    // be decoded into a new buffer, by prepareToPlay() if the processor
+    // hasn't been prepared yet. Saving gives up on the take, rather than
+    // hold up the host, if the allocator's worker hasn't read all of it out
+    // within takeSaveTimeoutMs, and says so through takeSaveFailed; loading
+    // rejects a take longer than the longest buffer at maxRestoredSampleRate
+    // as damaged.
+    static constexpr int takeChunkMagic = 0x6b545452;      // "RTTk"
+    static constexpr int takeChunkVersion = 3;
+    static constexpr int takeSaveTimeoutMs = 2000;
+    static constexpr double maxRestoredSampleRate = 768000.0;
+    std::unique_ptr<CaptureCarryOver> restoredTake;
+    juce::int64 restoredPosition = -1;
+    std::atomic<bool> takeSaveFailed { false };
+    
+    void restoreTake();
+    
+    // Per-channel work is spread across a worker pool once there are enough
+    // channels for it to pay off; one worker per eight channels, up to one
+    // less than the number of cores.
+    static constexpr int maxChannels = 64;
+    static constexpr int minChannelsForWorkers = 16;
+    static constexpr int channelsPerWorker = 8;
+    std::unique_ptr<ChannelWorkerPool> channelWorkers;
+    
+    template <typename SampleType, typename ChannelFunction>
+    void forEachChannel (int numChannels, ChannelFunction&& function);
+    
+    // One scratch slice per thread that can render a channel, each two
+    // playbackScratchSize halves long. It's sized for doubles, so that it
+    // does for either precision.
+    static constexpr int playbackScratchSize = 1024;
+    juce::HeapBlock<double> playbackScratch { 2 * playbackScratchSize };
+    
+    /** Where the crossfades at either end of the take fall, in playback positions. */
+    struct PlaybackFades
+    {
+        double length = 0.0;
+        uint64_t fadeInEnd = 0, fadeOutStart = 0;
+        float gainStep = 0.0f;
+    };
+    
+    PlaybackFades getPlaybackFades() const noexcept;
+    template <typename SampleType>
+    void renderReversedChannel (int channel, uint64_t startPosition, SampleType* dest, int numSamples, SampleType* scratch);
+    template <typename SampleType>
+    void renderResampledChannel (int channel, SampleType* dest, int numSamples, SampleType* scratch);
+    
+    DspLoadMonitor loadMonitor;
+    WaveformOverview waveformOverview;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ReversatronAudioProcessor)
+};
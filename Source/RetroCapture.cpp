@@ -0,0 +1,300 @@
+/*
+  ==============================================================================
+
+    Retroactive mode: an always-on ring that reverses what was just played.
+
+  ==============================================================================
+*/
+
+#include "RetroCapture.h"
+#include "ReversatronKernels.h"
+
+//==============================================================================
+void RetroCapture::reset (int bufferLength) noexcept
+{
+    slotLength = juce::jmax (0, bufferLength) / (numBankSlots + 2);
+    ringLength = juce::jmax (0, bufferLength) - numBankSlots * slotLength;
+    time = 0;
+
+    slots = {};
+    lastSlot = -1;
+
+    current = {};
+    previous = {};
+    fadeStart = 0;
+    currentFadeLength = 0;
+    numCopyRuns = 0;
+}
+
+void RetroCapture::setFadeLength (int numFrames) noexcept
+{
+    fadeLength = juce::jmax (0, numFrames);
+}
+
+bool RetroCapture::capture (int takeLength) noexcept
+{
+    const auto length = static_cast<int> (juce::jmin (static_cast<juce::int64> (juce::jmin (takeLength, slotLength)), time));
+
+    if (length <= 0)
+        return false;
+
+    const auto slot = getFreeSlot();
+    slots[(size_t) slot] = { time, length, 0 };
+    lastSlot = slot;
+    play (slot);
+    return true;
+}
+
+bool RetroCapture::recall (int slot) noexcept
+{
+    if (! juce::isPositiveAndBelow (slot, numBankSlots) || slots[(size_t) slot].length == 0)
+        return false;
+
+    play (slot);
+    return true;
+}
+
+void RetroCapture::retrigger() noexcept
+{
+    if (current.isPlaying())
+        play (current.slot);
+}
+
+void RetroCapture::stop() noexcept
+{
+    if (current.isPlaying())
+        switchTo ({}, juce::jmin (current.fadeLength, current.length - current.position));
+}
+
+uint32_t RetroCapture::getStoredSlots() const noexcept
+{
+    uint32_t stored = 0;
+
+    for (int slot = 0; slot < numBankSlots; ++slot)
+        if (slots[(size_t) slot].length > 0)
+            stored |= 1u << slot;
+
+    return stored;
+}
+
+int RetroCapture::getFreeSlot() const noexcept
+{
+    // The bank is used round robin, skipping the slots still being heard.
+    for (int i = 1; i <= numBankSlots; ++i)
+    {
+        const auto slot = (lastSlot + i) % numBankSlots;
+
+        if (slot != current.slot && slot != previous.slot)
+            return slot;
+    }
+
+    return (lastSlot + 1) % numBankSlots;
+}
+
+void RetroCapture::play (int slot) noexcept
+{
+    Voice voice;
+    voice.slot = slot;
+    voice.length = slots[(size_t) slot].length;
+    voice.fadeLength = juce::jmin (fadeLength, voice.length / 2);
+    switchTo (voice, voice.fadeLength);
+}
+
+void RetroCapture::switchTo (Voice next, int numFadeFrames) noexcept
+{
+    previous = current;
+    current = next;
+    fadeStart = time;
+    currentFadeLength = numFadeFrames;
+}
+
+bool RetroCapture::getTakeFrames (int& firstFrame, int& length) const noexcept
+{
+    const auto slot = current.isPlaying() ? current.slot : lastSlot;
+
+    if (slot < 0 || slots[(size_t) slot].length == 0 || slots[(size_t) slot].numCopied < slots[(size_t) slot].length)
+        return false;
+
+    firstFrame = getSlotStart (slot);
+    length = slots[(size_t) slot].length;
+    return true;
+}
+
+//==============================================================================
+int RetroCapture::getNumToProcess (int numSamples) const noexcept
+{
+    auto num = juce::jmin (numSamples, ringLength - getRingFrame());
+
+    if (isFading())
+        num = juce::jmin (num, static_cast<int> (fadeStart + currentFadeLength - time));
+
+    // A take starts fading out its fade length before its end.
+    if (current.isPlaying())
+        num = juce::jmin (num, current.length - current.fadeLength - current.position);
+
+    return juce::jmax (1, num);
+}
+
+int RetroCapture::getRingFrame() const noexcept
+{
+    return static_cast<int> (time % ringLength);
+}
+
+void RetroCapture::beginCopies (CaptureBuffer& buffer, int numSamples) noexcept
+{
+    numCopyRuns = 0;
+
+    for (int index = 0; index < numBankSlots; ++index)
+    {
+        auto& slot = slots[(size_t) index];
+
+        if (slot.numCopied >= slot.length)
+            continue;
+
+        // The newest frames not yet copied, two for every frame recorded.
+        const auto num = juce::jmin (slot.length - slot.numCopied, 2 * numSamples);
+        const auto destStart = getSlotStart (index) + slot.length - slot.numCopied - num;
+        const auto sourceStart = slot.end - slot.numCopied - num;
+
+        buffer.beginWrite (destStart, num);
+
+        for (int done = 0; done < num;)
+        {
+            const auto ringFrame = static_cast<int> ((sourceStart + done) % ringLength);
+            const auto n = juce::jmin (num - done, ringLength - ringFrame);
+            copyRuns[(size_t) numCopyRuns++] = { ringFrame, destStart + done, n };
+            done += n;
+        }
+
+        slot.numCopied += num;
+    }
+}
+
+void RetroCapture::copyChannel (CaptureBuffer& buffer, int channel) const noexcept
+{
+    for (int i = 0; i < numCopyRuns; ++i)
+    {
+        const auto& run = copyRuns[(size_t) i];
+        buffer.copyFrames (channel, run.sourceFrame, run.destFrame, run.num);
+    }
+}
+
+void RetroCapture::advance (int numSamples) noexcept
+{
+    time += numSamples;
+
+    if (previous.isPlaying())
+        previous.position += numSamples;
+
+    if (current.isPlaying())
+    {
+        current.position += numSamples;
+
+        // Faded back to the input so that it's gone exactly at the take's end.
+        if (current.position >= current.length - current.fadeLength)
+            switchTo ({}, current.length - current.position);
+    }
+}
+
+//==============================================================================
+template <typename SampleType>
+void RetroCapture::renderChannel (CaptureBuffer& buffer, int channel, SampleType* dest, int numSamples,
+                                  SampleType* scratch, int scratchSize) const noexcept
+{
+    if (! isFading())
+    {
+        if (current.isPlaying())
+            renderVoice (current, buffer, channel, dest, numSamples, false, 1.0f, 0.0f, scratch, scratchSize);
+
+        return;
+    }
+
+    // The input is already in dest, so when either side of the crossfade is
+    // the input, only the other one is mixed in.
+    const auto gainStep = 1.0f / static_cast<float> (currentFadeLength);
+    const auto gain = static_cast<float> (time - fadeStart) * gainStep;
+
+    if (! previous.isPlaying())
+    {
+        renderVoice (current, buffer, channel, dest, numSamples, true, gain, gainStep, scratch, scratchSize);
+    }
+    else if (! current.isPlaying())
+    {
+        renderVoice (previous, buffer, channel, dest, numSamples, true, 1.0f - gain, -gainStep, scratch, scratchSize);
+    }
+    else
+    {
+        renderVoice (previous, buffer, channel, dest, numSamples, false, 1.0f, 0.0f, scratch, scratchSize);
+        renderVoice (current, buffer, channel, dest, numSamples, true, gain, gainStep, scratch, scratchSize);
+    }
+}
+
+template <typename SampleType>
+void RetroCapture::renderVoice (const Voice& voice, CaptureBuffer& buffer, int channel, SampleType* dest, int numSamples,
+                                bool isFade, float gain, float gainStep, SampleType* scratch, int scratchSize) const noexcept
+{
+    const auto slotStart = getSlotStart (voice.slot);
+    const auto bufferLength = buffer.getNumSamples();
+
+    for (int done = 0; done < numSamples;)
+    {
+        const auto position = voice.position + done;
+        const auto runGain = gain + static_cast<float> (done) * gainStep;
+        auto* runDest = dest + done;
+
+        if (position >= voice.length)
+        {
+            // Cut off mid-fade and played out: silence from here on.
+            auto num = numSamples - done;
+
+            if (isFade)
+            {
+                num = juce::jmin (num, scratchSize);
+                juce::FloatVectorOperations::clear (scratch, num);
+                ReversatronKernels::crossfade (runDest, scratch, num, runGain, gainStep);
+            }
+            else
+            {
+                juce::FloatVectorOperations::clear (runDest, num);
+            }
+
+            done += num;
+            continue;
+        }
+
+        // Playback position p reads slot frame (length - 1 - p), so the run
+        // covers this forward stretch of the slot, read backwards.
+        auto num = juce::jmin (numSamples - done, voice.length - position);
+        const auto runStart = slotStart + voice.length - position - num;
+
+        if (auto* src = buffer.getReadPointerAs<SampleType> (channel, runStart, num))
+        {
+            if (isFade)
+                ReversatronKernels::reverseCrossfade (runDest, src, num, runGain, gainStep);
+            else
+                ReversatronKernels::reverseCopy (runDest, src, num);
+        }
+        else
+        {
+            // Not contiguous in memory, so read through the buffer's playback
+            // positions, where frame f is position (bufferLength - 1 - f).
+            const auto bufferPosition = bufferLength - slotStart - voice.length + position;
+
+            if (isFade)
+            {
+                num = juce::jmin (num, scratchSize);
+                buffer.readReversed (channel, bufferPosition, scratch, num);
+                ReversatronKernels::crossfade (runDest, scratch, num, runGain, gainStep);
+            }
+            else
+            {
+                buffer.readReversed (channel, bufferPosition, runDest, num);
+            }
+        }
+
+        done += num;
+    }
+}
+
+template void RetroCapture::renderChannel (CaptureBuffer&, int, float*, int, float*, int) const noexcept;
+template void RetroCapture::renderChannel (CaptureBuffer&, int, double*, int, double*, int) const noexcept;
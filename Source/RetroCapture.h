@@ -0,0 +1,160 @@
+/*
+  ==============================================================================
+
+    Retroactive mode: an always-on ring that reverses what was just played.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CaptureBuffer.h"
+
+//==============================================================================
+/**
+    Keeps recording the input into a ring, so that a take can be reversed the
+    moment it's asked for, with no wait for it to be recorded first.
+
+    The capture buffer is split into the ring, two takes long, followed by a
+    bank of numBankSlots takes. capture() claims the last takeLength frames of
+    the ring for the next bank slot and starts playing them back reversed,
+    newest frame first; recall() plays a slot again later. Claimed frames are
+    copied from the ring into their slot a little each block, newest first
+    and twice as fast as the ring records: the copy therefore stays ahead of
+    the playback reading it, and is finished half a take after the capture,
+    long before the ring comes back round to the oldest frame. Each copy is
+    split where the ring wraps, and is a plain vectorised copy within the
+    buffer (see CaptureBuffer::copyFrames()).
+
+    Takes fade in over the input, and back out to it at their end, by the
+    crossfade length (or half the take, if that's shorter). Playback is
+    always at 1x, so the bank and the ring keep pace with each other.
+
+    Everything is called from the audio thread, except that copyChannel()
+    and renderChannel() may be called for different channels concurrently.
+*/
+class RetroCapture
+{
+public:
+    static constexpr int numBankSlots = 4;
+
+    /** The buffer length needed for takes of up to maxTakeLength frames. */
+    static int getBufferLength (int maxTakeLength) noexcept     { return (numBankSlots + 2) * maxTakeLength; }
+
+    /** Forgets the ring and the bank, and lays them out in a buffer of
+        bufferLength frames.
+    */
+    void reset (int bufferLength) noexcept;
+
+    /** The crossfade, in frames, for takes started from now on. */
+    void setFadeLength (int numFrames) noexcept;
+
+    /** Stores the last takeLength frames (or as many as have been recorded)
+        in the next bank slot and starts playing them back reversed. Returns
+        false if there's nothing to capture.
+    */
+    bool capture (int takeLength) noexcept;
+
+    /** Plays the take in a bank slot back reversed again. Returns false if
+        nothing has been captured into that slot.
+    */
+    bool recall (int slot) noexcept;
+
+    /** Restarts the take that's playing, if there is one. */
+    void retrigger() noexcept;
+
+    /** Fades back to the input. */
+    void stop() noexcept;
+
+    /** How many of the next numSamples frames can be processed in one go,
+        before the ring wraps or a crossfade starts or ends.
+    */
+    int getNumToProcess (int numSamples) const noexcept;
+
+    /** The ring frame that the next frame of input goes to. */
+    int getRingFrame() const noexcept;
+
+    /** Claims the bank frames that the next numSamples frames bring up to
+        date. Call before the channels are written.
+    */
+    void beginCopies (CaptureBuffer& buffer, int numSamples) noexcept;
+
+    /** Copies the frames claimed by beginCopies() for one channel. */
+    void copyChannel (CaptureBuffer& buffer, int channel) const noexcept;
+
+    /** Replaces numSamples frames of one channel's input with the output.
+        The channel's copies must already have been made. It's available for
+        float and double samples.
+    */
+    template <typename SampleType>
+    void renderChannel (CaptureBuffer& buffer, int channel, SampleType* dest, int numSamples,
+                        SampleType* scratch, int scratchSize) const noexcept;
+
+    /** Moves on by numSamples frames, fading out a take that's near its end. */
+    void advance (int numSamples) noexcept;
+
+    //==============================================================================
+    /** The bank slot playing, or -1 if the input is passing through. */
+    int getPlayingSlot() const noexcept         { return current.slot; }
+
+    /** How far through the playing take it has got, and its length. */
+    int getPlaybackPosition() const noexcept    { return current.position; }
+    int getPlayingLength() const noexcept       { return current.length; }
+
+    /** One bit per bank slot that holds a take. */
+    uint32_t getStoredSlots() const noexcept;
+
+    /** Where the take playing (or, with nothing playing, the one captured
+        last) sits in the buffer, in recorded order. Returns false until it
+        has been copied into its bank slot in full.
+    */
+    bool getTakeFrames (int& firstFrame, int& length) const noexcept;
+
+private:
+    /** A take being copied into a bank slot, or held there. */
+    struct Slot
+    {
+        juce::int64 end = 0;        // the ring time the take ended at
+        int length = 0;
+        int numCopied = 0;          // from the newest frame back
+    };
+
+    /** A take playing from the bank, or the input when slot is -1. */
+    struct Voice
+    {
+        int slot = -1;
+        int length = 0, position = 0, fadeLength = 0;
+
+        bool isPlaying() const noexcept     { return slot >= 0; }
+    };
+
+    struct CopyRun
+    {
+        int sourceFrame = 0, destFrame = 0, num = 0;
+    };
+
+    int getSlotStart (int slot) const noexcept      { return ringLength + slot * slotLength; }
+    int getFreeSlot() const noexcept;
+    void play (int slot) noexcept;
+    void switchTo (Voice next, int numFadeFrames) noexcept;
+    bool isFading() const noexcept      { return time < fadeStart + currentFadeLength; }
+
+    template <typename SampleType>
+    void renderVoice (const Voice& voice, CaptureBuffer& buffer, int channel, SampleType* dest, int numSamples,
+                      bool isFade, float gain, float gainStep, SampleType* scratch, int scratchSize) const noexcept;
+
+    int ringLength = 0, slotLength = 0, fadeLength = 0;
+    juce::int64 time = 0;       // frames recorded since reset()
+
+    std::array<Slot, numBankSlots> slots {};
+    int lastSlot = -1;
+
+    Voice current, previous;
+    juce::int64 fadeStart = 0;
+    int currentFadeLength = 0;
+
+    // Up to two runs per slot, as a copy can wrap round the ring.
+    std::array<CopyRun, 2 * numBankSlots> copyRuns {};
+    int numCopyRuns = 0;
+};
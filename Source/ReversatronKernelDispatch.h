@@ -0,0 +1,56 @@
+/*
+  ==============================================================================
+
+    Per-instruction-set versions of the hot playback kernels.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <vector>
+
+//==============================================================================
+/**
+    The reverse, crossfade and mix kernels are built more than once: the
+    baseline (SSE2 or NEON) versions in ReversatronKernels.cpp, and on x86,
+    AVX2 and AVX-512 versions in translation units of their own, compiled
+    with those instruction sets enabled. Each build fills in one KernelSet,
+    and ReversatronKernels.cpp picks the widest one the CPU (and OS) can run
+    when the code is loaded.
+
+    Only the kernel sources and the kernel test use this; everything else
+    calls the functions in ReversatronKernels.h.
+*/
+namespace ReversatronKernels::Dispatch
+{
+    template <typename SampleType>
+    struct PlaybackKernels
+    {
+        void (*reverseCopy) (SampleType* dest, const SampleType* src, int num) noexcept;
+        void (*reverseCrossfade) (SampleType* dest, const SampleType* src, int num, float gainStart, float gainStep) noexcept;
+        void (*crossfade) (SampleType* dest, const SampleType* src, int num, float gainStart, float gainStep) noexcept;
+        void (*reverseMix) (SampleType* dest, const SampleType* src, int num, float gainStart, float gainStep) noexcept;
+        void (*mix) (SampleType* dest, const SampleType* src, int num, float gainStart, float gainStep) noexcept;
+    };
+
+    struct KernelSet
+    {
+        const char* name;
+        PlaybackKernels<float> floats;
+        PlaybackKernels<double> doubles;
+    };
+
+    /** Every set this machine can run, baseline first, whatever
+        REVERSATRON_KERNELS says, so that they can be tested against each other.
+    */
+    std::vector<const KernelSet*> getSupportedKernelSets();
+
+   #if REVERSATRON_HAS_AVX2_KERNELS
+    extern const KernelSet avx2Kernels;         // ReversatronKernelsAVX2.cpp
+   #endif
+
+   #if REVERSATRON_HAS_AVX512_KERNELS
+    extern const KernelSet avx512Kernels;       // ReversatronKernelsAVX512.cpp
+   #endif
+}
@@ -0,0 +1,1073 @@
+/*
+  ==============================================================================
+
+    Block kernels used by the record and reversed playback paths.
+
+  ==============================================================================
+*/
+
+#include "ReversatronKernels.h"
+#include "ReversatronKernelDispatch.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+ #define REVERSATRON_USE_SSE2 1
+ #include <emmintrin.h>
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+ #define REVERSATRON_USE_NEON 1
+ #include <arm_neon.h>
+ #if defined (__aarch64__) || defined (_M_ARM64)
+  #define REVERSATRON_USE_NEON_DOUBLE 1     // 64-bit lanes are AArch64 only
+ #endif
+#endif
+
+#if REVERSATRON_HAS_AVX2_KERNELS || REVERSATRON_HAS_AVX512_KERNELS
+ #if defined (_MSC_VER)
+  #include <intrin.h>
+ #else
+  #include <cpuid.h>
+ #endif
+#endif
+
+namespace ReversatronKernels
+{
+
+namespace
+{
+   #if REVERSATRON_USE_SSE2
+    inline __m128 loadReversed (const float* p) noexcept
+    {
+        auto v = _mm_loadu_ps (p);
+        return _mm_shuffle_ps (v, v, _MM_SHUFFLE (0, 1, 2, 3));
+    }
+
+    inline __m128d loadReversed (const double* p) noexcept
+    {
+        auto v = _mm_loadu_pd (p);
+        return _mm_shuffle_pd (v, v, 1);
+    }
+   #elif REVERSATRON_USE_NEON
+    inline float32x4_t loadReversed (const float* p) noexcept
+    {
+        auto v = vrev64q_f32 (vld1q_f32 (p));
+        return vcombine_f32 (vget_high_f32 (v), vget_low_f32 (v));
+    }
+
+    #if REVERSATRON_USE_NEON_DOUBLE
+    inline float64x2_t loadReversed (const double* p) noexcept
+    {
+        auto v = vld1q_f64 (p);
+        return vcombine_f64 (vget_high_f64 (v), vget_low_f64 (v));
+    }
+    #endif
+   #endif
+}
+
+//==============================================================================
+// The baseline playback kernels, for CPUs without (or builds without) the
+// wider versions in ReversatronKernelsAVX2.cpp and ReversatronKernelsAVX512.cpp.
+namespace Baseline
+{
+
+void reverseCopy (float* dest, const float* src, int num) noexcept
+{
+    int i = 0;
+
+   #if REVERSATRON_USE_SSE2
+    for (; i + 8 <= num; i += 8)
+    {
+        _mm_storeu_ps (dest + i,     loadReversed (src + num - i - 4));
+        _mm_storeu_ps (dest + i + 4, loadReversed (src + num - i - 8));
+    }
+   #elif REVERSATRON_USE_NEON
+    for (; i + 8 <= num; i += 8)
+    {
+        vst1q_f32 (dest + i,     loadReversed (src + num - i - 4));
+        vst1q_f32 (dest + i + 4, loadReversed (src + num - i - 8));
+    }
+   #endif
+
+    for (; i < num; ++i)
+        dest[i] = src[num - 1 - i];
+}
+
+void reverseCopy (double* dest, const double* src, int num) noexcept
+{
+    int i = 0;
+
+   #if REVERSATRON_USE_SSE2
+    for (; i + 4 <= num; i += 4)
+    {
+        _mm_storeu_pd (dest + i,     loadReversed (src + num - i - 2));
+        _mm_storeu_pd (dest + i + 2, loadReversed (src + num - i - 4));
+    }
+   #elif REVERSATRON_USE_NEON_DOUBLE
+    for (; i + 4 <= num; i += 4)
+    {
+        vst1q_f64 (dest + i,     loadReversed (src + num - i - 2));
+        vst1q_f64 (dest + i + 2, loadReversed (src + num - i - 4));
+    }
+   #endif
+
+    for (; i < num; ++i)
+        dest[i] = src[num - 1 - i];
+}
+
+void reverseCrossfade (float* dest, const float* src, int num,
+                       float wetGainStart, float wetGainStep) noexcept
+{
+    int i = 0;
+
+   #if REVERSATRON_USE_SSE2
+    const auto ramp = _mm_mul_ps (_mm_setr_ps (0.0f, 1.0f, 2.0f, 3.0f), _mm_set1_ps (wetGainStep));
+
+    for (; i + 4 <= num; i += 4)
+    {
+        // Gains are recomputed from the segment start rather than accumulated,
+        // so long fades don't drift.
+        auto gain = _mm_add_ps (_mm_set1_ps (wetGainStart + (float) i * wetGainStep), ramp);
+        auto dry  = _mm_loadu_ps (dest + i);
+        auto wet  = loadReversed (src + num - i - 4);
+        _mm_storeu_ps (dest + i, _mm_add_ps (dry, _mm_mul_ps (_mm_sub_ps (wet, dry), gain)));
+    }
+   #elif REVERSATRON_USE_NEON
+    const float rampValues[] = { 0.0f, 1.0f, 2.0f, 3.0f };
+    const auto ramp = vmulq_n_f32 (vld1q_f32 (rampValues), wetGainStep);
+
+    for (; i + 4 <= num; i += 4)
+    {
+        auto gain = vaddq_f32 (vdupq_n_f32 (wetGainStart + (float) i * wetGainStep), ramp);
+        auto dry  = vld1q_f32 (dest + i);
+        auto wet  = loadReversed (src + num - i - 4);
+        vst1q_f32 (dest + i, vmlaq_f32 (dry, vsubq_f32 (wet, dry), gain));
+    }
+   #endif
+
+    for (; i < num; ++i)
+    {
+        const auto gain = wetGainStart + (float) i * wetGainStep;
+        const auto dry = dest[i];
+        dest[i] = dry + (src[num - 1 - i] - dry) * gain;
+    }
+}
+
+void reverseCrossfade (double* dest, const double* src, int num,
+                       float wetGainStart, float wetGainStep) noexcept
+{
+    int i = 0;
+
+   #if REVERSATRON_USE_SSE2
+    const auto ramp = _mm_setr_pd (0.0, (double) wetGainStep);
+
+    for (; i + 2 <= num; i += 2)
+    {
+        auto gain = _mm_add_pd (_mm_set1_pd ((double) (wetGainStart + (float) i * wetGainStep)), ramp);
+        auto dry  = _mm_loadu_pd (dest + i);
+        auto wet  = loadReversed (src + num - i - 2);
+        _mm_storeu_pd (dest + i, _mm_add_pd (dry, _mm_mul_pd (_mm_sub_pd (wet, dry), gain)));
+    }
+   #elif REVERSATRON_USE_NEON_DOUBLE
+    const double rampValues[] = { 0.0, (double) wetGainStep };
+    const auto ramp = vld1q_f64 (rampValues);
+
+    for (; i + 2 <= num; i += 2)
+    {
+        auto gain = vaddq_f64 (vdupq_n_f64 ((double) (wetGainStart + (float) i * wetGainStep)), ramp);
+        auto dry  = vld1q_f64 (dest + i);
+        auto wet  = loadReversed (src + num - i - 2);
+        vst1q_f64 (dest + i, vfmaq_f64 (dry, vsubq_f64 (wet, dry), gain));
+    }
+   #endif
+
+    for (; i < num; ++i)
+    {
+        const auto gain = (double) (wetGainStart + (float) i * wetGainStep);
+        const auto dry = dest[i];
+        dest[i] = dry + (src[num - 1 - i] - dry) * gain;
+    }
+}
+
+void crossfade (float* dest, const float* src, int num,
+                float wetGainStart, float wetGainStep) noexcept
+{
+    int i = 0;
+
+   #if REVERSATRON_USE_SSE2
+    const auto ramp = _mm_mul_ps (_mm_setr_ps (0.0f, 1.0f, 2.0f, 3.0f), _mm_set1_ps (wetGainStep));
+
+    for (; i + 4 <= num; i += 4)
+    {
+        auto gain = _mm_add_ps (_mm_set1_ps (wetGainStart + (float) i * wetGainStep), ramp);
+        auto dry  = _mm_loadu_ps (dest + i);
+        auto wet  = _mm_loadu_ps (src + i);
+        _mm_storeu_ps (dest + i, _mm_add_ps (dry, _mm_mul_ps (_mm_sub_ps (wet, dry), gain)));
+    }
+   #elif REVERSATRON_USE_NEON
+    const float rampValues[] = { 0.0f, 1.0f, 2.0f, 3.0f };
+    const auto ramp = vmulq_n_f32 (vld1q_f32 (rampValues), wetGainStep);
+
+    for (; i + 4 <= num; i += 4)
+    {
+        auto gain = vaddq_f32 (vdupq_n_f32 (wetGainStart + (float) i * wetGainStep), ramp);
+        auto dry  = vld1q_f32 (dest + i);
+        auto wet  = vld1q_f32 (src + i);
+        vst1q_f32 (dest + i, vmlaq_f32 (dry, vsubq_f32 (wet, dry), gain));
+    }
+   #endif
+
+    for (; i < num; ++i)
+    {
+        const auto gain = wetGainStart + (float) i * wetGainStep;
+        const auto dry = dest[i];
+        dest[i] = dry + (src[i] - dry) * gain;
+    }
+}
+
+void crossfade (double* dest, const double* src, int num,
+                float wetGainStart, float wetGainStep) noexcept
+{
+    int i = 0;
+
+   #if REVERSATRON_USE_SSE2
+    const auto ramp = _mm_setr_pd (0.0, (double) wetGainStep);
+
+    for (; i + 2 <= num; i += 2)
+    {
+        auto gain = _mm_add_pd (_mm_set1_pd ((double) (wetGainStart + (float) i * wetGainStep)), ramp);
+        auto dry  = _mm_loadu_pd (dest + i);
+        auto wet  = _mm_loadu_pd (src + i);
+        _mm_storeu_pd (dest + i, _mm_add_pd (dry, _mm_mul_pd (_mm_sub_pd (wet, dry), gain)));
+    }
+   #elif REVERSATRON_USE_NEON_DOUBLE
+    const double rampValues[] = { 0.0, (double) wetGainStep };
+    const auto ramp = vld1q_f64 (rampValues);
+
+    for (; i + 2 <= num; i += 2)
+    {
+        auto gain = vaddq_f64 (vdupq_n_f64 ((double) (wetGainStart + (float) i * wetGainStep)), ramp);
+        auto dry  = vld1q_f64 (dest + i);
+        auto wet  = vld1q_f64 (src + i);
+        vst1q_f64 (dest + i, vfmaq_f64 (dry, vsubq_f64 (wet, dry), gain));
+    }
+   #endif
+
+    for (; i < num; ++i)
+    {
+        const auto gain = (double) (wetGainStart + (float) i * wetGainStep);
+        const auto dry = dest[i];
+        dest[i] = dry + (src[i] - dry) * gain;
+    }
+}
+
+void reverseMix (float* dest, const float* src, int num,
+                float gainStart, float gainStep) noexcept
+{
+    int i = 0;
+
+   #if REVERSATRON_USE_SSE2
+    const auto ramp = _mm_mul_ps (_mm_setr_ps (0.0f, 1.0f, 2.0f, 3.0f), _mm_set1_ps (gainStep));
+
+    for (; i + 4 <= num; i += 4)
+    {
+        auto gain = _mm_add_ps (_mm_set1_ps (gainStart + (float) i * gainStep), ramp);
+        _mm_storeu_ps (dest + i, _mm_add_ps (_mm_loadu_ps (dest + i), _mm_mul_ps (loadReversed (src + num - i - 4), gain)));
+    }
+   #elif REVERSATRON_USE_NEON
+    const float rampValues[] = { 0.0f, 1.0f, 2.0f, 3.0f };
+    const auto ramp = vmulq_n_f32 (vld1q_f32 (rampValues), gainStep);
+
+    for (; i + 4 <= num; i += 4)
+    {
+        auto gain = vaddq_f32 (vdupq_n_f32 (gainStart + (float) i * gainStep), ramp);
+        vst1q_f32 (dest + i, vmlaq_f32 (vld1q_f32 (dest + i), loadReversed (src + num - i - 4), gain));
+    }
+   #endif
+
+    for (; i < num; ++i)
+        dest[i] += src[num - 1 - i] * (gainStart + (float) i * gainStep);
+}
+
+void reverseMix (double* dest, const double* src, int num,
+                float gainStart, float gainStep) noexcept
+{
+    int i = 0;
+
+   #if REVERSATRON_USE_SSE2
+    const auto ramp = _mm_setr_pd (0.0, (double) gainStep);
+
+    for (; i + 2 <= num; i += 2)
+    {
+        auto gain = _mm_add_pd (_mm_set1_pd ((double) (gainStart + (float) i * gainStep)), ramp);
+        _mm_storeu_pd (dest + i, _mm_add_pd (_mm_loadu_pd (dest + i), _mm_mul_pd (loadReversed (src + num - i - 2), gain)));
+    }
+   #elif REVERSATRON_USE_NEON_DOUBLE
+    const double rampValues[] = { 0.0, (double) gainStep };
+    const auto ramp = vld1q_f64 (rampValues);
+
+    for (; i + 2 <= num; i += 2)
+    {
+        auto gain = vaddq_f64 (vdupq_n_f64 ((double) (gainStart + (float) i * gainStep)), ramp);
+        vst1q_f64 (dest + i, vfmaq_f64 (vld1q_f64 (dest + i), loadReversed (src + num - i - 2), gain));
+    }
+   #endif
+
+    for (; i < num; ++i)
+        dest[i] += src[num - 1 - i] * (double) (gainStart + (float) i * gainStep);
+}
+
+void mix (float* dest, const float* src, int num,
+         float gainStart, float gainStep) noexcept
+{
+    int i = 0;
+
+   #if REVERSATRON_USE_SSE2
+    const auto ramp = _mm_mul_ps (_mm_setr_ps (0.0f, 1.0f, 2.0f, 3.0f), _mm_set1_ps (gainStep));
+
+    for (; i + 4 <= num; i += 4)
+    {
+        auto gain = _mm_add_ps (_mm_set1_ps (gainStart + (float) i * gainStep), ramp);
+        _mm_storeu_ps (dest + i, _mm_add_ps (_mm_loadu_ps (dest + i), _mm_mul_ps (_mm_loadu_ps (src + i), gain)));
+    }
+   #elif REVERSATRON_USE_NEON
+    const float rampValues[] = { 0.0f, 1.0f, 2.0f, 3.0f };
+    const auto ramp = vmulq_n_f32 (vld1q_f32 (rampValues), gainStep);
+
+    for (; i + 4 <= num; i += 4)
+    {
+        auto gain = vaddq_f32 (vdupq_n_f32 (gainStart + (float) i * gainStep), ramp);
+        vst1q_f32 (dest + i, vmlaq_f32 (vld1q_f32 (dest + i), vld1q_f32 (src + i), gain));
+    }
+   #endif
+
+    for (; i < num; ++i)
+        dest[i] += src[i] * (gainStart + (float) i * gainStep);
+}
+
+void mix (double* dest, const double* src, int num,
+         float gainStart, float gainStep) noexcept
+{
+    int i = 0;
+
+   #if REVERSATRON_USE_SSE2
+    const auto ramp = _mm_setr_pd (0.0, (double) gainStep);
+
+    for (; i + 2 <= num; i += 2)
+    {
+        auto gain = _mm_add_pd (_mm_set1_pd ((double) (gainStart + (float) i * gainStep)), ramp);
+        _mm_storeu_pd (dest + i, _mm_add_pd (_mm_loadu_pd (dest + i), _mm_mul_pd (_mm_loadu_pd (src + i), gain)));
+    }
+   #elif REVERSATRON_USE_NEON_DOUBLE
+    const double rampValues[] = { 0.0, (double) gainStep };
+    const auto ramp = vld1q_f64 (rampValues);
+
+    for (; i + 2 <= num; i += 2)
+    {
+        auto gain = vaddq_f64 (vdupq_n_f64 ((double) (gainStart + (float) i * gainStep)), ramp);
+        vst1q_f64 (dest + i, vfmaq_f64 (vld1q_f64 (dest + i), vld1q_f64 (src + i), gain));
+    }
+   #endif
+
+    for (; i < num; ++i)
+        dest[i] += src[i] * (double) (gainStart + (float) i * gainStep);
+}
+
+}
+
+//==============================================================================
+namespace
+{
+   #if REVERSATRON_USE_SSE2
+    constexpr auto baselineName = "SSE2";
+   #elif REVERSATRON_USE_NEON
+    constexpr auto baselineName = "NEON";
+   #else
+    constexpr auto baselineName = "scalar";
+   #endif
+
+    const Dispatch::KernelSet baselineKernels { baselineName,
+                                                { &Baseline::reverseCopy, &Baseline::reverseCrossfade, &Baseline::crossfade,
+                                                  &Baseline::reverseMix, &Baseline::mix },
+                                                { &Baseline::reverseCopy, &Baseline::reverseCrossfade, &Baseline::crossfade,
+                                                  &Baseline::reverseMix, &Baseline::mix } };
+
+   #if REVERSATRON_HAS_AVX2_KERNELS || REVERSATRON_HAS_AVX512_KERNELS
+    constexpr uint64_t avxState    = 0x06;      // XCR0: SSE and AVX registers
+    constexpr uint64_t avx512State = 0xe6;      // ... and the AVX-512 mask and upper registers
+
+    /** True if the OS saves all of the register state in mask on a context
+        switch, which the CPUID feature bits alone don't say.
+    */
+    bool isRegisterStateEnabled (uint64_t mask) noexcept
+    {
+       #if defined (_MSC_VER)
+        int info[4];
+        __cpuid (info, 1);
+
+        if ((info[2] & (1 << 27)) == 0)         // no OSXSAVE, so no XGETBV either
+            return false;
+
+        return (_xgetbv (0) & mask) == mask;
+       #else
+        unsigned int eax, ebx, ecx, edx;
+
+        if (! __get_cpuid (1, &eax, &ebx, &ecx, &edx) || (ecx & (1u << 27)) == 0)
+            return false;
+
+        unsigned int low, high;
+        __asm__ ("xgetbv" : "=a" (low), "=d" (high) : "c" (0));
+        return ((((uint64_t) high << 32) | low) & mask) == mask;
+       #endif
+    }
+   #endif
+
+   #if REVERSATRON_HAS_AVX512_KERNELS
+    bool canRunAVX512() noexcept
+    {
+        return juce::SystemStats::hasAVX512F() && juce::SystemStats::hasFMA3() && isRegisterStateEnabled (avx512State);
+    }
+   #endif
+
+   #if REVERSATRON_HAS_AVX2_KERNELS
+    bool canRunAVX2() noexcept
+    {
+        return juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3() && isRegisterStateEnabled (avxState);
+    }
+   #endif
+
+    const Dispatch::KernelSet& selectKernels() noexcept
+    {
+        // REVERSATRON_KERNELS=baseline or avx2 caps the choice, to compare
+        // the builds on one machine.
+        int maxLevel = 2;
+
+        if (const auto* limit = std::getenv ("REVERSATRON_KERNELS"))
+            maxLevel = std::strcmp (limit, "baseline") == 0 ? 0
+                     : std::strcmp (limit, "avx2") == 0     ? 1 : 2;
+
+       #if REVERSATRON_HAS_AVX512_KERNELS
+        if (maxLevel >= 2 && canRunAVX512())
+            return Dispatch::avx512Kernels;
+       #endif
+
+       #if REVERSATRON_HAS_AVX2_KERNELS
+        if (maxLevel >= 1 && canRunAVX2())
+            return Dispatch::avx2Kernels;
+       #endif
+
+        juce::ignoreUnused (maxLevel);
+        return baselineKernels;
+    }
+
+    // Picked once, as the code is loaded. Anything that runs before that (in
+    // another file's static initialisation) gets the baseline kernels.
+    const Dispatch::KernelSet* kernels = &baselineKernels;
+    [[maybe_unused]] const bool kernelsSelected = (kernels = &selectKernels(), true);
+}
+
+const char* getInstructionSet() noexcept
+{
+    return kernels->name;
+}
+
+std::vector<const Dispatch::KernelSet*> Dispatch::getSupportedKernelSets()
+{
+    std::vector<const KernelSet*> sets { &baselineKernels };
+
+   #if REVERSATRON_HAS_AVX2_KERNELS
+    if (canRunAVX2())
+        sets.push_back (&avx2Kernels);
+   #endif
+
+   #if REVERSATRON_HAS_AVX512_KERNELS
+    if (canRunAVX512())
+        sets.push_back (&avx512Kernels);
+   #endif
+
+    return sets;
+}
+
+void reverseCopy (float* dest, const float* src, int num) noexcept
+{
+    kernels->floats.reverseCopy (dest, src, num);
+}
+
+void reverseCopy (double* dest, const double* src, int num) noexcept
+{
+    kernels->doubles.reverseCopy (dest, src, num);
+}
+
+void reverseCrossfade (float* dest, const float* src, int num, float wetGainStart, float wetGainStep) noexcept
+{
+    kernels->floats.reverseCrossfade (dest, src, num, wetGainStart, wetGainStep);
+}
+
+void reverseCrossfade (double* dest, const double* src, int num, float wetGainStart, float wetGainStep) noexcept
+{
+    kernels->doubles.reverseCrossfade (dest, src, num, wetGainStart, wetGainStep);
+}
+
+void crossfade (float* dest, const float* src, int num, float wetGainStart, float wetGainStep) noexcept
+{
+    kernels->floats.crossfade (dest, src, num, wetGainStart, wetGainStep);
+}
+
+void crossfade (double* dest, const double* src, int num, float wetGainStart, float wetGainStep) noexcept
+{
+    kernels->doubles.crossfade (dest, src, num, wetGainStart, wetGainStep);
+}
+
+void reverseMix (float* dest, const float* src, int num, float gainStart, float gainStep) noexcept
+{
+    kernels->floats.reverseMix (dest, src, num, gainStart, gainStep);
+}
+
+void reverseMix (double* dest, const double* src, int num, float gainStart, float gainStep) noexcept
+{
+    kernels->doubles.reverseMix (dest, src, num, gainStart, gainStep);
+}
+
+void mix (float* dest, const float* src, int num, float gainStart, float gainStep) noexcept
+{
+    kernels->floats.mix (dest, src, num, gainStart, gainStep);
+}
+
+void mix (double* dest, const double* src, int num, float gainStart, float gainStep) noexcept
+{
+    kernels->doubles.mix (dest, src, num, gainStart, gainStep);
+}
+
+void countUnusualSamples (const float* src, int num, int& numNonFinite, int& numDenormal) noexcept
+{
+    // Classified from the bit patterns: an all-ones exponent is NaN or
+    // infinity, a zero exponent with a non-zero mantissa is denormal.
+    constexpr uint32_t exponentMask = 0x7f800000, mantissaMask = 0x007fffff;
+    int i = 0;
+
+   #if REVERSATRON_USE_SSE2
+    const auto vExponentMask = _mm_set1_epi32 ((int) exponentMask);
+    const auto vMantissaMask = _mm_set1_epi32 ((int) mantissaMask);
+    const auto zero = _mm_setzero_si128();
+    auto nonFinite = zero, denormal = zero;
+
+    for (; i + 4 <= num; i += 4)
+    {
+        const auto bits = _mm_castps_si128 (_mm_loadu_ps (src + i));
+        const auto exponent = _mm_and_si128 (bits, vExponentMask);
+        const auto mantissa = _mm_and_si128 (bits, vMantissaMask);
+
+        // The comparisons give -1 per matching lane, so subtracting counts them.
+        nonFinite = _mm_sub_epi32 (nonFinite, _mm_cmpeq_epi32 (exponent, vExponentMask));
+        denormal = _mm_sub_epi32 (denormal, _mm_andnot_si128 (_mm_cmpeq_epi32 (mantissa, zero),
+                                                              _mm_cmpeq_epi32 (exponent, zero)));
+    }
+
+    alignas (16) int32_t counts[8];
+    _mm_store_si128 (reinterpret_cast<__m128i*> (counts), nonFinite);
+    _mm_store_si128 (reinterpret_cast<__m128i*> (counts + 4), denormal);
+    numNonFinite += counts[0] + counts[1] + counts[2] + counts[3];
+    numDenormal += counts[4] + counts[5] + counts[6] + counts[7];
+   #elif REVERSATRON_USE_NEON
+    const auto vExponentMask = vdupq_n_u32 (exponentMask);
+    const auto vMantissaMask = vdupq_n_u32 (mantissaMask);
+    const auto zero = vdupq_n_u32 (0);
+    auto nonFinite = zero, denormal = zero;
+
+    for (; i + 4 <= num; i += 4)
+    {
+        const auto bits = vreinterpretq_u32_f32 (vld1q_f32 (src + i));
+        const auto exponent = vandq_u32 (bits, vExponentMask);
+        const auto mantissa = vandq_u32 (bits, vMantissaMask);
+
+        nonFinite = vsubq_u32 (nonFinite, vceqq_u32 (exponent, vExponentMask));
+        denormal = vsubq_u32 (denormal, vbicq_u32 (vceqq_u32 (exponent, zero), vceqq_u32 (mantissa, zero)));
+    }
+
+    uint32_t counts[8];
+    vst1q_u32 (counts, nonFinite);
+    vst1q_u32 (counts + 4, denormal);
+    numNonFinite += (int) (counts[0] + counts[1] + counts[2] + counts[3]);
+    numDenormal += (int) (counts[4] + counts[5] + counts[6] + counts[7]);
+   #endif
+
+    for (; i < num; ++i)
+    {
+        uint32_t bits;
+        std::memcpy (&bits, src + i, sizeof (bits));
+
+        if ((bits & exponentMask) == exponentMask)
+            ++numNonFinite;
+        else if ((bits & exponentMask) == 0 && (bits & mantissaMask) != 0)
+            ++numDenormal;
+    }
+}
+
+void countUnusualSamples (const double* src, int num, int& numNonFinite, int& numDenormal) noexcept
+{
+    // The same classification on the 64-bit layout. Compilers vectorise this
+    // loop well enough on their own.
+    constexpr uint64_t exponentMask = 0x7ff0000000000000ull, mantissaMask = 0x000fffffffffffffull;
+
+    for (int i = 0; i < num; ++i)
+    {
+        uint64_t bits;
+        std::memcpy (&bits, src + i, sizeof (bits));
+
+        if ((bits & exponentMask) == exponentMask)
+            ++numNonFinite;
+        else if ((bits & exponentMask) == 0 && (bits & mantissaMask) != 0)
+            ++numDenormal;
+    }
+}
+
+float findPeak (const float* src, int num) noexcept
+{
+    int i = 0;
+    auto peak = 0.0f;
+
+   #if REVERSATRON_USE_SSE2
+    // The absolute value is the sample with its sign bit cleared.
+    const auto absMask = _mm_castsi128_ps (_mm_set1_epi32 (0x7fffffff));
+    auto max0 = _mm_setzero_ps(), max1 = _mm_setzero_ps();
+
+    for (; i + 8 <= num; i += 8)
+    {
+        max0 = _mm_max_ps (max0, _mm_and_ps (_mm_loadu_ps (src + i), absMask));
+        max1 = _mm_max_ps (max1, _mm_and_ps (_mm_loadu_ps (src + i + 4), absMask));
+    }
+
+    alignas (16) float lanes[4];
+    _mm_store_ps (lanes, _mm_max_ps (max0, max1));
+    peak = juce::jmax (juce::jmax (lanes[0], lanes[1]), juce::jmax (lanes[2], lanes[3]));
+   #elif REVERSATRON_USE_NEON
+    auto max0 = vdupq_n_f32 (0.0f), max1 = vdupq_n_f32 (0.0f);
+
+    for (; i + 8 <= num; i += 8)
+    {
+        max0 = vmaxq_f32 (max0, vabsq_f32 (vld1q_f32 (src + i)));
+        max1 = vmaxq_f32 (max1, vabsq_f32 (vld1q_f32 (src + i + 4)));
+    }
+
+    const auto m = vmaxq_f32 (max0, max1);
+    const auto pair = vpmax_f32 (vget_low_f32 (m), vget_high_f32 (m));
+    peak = vget_lane_f32 (vpmax_f32 (pair, pair), 0);
+   #endif
+
+    for (; i < num; ++i)
+        peak = juce::jmax (peak, std::abs (src[i]));
+
+    return peak;
+}
+
+float findPeak (const double* src, int num) noexcept
+{
+    int i = 0;
+    auto peak = 0.0;
+
+   #if REVERSATRON_USE_SSE2
+    const auto absMask = _mm_castsi128_pd (_mm_set1_epi64x (0x7fffffffffffffffll));
+    auto max0 = _mm_setzero_pd(), max1 = _mm_setzero_pd();
+
+    for (; i + 4 <= num; i += 4)
+    {
+        max0 = _mm_max_pd (max0, _mm_and_pd (_mm_loadu_pd (src + i), absMask));
+        max1 = _mm_max_pd (max1, _mm_and_pd (_mm_loadu_pd (src + i + 2), absMask));
+    }
+
+    alignas (16) double lanes[2];
+    _mm_store_pd (lanes, _mm_max_pd (max0, max1));
+    peak = juce::jmax (lanes[0], lanes[1]);
+   #elif REVERSATRON_USE_NEON_DOUBLE
+    auto max0 = vdupq_n_f64 (0.0), max1 = vdupq_n_f64 (0.0);
+
+    for (; i + 4 <= num; i += 4)
+    {
+        max0 = vmaxq_f64 (max0, vabsq_f64 (vld1q_f64 (src + i)));
+        max1 = vmaxq_f64 (max1, vabsq_f64 (vld1q_f64 (src + i + 2)));
+    }
+
+    peak = vmaxvq_f64 (vmaxq_f64 (max0, max1));
+   #endif
+
+    for (; i < num; ++i)
+        peak = juce::jmax (peak, std::abs (src[i]));
+
+    return static_cast<float> (peak);
+}
+
+int findFirstAbove (const float* src, int num, float threshold) noexcept
+{
+    int i = 0;
+
+    // Four samples are compared at a time, and only a group with a match is
+    // looked at one by one.
+   #if REVERSATRON_USE_SSE2
+    const auto absMask = _mm_castsi128_ps (_mm_set1_epi32 (0x7fffffff));
+    const auto level = _mm_set1_ps (threshold);
+
+    for (; i + 4 <= num; i += 4)
+        if (_mm_movemask_ps (_mm_cmpge_ps (_mm_and_ps (_mm_loadu_ps (src + i), absMask), level)) != 0)
+            break;
+   #elif REVERSATRON_USE_NEON
+    const auto level = vdupq_n_f32 (threshold);
+
+    for (; i + 4 <= num; i += 4)
+    {
+        const auto matches = vcageq_f32 (vld1q_f32 (src + i), level);
+        const auto pair = vpmax_u32 (vget_low_u32 (matches), vget_high_u32 (matches));
+
+        if (vget_lane_u32 (vpmax_u32 (pair, pair), 0) != 0)
+            break;
+    }
+   #endif
+
+    for (; i < num; ++i)
+        if (std::abs (src[i]) >= threshold)
+            return i;
+
+    return num;
+}
+
+int findFirstAbove (const double* src, int num, float threshold) noexcept
+{
+    int i = 0;
+
+   #if REVERSATRON_USE_SSE2
+    const auto absMask = _mm_castsi128_pd (_mm_set1_epi64x (0x7fffffffffffffffll));
+    const auto level = _mm_set1_pd ((double) threshold);
+
+    for (; i + 4 <= num; i += 4)
+    {
+        const auto a = _mm_cmpge_pd (_mm_and_pd (_mm_loadu_pd (src + i), absMask), level);
+        const auto b = _mm_cmpge_pd (_mm_and_pd (_mm_loadu_pd (src + i + 2), absMask), level);
+
+        if (_mm_movemask_pd (_mm_or_pd (a, b)) != 0)
+            break;
+    }
+   #elif REVERSATRON_USE_NEON_DOUBLE
+    const auto level = vdupq_n_f64 ((double) threshold);
+
+    for (; i + 4 <= num; i += 4)
+    {
+        const auto matches = vorrq_u64 (vcageq_f64 (vld1q_f64 (src + i), level),
+                                        vcageq_f64 (vld1q_f64 (src + i + 2), level));
+
+        if ((vgetq_lane_u64 (matches, 0) | vgetq_lane_u64 (matches, 1)) != 0)
+            break;
+    }
+   #endif
+
+    for (; i < num; ++i)
+        if (std::abs (src[i]) >= (double) threshold)
+            return i;
+
+    return num;
+}
+
+void interpolateLinear (float* dest, const float* src, int num, double start, double step) noexcept
+{
+    int i = 0;
+
+    // The read positions are worked out in double precision; only the blend
+    // itself is vectorised, as SSE2 and NEON have no gather.
+   #if REVERSATRON_USE_SSE2
+    for (; i + 4 <= num; i += 4)
+    {
+        alignas (16) float x0[4], x1[4], fraction[4];
+
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            const auto t = start + (i + lane) * step;
+            const auto index = static_cast<int> (t);
+            x0[lane] = src[index];
+            x1[lane] = src[index + 1];
+            fraction[lane] = static_cast<float> (t - index);
+        }
+
+        const auto a = _mm_load_ps (x0);
+        _mm_storeu_ps (dest + i, _mm_add_ps (a, _mm_mul_ps (_mm_sub_ps (_mm_load_ps (x1), a), _mm_load_ps (fraction))));
+    }
+   #elif REVERSATRON_USE_NEON
+    for (; i + 4 <= num; i += 4)
+    {
+        alignas (16) float x0[4], x1[4], fraction[4];
+
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            const auto t = start + (i + lane) * step;
+            const auto index = static_cast<int> (t);
+            x0[lane] = src[index];
+            x1[lane] = src[index + 1];
+            fraction[lane] = static_cast<float> (t - index);
+        }
+
+        const auto a = vld1q_f32 (x0);
+        vst1q_f32 (dest + i, vmlaq_f32 (a, vsubq_f32 (vld1q_f32 (x1), a), vld1q_f32 (fraction)));
+    }
+   #endif
+
+    for (; i < num; ++i)
+    {
+        const auto t = start + i * step;
+        const auto index = static_cast<int> (t);
+        const auto fraction = static_cast<float> (t - index);
+        dest[i] = src[index] + (src[index + 1] - src[index]) * fraction;
+    }
+}
+
+void interpolateLinear (double* dest, const double* src, int num, double start, double step) noexcept
+{
+    // With only two lanes, and no gather, there's nothing to gain from
+    // vectorising the blend.
+    for (int i = 0; i < num; ++i)
+    {
+        const auto t = start + i * step;
+        const auto index = static_cast<int> (t);
+        const auto fraction = t - index;
+        dest[i] = src[index] + (src[index + 1] - src[index]) * fraction;
+    }
+}
+
+void interpolatePolyphase (float* dest, const float* src, int num, double start, double step,
+                           const float* table, int numTaps, int numPhases) noexcept
+{
+    jassert (numTaps % 4 == 0);
+
+    for (int i = 0; i < num; ++i)
+    {
+        const auto t = start + i * step;
+        const auto index = static_cast<int> (t);
+        const auto phase = (t - index) * numPhases;
+        const auto row = juce::jmin (static_cast<int> (phase), numPhases - 1);
+        const auto blend = static_cast<float> (phase - row);
+
+        const auto* x = src + index - numTaps / 2 + 1;
+        const auto* h0 = table + row * numTaps;
+        const auto* h1 = h0 + numTaps;
+
+        // Both neighbouring rows are applied and the results blended, which
+        // is the same as blending the coefficients but needs no extra pass.
+       #if REVERSATRON_USE_SSE2
+        auto sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+
+        for (int tap = 0; tap < numTaps; tap += 4)
+        {
+            const auto samples = _mm_loadu_ps (x + tap);
+            sum0 = _mm_add_ps (sum0, _mm_mul_ps (samples, _mm_loadu_ps (h0 + tap)));
+            sum1 = _mm_add_ps (sum1, _mm_mul_ps (samples, _mm_loadu_ps (h1 + tap)));
+        }
+
+        alignas (16) float sums0[4], sums1[4];
+        _mm_store_ps (sums0, sum0);
+        _mm_store_ps (sums1, sum1);
+        const auto y0 = (sums0[0] + sums0[1]) + (sums0[2] + sums0[3]);
+        const auto y1 = (sums1[0] + sums1[1]) + (sums1[2] + sums1[3]);
+       #elif REVERSATRON_USE_NEON
+        auto sum0 = vdupq_n_f32 (0.0f), sum1 = vdupq_n_f32 (0.0f);
+
+        for (int tap = 0; tap < numTaps; tap += 4)
+        {
+            const auto samples = vld1q_f32 (x + tap);
+            sum0 = vmlaq_f32 (sum0, samples, vld1q_f32 (h0 + tap));
+            sum1 = vmlaq_f32 (sum1, samples, vld1q_f32 (h1 + tap));
+        }
+
+        const auto pair0 = vadd_f32 (vget_low_f32 (sum0), vget_high_f32 (sum0));
+        const auto pair1 = vadd_f32 (vget_low_f32 (sum1), vget_high_f32 (sum1));
+        const auto y0 = vget_lane_f32 (vpadd_f32 (pair0, pair0), 0);
+        const auto y1 = vget_lane_f32 (vpadd_f32 (pair1, pair1), 0);
+       #else
+        auto y0 = 0.0f, y1 = 0.0f;
+
+        for (int tap = 0; tap < numTaps; ++tap)
+        {
+            y0 += x[tap] * h0[tap];
+            y1 += x[tap] * h1[tap];
+        }
+       #endif
+
+        dest[i] = y0 + (y1 - y0) * blend;
+    }
+}
+
+void interpolatePolyphase (double* dest, const double* src, int num, double start, double step,
+                           const float* table, int numTaps, int numPhases) noexcept
+{
+    jassert (numTaps % 4 == 0);
+
+    for (int i = 0; i < num; ++i)
+    {
+        const auto t = start + i * step;
+        const auto index = static_cast<int> (t);
+        const auto phase = (t - index) * numPhases;
+        const auto row = juce::jmin (static_cast<int> (phase), numPhases - 1);
+        const auto blend = phase - row;
+
+        const auto* x = src + index - numTaps / 2 + 1;
+        const auto* h0 = table + row * numTaps;
+        const auto* h1 = h0 + numTaps;
+
+        // The coefficients are widened four at a time; the sums are kept in
+        // double precision throughout.
+       #if REVERSATRON_USE_SSE2
+        auto sum0 = _mm_setzero_pd(), sum1 = _mm_setzero_pd();
+
+        for (int tap = 0; tap < numTaps; tap += 4)
+        {
+            const auto c0 = _mm_loadu_ps (h0 + tap);
+            const auto c1 = _mm_loadu_ps (h1 + tap);
+            const auto samplesLo = _mm_loadu_pd (x + tap);
+            const auto samplesHi = _mm_loadu_pd (x + tap + 2);
+
+            sum0 = _mm_add_pd (sum0, _mm_mul_pd (samplesLo, _mm_cvtps_pd (c0)));
+            sum0 = _mm_add_pd (sum0, _mm_mul_pd (samplesHi, _mm_cvtps_pd (_mm_movehl_ps (c0, c0))));
+            sum1 = _mm_add_pd (sum1, _mm_mul_pd (samplesLo, _mm_cvtps_pd (c1)));
+            sum1 = _mm_add_pd (sum1, _mm_mul_pd (samplesHi, _mm_cvtps_pd (_mm_movehl_ps (c1, c1))));
+        }
+
+        alignas (16) double sums0[2], sums1[2];
+        _mm_store_pd (sums0, sum0);
+        _mm_store_pd (sums1, sum1);
+        const auto y0 = sums0[0] + sums0[1];
+        const auto y1 = sums1[0] + sums1[1];
+       #else
+        auto y0 = 0.0, y1 = 0.0;
+
+        for (int tap = 0; tap < numTaps; ++tap)
+        {
+            y0 += x[tap] * (double) h0[tap];
+            y1 += x[tap] * (double) h1[tap];
+        }
+       #endif
+
+        dest[i] = y0 + (y1 - y0) * blend;
+    }
+}
+
+//==============================================================================
+namespace
+{
+    // The scalar version of the SSE2 loops below, giving the same results:
+    // NaN clips to -1 as _mm_max_ps() makes it, and lrintf() rounds halves
+    // to even (in the default rounding mode) as _mm_cvtps_epi32() does.
+    inline int32_t quantiseSample (float sample, float scale) noexcept
+    {
+        sample = sample > -1.0f ? sample : -1.0f;
+        sample = sample < 1.0f ? sample : 1.0f;
+        return static_cast<int32_t> (std::lrintf (sample * scale));
+    }
+}
+
+void quantise (int32_t* dest, const float* src, int num, float scale) noexcept
+{
+    int i = 0;
+
+   #if REVERSATRON_USE_SSE2
+    const auto vScale = _mm_set1_ps (scale);
+    const auto vMin = _mm_set1_ps (-1.0f);
+    const auto vMax = _mm_set1_ps (1.0f);
+
+    for (; i + 4 <= num; i += 4)
+    {
+        auto v = _mm_min_ps (_mm_max_ps (_mm_loadu_ps (src + i), vMin), vMax);
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (dest + i), _mm_cvtps_epi32 (_mm_mul_ps (v, vScale)));
+    }
+   #endif
+
+    for (; i < num; ++i)
+        dest[i] = quantiseSample (src[i], scale);
+}
+
+void encodeInt16 (int16_t* dest, const float* src, int num) noexcept
+{
+    int i = 0;
+
+   #if REVERSATRON_USE_SSE2
+    const auto vScale = _mm_set1_ps (int16Scale);
+    const auto vMin = _mm_set1_ps (-1.0f);
+    const auto vMax = _mm_set1_ps (1.0f);
+
+    for (; i + 8 <= num; i += 8)
+    {
+        auto a = _mm_min_ps (_mm_max_ps (_mm_loadu_ps (src + i),     vMin), vMax);
+        auto b = _mm_min_ps (_mm_max_ps (_mm_loadu_ps (src + i + 4), vMin), vMax);
+        auto packed = _mm_packs_epi32 (_mm_cvtps_epi32 (_mm_mul_ps (a, vScale)),
+                                       _mm_cvtps_epi32 (_mm_mul_ps (b, vScale)));
+        _mm_storeu_si128 (reinterpret_cast<__m128i*> (dest + i), packed);
+    }
+   #endif
+
+    for (; i < num; ++i)
+        dest[i] = static_cast<int16_t> (quantiseSample (src[i], int16Scale));
+}
+
+void reverseDecodeInt16 (float* dest, const int16_t* src, int num) noexcept
+{
+    constexpr auto scale = 1.0f / int16Scale;
+    int i = 0;
+
+   #if REVERSATRON_USE_SSE2
+    const auto vScale = _mm_set1_ps (scale);
+
+    for (; i + 8 <= num; i += 8)
+    {
+        auto v = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (src + num - i - 8));
+
+        // Reverse the eight 16-bit lanes: swap the 32-bit pairs end for end,
+        // then the two halves of each pair.
+        v = _mm_shuffle_epi32 (v, _MM_SHUFFLE (0, 1, 2, 3));
+        v = _mm_shufflelo_epi16 (v, _MM_SHUFFLE (2, 3, 0, 1));
+        v = _mm_shufflehi_epi16 (v, _MM_SHUFFLE (2, 3, 0, 1));
+
+        // Sign-extend to 32 bits by unpacking into the top half and shifting down.
+        auto lo = _mm_srai_epi32 (_mm_unpacklo_epi16 (v, v), 16);
+        auto hi = _mm_srai_epi32 (_mm_unpackhi_epi16 (v, v), 16);
+
+        _mm_storeu_ps (dest + i,     _mm_mul_ps (_mm_cvtepi32_ps (lo), vScale));
+        _mm_storeu_ps (dest + i + 4, _mm_mul_ps (_mm_cvtepi32_ps (hi), vScale));
+    }
+   #endif
+
+    for (; i < num; ++i)
+        dest[i] = static_cast<float> (src[num - 1 - i]) * scale;
+}
+
+void encodeInt24 (uint8_t* dest, const float* src, int num) noexcept
+{
+    constexpr int chunk = 64;
+    int32_t quantised[chunk];
+
+    for (int done = 0; done < num; done += chunk)
+    {
+        const auto n = juce::jmin (chunk, num - done);
+        quantise (quantised, src + done, n, int24Scale);
+
+        for (int i = 0; i < n; ++i)
+        {
+            const auto v = static_cast<uint32_t> (quantised[i]);
+            auto* d = dest + 3 * (done + i);
+            d[0] = static_cast<uint8_t> (v);
+            d[1] = static_cast<uint8_t> (v >> 8);
+            d[2] = static_cast<uint8_t> (v >> 16);
+        }
+    }
+}
+
+void reverseDecodeInt24 (float* dest, const uint8_t* src, int num) noexcept
+{
+    constexpr auto scale = 1.0f / int24Scale;
+
+    for (int i = 0; i < num; ++i)
+    {
+        const auto* s = src + 3 * (num - 1 - i);
+
+        // Assemble in the top 24 bits so the arithmetic shift sign-extends.
+        const auto v = static_cast<int32_t> ((static_cast<uint32_t> (s[0]) << 8)
+                                           | (static_cast<uint32_t> (s[1]) << 16)
+                                           | (static_cast<uint32_t> (s[2]) << 24)) >> 8;
+        dest[i] = static_cast<float> (v) * scale;
+    }
+}
+
+}
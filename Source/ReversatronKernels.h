@@ -0,0 +1,125 @@
+/*
+  ==============================================================================
+
+    Block kernels used by the record and reversed playback paths.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Vectorised helpers for moving audio in and out of the reverse buffer.
+
+    The playback kernels come in float and double versions, for the two
+    precisions the processor runs at; gains and filter coefficients are
+    always floats.
+
+    The reverse, crossfade and mix kernels are also built for AVX2 and
+    AVX-512 on x86, and the widest version this machine can run is picked
+    once, when the code is loaded (see getInstructionSet()). The rest are
+    SSE2 or NEON only.
+
+    All of the reverse kernels take a pointer to the first of `num` samples in
+    their original (recorded) order, and write them to the destination last
+    sample first.
+*/
+namespace ReversatronKernels
+{
+    /** The instruction set the playback kernels were picked for, e.g. "AVX2". */
+    const char* getInstructionSet() noexcept;
+
+    /** dest[i] = src[num - 1 - i] */
+    void reverseCopy (float* dest, const float* src, int num) noexcept;
+    void reverseCopy (double* dest, const double* src, int num) noexcept;
+
+    /** Crossfades reversed samples over the dry signal already in dest:
+
+            dest[i] = dest[i] * (1 - g) + src[num - 1 - i] * g,   g = wetGainStart + i * wetGainStep
+    */
+    void reverseCrossfade (float* dest, const float* src, int num,
+                           float wetGainStart, float wetGainStep) noexcept;
+    void reverseCrossfade (double* dest, const double* src, int num,
+                           float wetGainStart, float wetGainStep) noexcept;
+
+    /** As reverseCrossfade(), for samples that are already in playback order. */
+    void crossfade (float* dest, const float* src, int num,
+                    float wetGainStart, float wetGainStep) noexcept;
+    void crossfade (double* dest, const double* src, int num,
+                    float wetGainStart, float wetGainStep) noexcept;
+
+    /** Adds reversed samples into dest, with a gain ramp:
+
+            dest[i] += src[num - 1 - i] * g,   g = gainStart + i * gainStep
+    */
+    void reverseMix (float* dest, const float* src, int num,
+                     float gainStart, float gainStep) noexcept;
+    void reverseMix (double* dest, const double* src, int num,
+                     float gainStart, float gainStep) noexcept;
+
+    /** As reverseMix(), for samples that are already in playback order. */
+    void mix (float* dest, const float* src, int num,
+              float gainStart, float gainStep) noexcept;
+    void mix (double* dest, const double* src, int num,
+              float gainStart, float gainStep) noexcept;
+
+    /** Counts the NaN/infinite and the denormal samples in src, adding them
+        to numNonFinite and numDenormal.
+    */
+    void countUnusualSamples (const float* src, int num, int& numNonFinite, int& numDenormal) noexcept;
+    void countUnusualSamples (const double* src, int num, int& numNonFinite, int& numDenormal) noexcept;
+
+    /** The largest absolute value in src, or 0 if num is 0. */
+    float findPeak (const float* src, int num) noexcept;
+    float findPeak (const double* src, int num) noexcept;
+
+    /** The index of the first sample in src whose absolute value is at
+        least threshold, or num if there isn't one. It stops looking as soon
+        as it finds one.
+    */
+    int findFirstAbove (const float* src, int num, float threshold) noexcept;
+    int findFirstAbove (const double* src, int num, float threshold) noexcept;
+
+    /** Reads src at fractional positions t = start + i * step, interpolating
+        linearly between src[floor (t)] and src[floor (t) + 1].
+    */
+    void interpolateLinear (float* dest, const float* src, int num, double start, double step) noexcept;
+    void interpolateLinear (double* dest, const double* src, int num, double start, double step) noexcept;
+
+    /** Reads src at fractional positions t = start + i * step through a
+        polyphase FIR: each output is the dot product of the numTaps samples
+        from src[floor (t) - numTaps / 2 + 1] with a row of coefficients,
+        blended between the two of table's numPhases + 1 rows either side of
+        t's fractional part. numTaps must be a multiple of 4.
+    */
+    void interpolatePolyphase (float* dest, const float* src, int num, double start, double step,
+                               const float* table, int numTaps, int numPhases) noexcept;
+    void interpolatePolyphase (double* dest, const double* src, int num, double start, double step,
+                               const float* table, int numTaps, int numPhases) noexcept;
+
+    //==============================================================================
+    /** Full-scale values used by the fixed-point capture formats. Input is
+        clipped to +/-1 (NaN to -1) before quantising, and rounded half to
+        even, the same on every code path.
+    */
+    constexpr float int16Scale = 32767.0f;
+    constexpr float int24Scale = 8388607.0f;
+
+    /** dest[i] = round (clip (src[i]) * scale) */
+    void quantise (int32_t* dest, const float* src, int num, float scale) noexcept;
+
+    /** Quantises to 16 bits. */
+    void encodeInt16 (int16_t* dest, const float* src, int num) noexcept;
+
+    /** dest[i] = src[num - 1 - i] / int16Scale */
+    void reverseDecodeInt16 (float* dest, const int16_t* src, int num) noexcept;
+
+    /** Quantises to little-endian, 3-byte packed 24-bit samples. */
+    void encodeInt24 (uint8_t* dest, const float* src, int num) noexcept;
+
+    /** Reversed decode of encodeInt24() data; src points to the first of num packed samples. */
+    void reverseDecodeInt24 (float* dest, const uint8_t* src, int num) noexcept;
+}
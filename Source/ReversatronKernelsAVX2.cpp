@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    AVX2 versions of the playback kernels.
+
+  ==============================================================================
+*/
+
+#include "ReversatronKernelsWide.h"
+
+#if REVERSATRON_HAS_AVX2_KERNELS
+
+#if ! defined (__AVX2__)
+ #error "This file must be compiled with AVX2 and FMA enabled (see CMakeLists.txt)"
+#endif
+
+#include <immintrin.h>
+
+namespace ReversatronKernels::Dispatch
+{
+
+namespace
+{
+    struct FloatOps
+    {
+        using Sample = float;
+        using Vector = __m256;
+        static constexpr int width = 8;
+
+        static Vector load (const float* p) noexcept                { return _mm256_loadu_ps (p); }
+        static void store (float* p, Vector v) noexcept             { _mm256_storeu_ps (p, v); }
+        static Vector broadcast (float x) noexcept                  { return _mm256_set1_ps (x); }
+        static Vector add (Vector a, Vector b) noexcept             { return _mm256_add_ps (a, b); }
+        static Vector sub (Vector a, Vector b) noexcept             { return _mm256_sub_ps (a, b); }
+        static Vector multiplyAdd (Vector a, Vector b, Vector c) noexcept { return _mm256_fmadd_ps (a, b, c); }
+
+        static Vector loadReversed (const float* p) noexcept
+        {
+            return _mm256_permutevar8x32_ps (_mm256_loadu_ps (p), _mm256_setr_epi32 (7, 6, 5, 4, 3, 2, 1, 0));
+        }
+
+        static Vector ramp (float step) noexcept
+        {
+            return _mm256_mul_ps (_mm256_setr_ps (0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f), _mm256_set1_ps (step));
+        }
+    };
+
+    struct DoubleOps
+    {
+        using Sample = double;
+        using Vector = __m256d;
+        static constexpr int width = 4;
+
+        static Vector load (const double* p) noexcept               { return _mm256_loadu_pd (p); }
+        static void store (double* p, Vector v) noexcept            { _mm256_storeu_pd (p, v); }
+        static Vector broadcast (double x) noexcept                 { return _mm256_set1_pd (x); }
+        static Vector add (Vector a, Vector b) noexcept             { return _mm256_add_pd (a, b); }
+        static Vector sub (Vector a, Vector b) noexcept             { return _mm256_sub_pd (a, b); }
+        static Vector multiplyAdd (Vector a, Vector b, Vector c) noexcept { return _mm256_fmadd_pd (a, b, c); }
+
+        static Vector loadReversed (const double* p) noexcept
+        {
+            return _mm256_permute4x64_pd (_mm256_loadu_pd (p), _MM_SHUFFLE (0, 1, 2, 3));
+        }
+
+        static Vector ramp (float step) noexcept
+        {
+            return _mm256_mul_pd (_mm256_setr_pd (0.0, 1.0, 2.0, 3.0), _mm256_set1_pd ((double) step));
+        }
+    };
+}
+
+const KernelSet avx2Kernels { "AVX2",
+                              Wide::makePlaybackKernels<FloatOps>(),
+                              Wide::makePlaybackKernels<DoubleOps>() };
+
+}
+
+#endif
@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    AVX-512 versions of the playback kernels.
+
+  ==============================================================================
+*/
+
+#include "ReversatronKernelsWide.h"
+
+#if REVERSATRON_HAS_AVX512_KERNELS
+
+#if ! defined (__AVX512F__)
+ #error "This file must be compiled with AVX-512F enabled (see CMakeLists.txt)"
+#endif
+
+#include <immintrin.h>
+
+namespace ReversatronKernels::Dispatch
+{
+
+namespace
+{
+    struct FloatOps
+    {
+        using Sample = float;
+        using Vector = __m512;
+        static constexpr int width = 16;
+
+        static Vector load (const float* p) noexcept                { return _mm512_loadu_ps (p); }
+        static void store (float* p, Vector v) noexcept             { _mm512_storeu_ps (p, v); }
+        static Vector broadcast (float x) noexcept                  { return _mm512_set1_ps (x); }
+        static Vector add (Vector a, Vector b) noexcept             { return _mm512_add_ps (a, b); }
+        static Vector sub (Vector a, Vector b) noexcept             { return _mm512_sub_ps (a, b); }
+        static Vector multiplyAdd (Vector a, Vector b, Vector c) noexcept { return _mm512_fmadd_ps (a, b, c); }
+
+        static Vector loadReversed (const float* p) noexcept
+        {
+            const auto indices = _mm512_setr_epi32 (15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+            return _mm512_permutexvar_ps (indices, _mm512_loadu_ps (p));
+        }
+
+        static Vector ramp (float step) noexcept
+        {
+            const auto lanes = _mm512_setr_ps (0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f,
+                                               8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f);
+            return _mm512_mul_ps (lanes, _mm512_set1_ps (step));
+        }
+    };
+
+    struct DoubleOps
+    {
+        using Sample = double;
+        using Vector = __m512d;
+        static constexpr int width = 8;
+
+        static Vector load (const double* p) noexcept               { return _mm512_loadu_pd (p); }
+        static void store (double* p, Vector v) noexcept            { _mm512_storeu_pd (p, v); }
+        static Vector broadcast (double x) noexcept                 { return _mm512_set1_pd (x); }
+        static Vector add (Vector a, Vector b) noexcept             { return _mm512_add_pd (a, b); }
+        static Vector sub (Vector a, Vector b) noexcept             { return _mm512_sub_pd (a, b); }
+        static Vector multiplyAdd (Vector a, Vector b, Vector c) noexcept { return _mm512_fmadd_pd (a, b, c); }
+
+        static Vector loadReversed (const double* p) noexcept
+        {
+            return _mm512_permutexvar_pd (_mm512_setr_epi64 (7, 6, 5, 4, 3, 2, 1, 0), _mm512_loadu_pd (p));
+        }
+
+        static Vector ramp (float step) noexcept
+        {
+            return _mm512_mul_pd (_mm512_setr_pd (0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0), _mm512_set1_pd ((double) step));
+        }
+    };
+}
+
+const KernelSet avx512Kernels { "AVX-512",
+                                Wide::makePlaybackKernels<FloatOps>(),
+                                Wide::makePlaybackKernels<DoubleOps>() };
+
+}
+
+#endif
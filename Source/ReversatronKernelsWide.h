@@ -0,0 +1,101 @@
+/*
+  ==============================================================================
+
+    The playback kernels, written once for any vector width.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "ReversatronKernelDispatch.h"
+
+//==============================================================================
+/**
+    Included by the AVX2 and AVX-512 kernel sources, each of which supplies
+    an Ops struct per sample type wrapping its intrinsics:
+
+        using Sample, Vector;  static constexpr int width;
+        load, loadReversed, store, broadcast, ramp (lane * step), add, sub,
+        multiplyAdd (a * b + c)
+
+    The arithmetic is the same as the baseline kernels', with the gains
+    recomputed from the segment start every vector, so the results differ
+    from them only by the rounding of the fused multiply-adds.
+
+    Each including file must give its Ops structs internal linkage, so the
+    two builds' instantiations don't collide.
+*/
+namespace ReversatronKernels::Wide
+{
+    template <typename Ops>
+    void reverseCopy (typename Ops::Sample* dest, const typename Ops::Sample* src, int num) noexcept
+    {
+        constexpr auto width = Ops::width;
+        int i = 0;
+
+        for (; i + 2 * width <= num; i += 2 * width)
+        {
+            Ops::store (dest + i,         Ops::loadReversed (src + num - i - width));
+            Ops::store (dest + i + width, Ops::loadReversed (src + num - i - 2 * width));
+        }
+
+        for (; i < num; ++i)
+            dest[i] = src[num - 1 - i];
+    }
+
+    template <typename Ops, bool isReversed>
+    void crossfadeImpl (typename Ops::Sample* dest, const typename Ops::Sample* src, int num,
+                        float wetGainStart, float wetGainStep) noexcept
+    {
+        using Sample = typename Ops::Sample;
+        constexpr auto width = Ops::width;
+        const auto ramp = Ops::ramp (wetGainStep);
+        int i = 0;
+
+        for (; i + width <= num; i += width)
+        {
+            auto gain = Ops::add (Ops::broadcast (static_cast<Sample> (wetGainStart + (float) i * wetGainStep)), ramp);
+            auto dry  = Ops::load (dest + i);
+            auto wet  = isReversed ? Ops::loadReversed (src + num - i - width) : Ops::load (src + i);
+            Ops::store (dest + i, Ops::multiplyAdd (Ops::sub (wet, dry), gain, dry));
+        }
+
+        for (; i < num; ++i)
+        {
+            const auto gain = static_cast<Sample> (wetGainStart + (float) i * wetGainStep);
+            const auto dry = dest[i];
+            dest[i] = dry + ((isReversed ? src[num - 1 - i] : src[i]) - dry) * gain;
+        }
+    }
+
+    template <typename Ops, bool isReversed>
+    void mixImpl (typename Ops::Sample* dest, const typename Ops::Sample* src, int num,
+                  float gainStart, float gainStep) noexcept
+    {
+        using Sample = typename Ops::Sample;
+        constexpr auto width = Ops::width;
+        const auto ramp = Ops::ramp (gainStep);
+        int i = 0;
+
+        for (; i + width <= num; i += width)
+        {
+            auto gain = Ops::add (Ops::broadcast (static_cast<Sample> (gainStart + (float) i * gainStep)), ramp);
+            auto wet  = isReversed ? Ops::loadReversed (src + num - i - width) : Ops::load (src + i);
+            Ops::store (dest + i, Ops::multiplyAdd (wet, gain, Ops::load (dest + i)));
+        }
+
+        for (; i < num; ++i)
+            dest[i] += (isReversed ? src[num - 1 - i] : src[i]) * static_cast<Sample> (gainStart + (float) i * gainStep);
+    }
+
+    template <typename Ops>
+    constexpr Dispatch::PlaybackKernels<typename Ops::Sample> makePlaybackKernels() noexcept
+    {
+        return { &reverseCopy<Ops>,
+                 &crossfadeImpl<Ops, true>,
+                 &crossfadeImpl<Ops, false>,
+                 &mixImpl<Ops, true>,
+                 &mixImpl<Ops, false> };
+    }
+}
@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    Extra reverse voices, layered over the take as it plays back.
+
+  ==============================================================================
+*/
+
+#include "ReverseVoicePool.h"
+#include "ReversatronKernels.h"
+
+//==============================================================================
+void ReverseVoicePool::clear() noexcept
+{
+    numVoices = 0;
+}
+
+void ReverseVoicePool::addVoice (const Voice& voice) noexcept
+{
+    if (numVoices < maxVoices && voice.length > 0)
+        voices[(size_t) numVoices++] = voice;
+}
+
+template <typename SampleType>
+void ReverseVoicePool::mixChannel (CaptureBuffer& buffer, int channel, int playbackStart, int elapsed,
+                                   SampleType* dest, int numSamples, SampleType* scratch, int scratchSize) const noexcept
+{
+    for (int i = 0; i < numVoices; ++i)
+        mixVoice (voices[(size_t) i], buffer, channel, playbackStart, elapsed, dest, numSamples, scratch, scratchSize);
+}
+
+template <typename SampleType>
+void ReverseVoicePool::mixVoice (const Voice& voice, CaptureBuffer& buffer, int channel, int playbackStart, int elapsed,
+                                 SampleType* dest, int numSamples, SampleType* scratch, int scratchSize) noexcept
+{
+    // Split into fade in, plain and fade out segments like the main head,
+    // with the voice's gain folded into each segment's ramp.
+    const auto bufferLength = buffer.getNumSamples();
+    const auto fadeInEnd = voice.fadeLength;
+    const auto fadeOutStart = juce::jmax (fadeInEnd, voice.length - voice.fadeLength + 1);
+    const auto fadeStep = voice.fadeLength > 0 ? voice.gain / static_cast<float> (voice.fadeLength) : 0.0f;
+    const auto end = juce::jmin (elapsed + numSamples, voice.length);
+
+    for (auto frame = elapsed; frame < end;)
+    {
+        int segmentEnd;
+        auto gain = voice.gain, gainStep = 0.0f;
+
+        if (frame < fadeInEnd)
+        {
+            segmentEnd = fadeInEnd;
+            gain = static_cast<float> (frame) * fadeStep;
+            gainStep = fadeStep;
+        }
+        else if (frame < fadeOutStart)
+        {
+            segmentEnd = fadeOutStart;
+        }
+        else
+        {
+            segmentEnd = voice.length;
+            gain = static_cast<float> (voice.length - frame) * fadeStep;
+            gainStep = -fadeStep;
+        }
+
+        const auto num = juce::jmin (end, segmentEnd) - frame;
+        const auto position = playbackStart + voice.offset + frame;
+        auto* segmentDest = dest + (frame - elapsed);
+
+        // Playback position p reads sample (bufferLength - 1 - p), so the
+        // segment covers this forward run of the recording, read backwards.
+        if (auto* src = buffer.getReadPointerAs<SampleType> (channel, bufferLength - position - num, num))
+        {
+            ReversatronKernels::reverseMix (segmentDest, src, num, gain, gainStep);
+        }
+        else
+        {
+            for (int done = 0; done < num; done += scratchSize)
+            {
+                const auto n = juce::jmin (scratchSize, num - done);
+                buffer.readReversed (channel, position + done, scratch, n);
+                ReversatronKernels::mix (segmentDest + done, scratch, n, gain + static_cast<float> (done) * gainStep, gainStep);
+            }
+        }
+
+        frame += num;
+    }
+}
+
+template void ReverseVoicePool::mixChannel (CaptureBuffer&, int, int, int, float*, int, float*, int) const noexcept;
+template void ReverseVoicePool::mixChannel (CaptureBuffer&, int, int, int, double*, int, double*, int) const noexcept;
@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    Extra reverse voices, layered over the take as it plays back.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CaptureBuffer.h"
+
+//==============================================================================
+/**
+    A fixed pool of reverse read heads that play the same take as the main
+    playback head, each with its own start offset, gain, length and fade.
+
+    A voice reads offset playback positions ahead of the main head, starting
+    when playback does, so it plays the take reversed from that far in and
+    stops length frames later. Keeping every voice ahead of the main head
+    means the capture buffer can still let go of whatever the main head has
+    played (see CaptureBuffer::releaseReversed()).
+
+    The voices are set up at the start of each playback, into preallocated
+    slots, and mixed over the output one channel at a time: one vectorised
+    multiply-add per run of each voice (see ReversatronKernels::reverseMix()),
+    so the cost grows in step with the number playing and nothing is
+    allocated on the audio thread. Voices read frames in any order, so they
+    need a random-access buffer.
+
+    Set up from the audio thread; mixChannel() may be called for different
+    channels concurrently.
+*/
+class ReverseVoicePool
+{
+public:
+    static constexpr int maxVoices = 8;
+
+    struct Voice
+    {
+        int offset = 0;         // playback positions ahead of the main head
+        int length = 0;         // frames it plays for
+        int fadeLength = 0;     // frames of fade in at its start and out at its end
+        float gain = 1.0f;
+    };
+
+    /** Removes every voice. */
+    void clear() noexcept;
+
+    /** Adds a voice, if there's a free slot and it has anything to play. */
+    void addVoice (const Voice& voice) noexcept;
+
+    int getNumVoices() const noexcept   { return numVoices; }
+
+    /** Mixes every voice into numSamples frames of one channel's output,
+        from elapsed frames after playback started at playbackStart (a
+        playback position). scratch is used for runs that the buffer can't
+        hand out a pointer to. It's available for float and double samples.
+    */
+    template <typename SampleType>
+    void mixChannel (CaptureBuffer& buffer, int channel, int playbackStart, int elapsed,
+                     SampleType* dest, int numSamples, SampleType* scratch, int scratchSize) const noexcept;
+
+private:
+    template <typename SampleType>
+    static void mixVoice (const Voice& voice, CaptureBuffer& buffer, int channel, int playbackStart, int elapsed,
+                          SampleType* dest, int numSamples, SampleType* scratch, int scratchSize) noexcept;
+
+    std::array<Voice, maxVoices> voices {};
+    int numVoices = 0;
+};
@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    Reads audio at fractional positions, for variable-speed playback and
+    sample rate conversion.
+
+  ==============================================================================
+*/
+
+#include "SampleInterpolator.h"
+#include "ReversatronKernels.h"
+
+namespace
+{
+    // Zeroth-order modified Bessel function of the first kind, for the Kaiser window.
+    double besselI0 (double x) noexcept
+    {
+        auto sum = 1.0, term = 1.0;
+
+        for (int k = 1; k < 32 && term > sum * 1.0e-12; ++k)
+        {
+            const auto half = x / (2.0 * k);
+            term *= half * half;
+            sum += term;
+        }
+
+        return sum;
+    }
+}
+
+//==============================================================================
+SampleInterpolator::SampleInterpolator()
+{
+    constexpr auto beta = 7.0;
+    constexpr auto halfLength = numTaps / 2;
+    const auto windowScale = 1.0 / besselI0 (beta);
+
+    for (size_t t = 0; t < tables.size(); ++t)
+    {
+        // A little under Nyquist at the read rate, to leave room for the
+        // transition band.
+        const auto cutoff = 0.95 / tableSteps[t];
+        auto& table = tables[t];
+        table.malloc ((size_t) ((numPhases + 1) * numTaps));
+
+        for (int row = 0; row <= numPhases; ++row)
+        {
+            auto* h = table + row * numTaps;
+            const auto fraction = (double) row / numPhases;
+            auto sum = 0.0;
+
+            for (int tap = 0; tap < numTaps; ++tap)
+            {
+                // Tap `tap` multiplies the sample this far from the read position.
+                const auto distance = tap - halfLength + 1 - fraction;
+                const auto x = juce::MathConstants<double>::pi * cutoff * distance;
+                const auto sinc = std::abs (x) < 1.0e-9 ? 1.0 : std::sin (x) / x;
+                const auto r = distance / halfLength;
+                const auto window = std::abs (r) < 1.0 ? besselI0 (beta * std::sqrt (1.0 - r * r)) * windowScale : 0.0;
+
+                h[tap] = (float) (sinc * window);
+                sum += h[tap];
+            }
+
+            // Unity gain at DC for every phase.
+            for (int tap = 0; tap < numTaps; ++tap)
+                h[tap] = (float) (h[tap] / sum);
+        }
+    }
+}
+
+const float* SampleInterpolator::getTable (double step) const noexcept
+{
+    for (size_t t = 0; t < tables.size(); ++t)
+        if (step <= tableSteps[t] + 1.0e-9)
+            return tables[t];
+
+    return tables.back();
+}
+
+void SampleInterpolator::process (Quality quality, float* dest, const float* src, int num, double start, double step) const noexcept
+{
+    if (quality == Quality::linear)
+        ReversatronKernels::interpolateLinear (dest, src, num, start, step);
+    else
+        ReversatronKernels::interpolatePolyphase (dest, src, num, start, step, getTable (step), numTaps, numPhases);
+}
+
+void SampleInterpolator::process (Quality quality, double* dest, const double* src, int num, double start, double step) const noexcept
+{
+    if (quality == Quality::linear)
+        ReversatronKernels::interpolateLinear (dest, src, num, start, step);
+    else
+        ReversatronKernels::interpolatePolyphase (dest, src, num, start, step, getTable (step), numTaps, numPhases);
+}
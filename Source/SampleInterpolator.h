@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    Reads audio at fractional positions, for variable-speed playback and
+    sample rate conversion.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Interpolating reader with two quality tiers: linear, and a 16-tap
+    Kaiser-windowed sinc.
+
+    The sinc tier uses a polyphase table per anti-aliasing cutoff, so reading
+    faster than one sample per output lowers the cutoff to match instead of
+    aliasing. The tables are built once, in the constructor, and the tap
+    count is fixed, so the cost per output sample is the same at any speed.
+    One instance can be shared between threads (see SharedResourcePointer).
+*/
+class SampleInterpolator
+{
+public:
+    enum class Quality
+    {
+        linear = 0,
+        windowedSinc
+    };
+
+    static constexpr int numTaps = 16;
+    static constexpr int numPhases = 256;
+
+    /** How far either side of floor (t) the source must be readable. */
+    static constexpr int numSamplesBefore = numTaps / 2 - 1;
+    static constexpr int numSamplesAfter = numTaps / 2;
+
+    SampleInterpolator();
+
+    /** dest[i] = src read at t = start + i * step. src must be readable from
+        src[floor (start) - numSamplesBefore] to src[floor (t) + numSamplesAfter]
+        for the last t.
+    */
+    void process (Quality quality, float* dest, const float* src, int num, double start, double step) const noexcept;
+    void process (Quality quality, double* dest, const double* src, int num, double start, double step) const noexcept;
+
+private:
+    // Each table's cutoff is set for reading at up to this many source
+    // samples per output; faster reads use the last one.
+    static constexpr std::array<double, 5> tableSteps { { 1.0, 1.5, 2.0, 3.0, 4.0 } };
+
+    const float* getTable (double step) const noexcept;
+
+    std::array<juce::HeapBlock<float>, tableSteps.size()> tables;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SampleInterpolator)
+};
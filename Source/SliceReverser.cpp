@@ -0,0 +1,240 @@
+/*
+  ==============================================================================
+
+    Slice-reverse mode: a reverse delay over short, tempo-synced slices.
+
+  ==============================================================================
+*/
+
+#include "SliceReverser.h"
+#include "ReversatronKernels.h"
+
+//==============================================================================
+void SliceReverser::reset() noexcept
+{
+    time = 0;
+    lastBoundary = 0;
+    nextBoundary = sliceLength;
+
+    current = {};
+    current.delay = sliceLength;
+    previous = current;
+    fadeStart = 0;
+    currentFadeLength = 0;
+}
+
+void SliceReverser::setTiming (int newSliceLength, int newFadeLength) noexcept
+{
+    jassert (newSliceLength > 0);
+    fadeLength = juce::jlimit (0, newSliceLength, newFadeLength);
+
+    if (newSliceLength == sliceLength)
+        return;
+
+    const auto isFirst = sliceLength == 0;
+    sliceLength = newSliceLength;
+
+    if (isFirst)
+    {
+        reset();
+        return;
+    }
+
+    if (! current.isReversed)
+    {
+        Voice delayed;
+        delayed.delay = sliceLength;
+        switchTo (delayed);
+    }
+
+    nextBoundary = juce::jmax (time, lastBoundary + sliceLength);
+    startSliceIfDue();
+}
+
+void SliceReverser::syncNextSlice (int numFramesToBoundary) noexcept
+{
+    auto boundary = time + numFramesToBoundary;
+
+    // Rounding can put the same grid point either side of a block edge, so
+    // one that has only just been handled is skipped.
+    if (boundary - lastBoundary < sliceLength / 2)
+        boundary += sliceLength;
+
+    nextBoundary = boundary;
+    startSliceIfDue();
+}
+
+void SliceReverser::setActive (bool shouldBeActive) noexcept
+{
+    if (active == shouldBeActive)
+        return;
+
+    active = shouldBeActive;
+
+    if (! active && current.isReversed)
+    {
+        Voice delayed;
+        delayed.delay = sliceLength;
+        switchTo (delayed);
+    }
+}
+
+//==============================================================================
+int SliceReverser::getNumToProcess (int numSamples, int ringLength) const noexcept
+{
+    auto num = static_cast<juce::int64> (numSamples);
+    num = juce::jmin (num, nextBoundary - time);
+    num = juce::jmin (num, static_cast<juce::int64> (ringLength - getRingFrame (ringLength)));
+
+    if (isFading())
+        num = juce::jmin (num, fadeStart + currentFadeLength - time);
+
+    return static_cast<int> (juce::jmax (static_cast<juce::int64> (1), num));
+}
+
+int SliceReverser::getRingFrame (int ringLength) const noexcept
+{
+    return static_cast<int> (time % ringLength);
+}
+
+void SliceReverser::advance (int numSamples) noexcept
+{
+    time += numSamples;
+    startSliceIfDue();
+}
+
+void SliceReverser::switchTo (Voice next) noexcept
+{
+    previous = current;
+    current = next;
+    fadeStart = time;
+    currentFadeLength = fadeLength;
+}
+
+void SliceReverser::startSliceIfDue() noexcept
+{
+    while (time >= nextBoundary && sliceLength > 0)
+    {
+        lastBoundary = nextBoundary;
+        nextBoundary += sliceLength;
+
+        // The first slice waits until a whole one has been recorded.
+        if (active && time >= sliceLength)
+        {
+            Voice slice;
+            slice.isReversed = true;
+            slice.start = time;
+            switchTo (slice);
+        }
+    }
+}
+
+//==============================================================================
+template <typename SampleType>
+void SliceReverser::renderChannel (CaptureBuffer& ring, int channel, SampleType* dest, int numSamples,
+                                   SampleType* scratch, int scratchSize) const noexcept
+{
+    if (! isFading())
+    {
+        renderVoice (current, ring, channel, dest, numSamples, false, 1.0f, 0.0f, scratch, scratchSize);
+        return;
+    }
+
+    // The outgoing voice is laid down first and the incoming one crossfaded
+    // over it, so their gains always sum to one.
+    const auto gainStep = 1.0f / static_cast<float> (currentFadeLength);
+    const auto gain = static_cast<float> (time - fadeStart) * gainStep;
+
+    renderVoice (previous, ring, channel, dest, numSamples, false, 1.0f, 0.0f, scratch, scratchSize);
+    renderVoice (current, ring, channel, dest, numSamples, true, gain, gainStep, scratch, scratchSize);
+}
+
+template <typename SampleType>
+void SliceReverser::renderVoice (const Voice& voice, CaptureBuffer& ring, int channel, SampleType* dest, int numSamples,
+                                 bool isFade, float gain, float gainStep, SampleType* scratch, int scratchSize) const noexcept
+{
+    const auto ringLength = ring.getNumSamples();
+    const auto firstFrame = voice.getFrame (time);
+
+    // Split into runs wherever the frames read wrap round the ring or go
+    // back past the first frame recorded.
+    for (int done = 0; done < numSamples;)
+    {
+        const auto frame = voice.isReversed ? firstFrame - done : firstFrame + done;
+        const auto runGain = gain + static_cast<float> (done) * gainStep;
+        auto* runDest = dest + done;
+
+        if (frame < 0)
+        {
+            // Nothing was recorded this far back, so it's silence.
+            auto num = voice.isReversed ? numSamples - done
+                                        : static_cast<int> (juce::jmin (static_cast<juce::int64> (numSamples - done), -frame));
+
+            if (isFade)
+            {
+                num = juce::jmin (num, scratchSize);
+                juce::FloatVectorOperations::clear (scratch, num);
+                ReversatronKernels::crossfade (runDest, scratch, num, runGain, gainStep);
+            }
+            else
+            {
+                juce::FloatVectorOperations::clear (runDest, num);
+            }
+
+            done += num;
+            continue;
+        }
+
+        // The run covers ring frames [runStart, runStart + num), in recorded order.
+        const auto ringFrame = static_cast<int> (frame % ringLength);
+        auto num = voice.isReversed ? juce::jmin (numSamples - done, ringFrame + 1)
+                                    : juce::jmin (numSamples - done, ringLength - ringFrame);
+        auto runStart = voice.isReversed ? ringFrame - num + 1 : ringFrame;
+
+        if (auto* src = ring.getReadPointerAs<SampleType> (channel, runStart, num))
+        {
+            if (voice.isReversed)
+            {
+                if (isFade)
+                    ReversatronKernels::reverseCrossfade (runDest, src, num, runGain, gainStep);
+                else
+                    ReversatronKernels::reverseCopy (runDest, src, num);
+            }
+            else
+            {
+                if (isFade)
+                    ReversatronKernels::crossfade (runDest, src, num, runGain, gainStep);
+                else
+                    juce::FloatVectorOperations::copy (runDest, src, num);
+            }
+        }
+        else
+        {
+            // Not contiguous in memory, so read it (reversed) into the
+            // scratch buffer, a scratch-sized chunk at a time.
+            num = juce::jmin (num, scratchSize);
+            runStart = voice.isReversed ? ringFrame - num + 1 : ringFrame;
+            ring.readReversed (channel, ringLength - runStart - num, scratch, num);
+
+            if (voice.isReversed)
+            {
+                if (isFade)
+                    ReversatronKernels::crossfade (runDest, scratch, num, runGain, gainStep);
+                else
+                    juce::FloatVectorOperations::copy (runDest, scratch, num);
+            }
+            else
+            {
+                if (isFade)
+                    ReversatronKernels::reverseCrossfade (runDest, scratch, num, runGain, gainStep);
+                else
+                    ReversatronKernels::reverseCopy (runDest, scratch, num);
+            }
+        }
+
+        done += num;
+    }
+}
+
+template void SliceReverser::renderChannel (CaptureBuffer&, int, float*, int, float*, int) const noexcept;
+template void SliceReverser::renderChannel (CaptureBuffer&, int, double*, int, double*, int) const noexcept;
@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+    Slice-reverse mode: a reverse delay over short, tempo-synced slices.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CaptureBuffer.h"
+
+//==============================================================================
+/**
+    Plays each slice of the input backwards as soon as it has been recorded.
+
+    The capture buffer is used as a ring holding the recent input, indexed by
+    the number of frames since reset(). A slice that ends at frame s plays
+    from s onwards, with output frame t reading input frame (2s - 1 - t). Once
+    the host compensates for a latency of one slice, each reversed slice
+    therefore lands exactly on top of the audio it was recorded from. Each
+    slice carries on past the start of the next one for the crossfade length
+    (reading further back into the input), and the two are crossfaded.
+
+    While inactive, and until the first slice is complete, the input comes
+    out delayed by the same latency, so the plugin's timing doesn't depend on
+    the transport. The ring must hold four slices plus a block: a slice plays
+    for at most two slice lengths, reading twice as far back.
+
+    Everything is called from the audio thread, except that renderChannel()
+    may be called for different channels concurrently.
+*/
+class SliceReverser
+{
+public:
+    /** Forgets the ring's contents and any slice in progress. */
+    void reset() noexcept;
+
+    /** Sets the slice length and crossfade, in frames, for slices from now
+        on. The latency is always one slice; if it changes while the delayed
+        input is playing, the old and new delays are crossfaded.
+    */
+    void setTiming (int sliceLength, int fadeLength) noexcept;
+
+    /** Lines the next slice boundary up with the host's beat grid, this many
+        frames from now.
+    */
+    void syncNextSlice (int numFramesToBoundary) noexcept;
+
+    /** Whether slices are reversed or the delayed input is passed through.
+        Switching on takes effect at the next boundary; switching off
+        crossfades back to the input straight away.
+    */
+    void setActive (bool shouldBeActive) noexcept;
+
+    /** How many of the next numSamples frames can be processed in one go,
+        before a slice starts, a crossfade ends or the ring wraps.
+    */
+    int getNumToProcess (int numSamples, int ringLength) const noexcept;
+
+    /** The ring frame that the next frame of input goes to. */
+    int getRingFrame (int ringLength) const noexcept;
+
+    /** Replaces numSamples frames of one channel's input with the output.
+        The input must already have been written to the ring. It's available
+        for float and double samples.
+    */
+    template <typename SampleType>
+    void renderChannel (CaptureBuffer& ring, int channel, SampleType* dest, int numSamples,
+                        SampleType* scratch, int scratchSize) const noexcept;
+
+    /** Moves on by numSamples frames, starting the next slice if it's due. */
+    void advance (int numSamples) noexcept;
+
+    int getSliceLength() const noexcept     { return sliceLength; }
+
+private:
+    /** Either a reversed slice, or the input delayed by one slice. */
+    struct Voice
+    {
+        bool isReversed = false;
+        juce::int64 start = 0;      // reversed: where the slice ended and its playback begins
+        int delay = 0;              // otherwise: frames behind the input
+
+        juce::int64 getFrame (juce::int64 outputFrame) const noexcept
+        {
+            return isReversed ? 2 * start - 1 - outputFrame : outputFrame - delay;
+        }
+    };
+
+    void switchTo (Voice next) noexcept;
+    void startSliceIfDue() noexcept;
+    bool isFading() const noexcept      { return time < fadeStart + currentFadeLength; }
+
+    template <typename SampleType>
+    void renderVoice (const Voice& voice, CaptureBuffer& ring, int channel, SampleType* dest, int numSamples,
+                      bool isFade, float gain, float gainStep, SampleType* scratch, int scratchSize) const noexcept;
+
+    juce::int64 time = 0, lastBoundary = 0, nextBoundary = 0;
+    int sliceLength = 0, fadeLength = 0;
+    bool active = false;
+
+    Voice current, previous;
+    juce::int64 fadeStart = 0;
+    int currentFadeLength = 0;
+};
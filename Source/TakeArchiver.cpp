@@ -0,0 +1,528 @@
+/*
+  ==============================================================================
+
+    Reads the running take out of the installed buffer, so that it can be
+    saved with the session or exported without holding up the audio thread.
+
+  ==============================================================================
+*/
+
+#include "TakeArchiver.h"
+#include "CaptureBufferAllocator.h"
+#include "CompactCaptureBuffer.h"
+#include "ReversatronKernels.h"
+
+//==============================================================================
+namespace
+{
+    // A take read back from a session, as floats or (for a 64-bit take)
+    // doubles, held until the allocator has copied it into the next buffer.
+    // Only the frames recorded are kept, however long the buffer they came
+    // from.
+    template <typename SampleType>
+    class RestoredTake  : public CaptureBuffer
+    {
+    public:
+        RestoredTake (int numChannelsToUse, int numFrames)
+            : CaptureBuffer (numChannelsToUse, numFrames)
+        {
+            samples.malloc ((size_t) numChannelsToUse * (size_t) numFrames);
+        }
+
+        /** False if the samples couldn't be allocated. */
+        bool isValid() const noexcept     { return samples != nullptr; }
+
+        int getBitsPerSample() const noexcept override    { return 8 * (int) sizeof (SampleType); }
+
+        using CaptureBuffer::writeChannel;
+        using CaptureBuffer::readReversed;
+
+        void writeChannel (int channel, const float* source, int startFrame, int numToWrite) noexcept override
+        {
+            std::copy (source, source + numToWrite, getWritePointer (channel) + startFrame);
+        }
+
+        const float* getReadPointer (int channel, int startFrame, int num) const noexcept override
+        {
+            if constexpr (std::is_same_v<SampleType, float>)
+                return getSamples (channel, startFrame);
+            else
+                return CaptureBuffer::getReadPointer (channel, startFrame, num);
+        }
+
+        const double* getDoubleReadPointer (int channel, int startFrame, int num) const noexcept override
+        {
+            if constexpr (std::is_same_v<SampleType, double>)
+                return getSamples (channel, startFrame);
+            else
+                return CaptureBuffer::getDoubleReadPointer (channel, startFrame, num);
+        }
+
+        void readReversed (int channel, int position, float* dest, int num) noexcept override
+        {
+            const auto* src = getSamples (channel, numSamples - position - num);
+
+            if constexpr (std::is_same_v<SampleType, float>)
+            {
+                ReversatronKernels::reverseCopy (dest, src, num);
+            }
+            else
+            {
+                for (int i = 0; i < num; ++i)
+                    dest[i] = static_cast<float> (src[num - 1 - i]);
+            }
+        }
+
+        void readReversed (int channel, int position, double* dest, int num) noexcept override
+        {
+            if constexpr (std::is_same_v<SampleType, double>)
+                ReversatronKernels::reverseCopy (dest, getSamples (channel, numSamples - position - num), num);
+            else
+                CaptureBuffer::readReversed (channel, position, dest, num);
+        }
+
+        SampleType* getWritePointer (int channel) noexcept
+        {
+            return samples + (size_t) channel * (size_t) numSamples;
+        }
+
+    private:
+        const SampleType* getSamples (int channel, int startFrame) const noexcept
+        {
+            return samples + (size_t) channel * (size_t) numSamples + (size_t) startFrame;
+        }
+
+        // Allocated unchecked, rather than as an AudioBuffer, so that a take
+        // too big for the memory available fails cleanly.
+        juce::HeapBlock<SampleType> samples;
+    };
+
+    int getTimeLeft (juce::uint32 deadline) noexcept
+    {
+        return (int) (deadline - juce::Time::getMillisecondCounter());
+    }
+}
+
+//==============================================================================
+struct TakeArchiver::Request
+{
+    TakeInfo take;                  // the take to read, or the answer to getTakeInfo()
+    int startFrame = 0;
+    juce::AudioBuffer<float> samples;
+    juce::AudioBuffer<double> doubleSamples;    // instead of samples, for a read at full precision
+    bool succeeded = false;
+
+    template <typename SampleType>
+    juce::AudioBuffer<SampleType>& getSamples() noexcept
+    {
+        if constexpr (std::is_same_v<SampleType, double>)
+            return doubleSamples;
+        else
+            return samples;
+    }
+    juce::WaitableEvent done;
+};
+
+TakeArchiver::TakeArchiver (juce::Thread& workerToUse)
+    : worker (workerToUse)
+{
+}
+
+void TakeArchiver::publishProgress (const Progress& progress) noexcept
+{
+    // Stamped with the replacements so far, so that progress published
+    // before the latest one is recognised as out of date.
+    const auto words = std::array<uint64_t, 2>
+    {
+        static_cast<uint64_t> (progress.generation) | (static_cast<uint64_t> (numReplacements.load (std::memory_order_relaxed)) << 32),
+        static_cast<uint64_t> (progress.firstFrame & 0x7fffffff)
+            | (static_cast<uint64_t> (progress.numFramesRecorded & 0x7fffffff) << 31)
+            | (static_cast<uint64_t> (progress.isFinished ? 1 : 0) << 62)
+            | (static_cast<uint64_t> (progress.isSessionTake ? 1 : 0) << 63)
+    };
+
+    const auto sequence = progressSequence.load (std::memory_order_relaxed);
+    progressSequence.store (sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence (std::memory_order_release);
+
+    progressWords[0].store (words[0], std::memory_order_relaxed);
+    progressWords[1].store (words[1], std::memory_order_relaxed);
+    progressSequence.store (sequence + 2, std::memory_order_release);
+}
+
+void TakeArchiver::noteTakeReplaced() noexcept
+{
+    numReplacements.fetch_add (1, std::memory_order_acq_rel);
+}
+
+TakeArchiver::Progress TakeArchiver::readProgress (uint32_t& numReplacementsSeen) const noexcept
+{
+    uint64_t words[2];
+
+    for (;;)
+    {
+        const auto sequence = progressSequence.load (std::memory_order_acquire);
+        words[0] = progressWords[0].load (std::memory_order_relaxed);
+        words[1] = progressWords[1].load (std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_acquire);
+
+        if ((sequence & 1) == 0 && progressSequence.load (std::memory_order_relaxed) == sequence)
+            break;
+
+        juce::Thread::yield();
+    }
+
+    Progress progress;
+    progress.generation = static_cast<uint32_t> (words[0]);
+    progress.firstFrame = static_cast<int> (words[1] & 0x7fffffff);
+    progress.numFramesRecorded = static_cast<int> ((words[1] >> 31) & 0x7fffffff);
+    progress.isFinished = ((words[1] >> 62) & 1) != 0;
+    progress.isSessionTake = (words[1] >> 63) != 0;
+    numReplacementsSeen = static_cast<uint32_t> (words[0] >> 32);
+    return progress;
+}
+
+//==============================================================================
+void TakeArchiver::serviceRequests (CaptureBuffer* installedBuffer)
+{
+    std::vector<std::shared_ptr<Request>> requests;
+
+    {
+        const juce::ScopedLock sl (requestLock);
+        std::swap (requests, pendingRequests);
+    }
+
+    for (auto& request : requests)
+    {
+        request->succeeded = serve (*request, installedBuffer);
+        request->done.signal();
+    }
+}
+
+TakeArchiver::TakeInfo TakeArchiver::getInstalledTake (CaptureBuffer* installedBuffer) const noexcept
+{
+    uint32_t numReplacementsSeen = 0;
+    const auto progress = readProgress (numReplacementsSeen);
+    TakeInfo info;
+
+    // Progress published for a buffer that has since been replaced, or
+    // before the take was, is ignored until the audio thread reports in.
+    if (installedBuffer == nullptr || installedBuffer->generation != progress.generation
+        || numReplacements.load (std::memory_order_acquire) != numReplacementsSeen)
+        return info;
+
+    info.numChannels = installedBuffer->getNumChannels();
+    info.takeLength = installedBuffer->getNumSamples();
+    info.firstFrame = progress.firstFrame;
+    info.numFramesRecorded = juce::jlimit (0, info.takeLength - info.firstFrame, progress.numFramesRecorded);
+    info.bitsPerSample = installedBuffer->getBitsPerSample();
+    info.isFinished = progress.isFinished;
+    info.isSessionTake = progress.isSessionTake;
+    info.generation = progress.generation;
+    info.numReplacements = numReplacementsSeen;
+
+    // Until the take has finished, only whole codec blocks are read, as a
+    // compact buffer doesn't encode its last partial block until then.
+    if (! info.isFinished)
+        info.numFramesRecorded -= info.numFramesRecorded % CompactCaptureBuffer::losslessBlockSize;
+
+    return info;
+}
+
+bool TakeArchiver::serve (Request& request, CaptureBuffer* installedBuffer) const
+{
+    const auto installed = getInstalledTake (installedBuffer);
+
+    const auto isDouble = request.doubleSamples.getNumSamples() > 0;
+    const auto num = isDouble ? request.doubleSamples.getNumSamples() : request.samples.getNumSamples();
+
+    if (num == 0)
+    {
+        request.take = installed;
+        return installed.numFramesRecorded > 0;
+    }
+
+    // Frames already recorded don't change until the take is replaced, so
+    // a take that has moved on since it was described can still be read.
+    const auto& take = request.take;
+
+    if (installed.numFramesRecorded == 0 || ! isStillInstalled (take) || installed.generation != take.generation
+        || request.startFrame + num > take.numFramesRecorded)
+        return false;
+
+    for (int channel = 0; channel < take.numChannels; ++channel)
+    {
+        if (isDouble)
+            installedBuffer->readTake (channel, take.firstFrame + request.startFrame, request.doubleSamples.getWritePointer (channel), num);
+        else
+            installedBuffer->readTake (channel, take.firstFrame + request.startFrame, request.samples.getWritePointer (channel), num);
+    }
+
+    // The audio thread may have started overwriting the take while it was
+    // being read.
+    return isStillInstalled (take);
+}
+
+bool TakeArchiver::isStillInstalled (const TakeInfo& take) const noexcept
+{
+    return numReplacements.load (std::memory_order_acquire) == take.numReplacements;
+}
+
+bool TakeArchiver::perform (const std::shared_ptr<Request>& request, int timeoutMs)
+{
+    if (timeoutMs <= 0)
+        return false;
+
+    {
+        const juce::ScopedLock sl (requestLock);
+        pendingRequests.push_back (request);
+    }
+
+    worker.notify();
+
+    // A request given up on is still served, into its own buffer, which the
+    // shared pointer keeps alive.
+    return request->done.wait (timeoutMs);
+}
+
+TakeArchiver::TakeInfo TakeArchiver::getTakeInfo (int timeoutMs)
+{
+    auto request = std::make_shared<Request>();
+
+    if (! perform (request, timeoutMs) || ! request->succeeded)
+        return {};
+
+    return request->take;
+}
+
+bool TakeArchiver::readTake (const TakeInfo& take, int startFrame, juce::AudioBuffer<float>& dest, int timeoutMs)
+{
+    return readFrames (take, startFrame, dest, timeoutMs);
+}
+
+bool TakeArchiver::readTake (const TakeInfo& take, int startFrame, juce::AudioBuffer<double>& dest, int timeoutMs)
+{
+    return readFrames (take, startFrame, dest, timeoutMs);
+}
+
+template <typename SampleType>
+bool TakeArchiver::readFrames (const TakeInfo& take, int startFrame, juce::AudioBuffer<SampleType>& dest, int timeoutMs)
+{
+    const auto num = dest.getNumSamples();
+    jassert (dest.getNumChannels() >= take.numChannels && startFrame + num <= take.numFramesRecorded);
+
+    if (num == 0)
+        return true;
+
+    auto request = std::make_shared<Request>();
+    request->take = take;
+    request->startFrame = startFrame;
+    auto& samples = request->template getSamples<SampleType>();
+    samples.setSize (take.numChannels, num);
+
+    if (! perform (request, timeoutMs) || ! request->succeeded)
+        return false;
+
+    for (int channel = 0; channel < take.numChannels; ++channel)
+        dest.copyFrom (channel, 0, samples, channel, 0, num);
+
+    return true;
+}
+
+//==============================================================================
+/*  The saved take is:
+
+        int     numChannels
+        int     takeLength              the buffer length it was recorded into
+        int     numFramesRecorded
+        bool    isFinished
+        int     bitsPerSample
+
+    followed, for floating point takes, by the frames as raw little-endian
+    floats (doubles if bitsPerSample is 64) in runs of chunkSize per channel,
+    one channel after another within each chunk; for fixed-point ones, by
+    the frames in the lossless format (see
+    CompactCaptureBuffer::writeEncodedTake()).
+*/
+TakeArchiver::TakeInfo TakeArchiver::write (juce::OutputStream& stream, int timeoutMs, bool& failed)
+{
+    // One deadline for the whole take, so that a long one can't hold up the
+    // host for a timeout per chunk.
+    const auto deadline = juce::Time::getMillisecondCounter() + (juce::uint32) juce::jmax (0, timeoutMs);
+
+    failed = true;
+    auto request = std::make_shared<Request>();
+
+    if (! perform (request, getTimeLeft (deadline)))
+        return {};
+
+    const auto take = request->take;
+    const auto numFrames = take.numFramesRecorded;
+
+    if (! request->succeeded || numFrames == 0 || ! take.isSessionTake)
+    {
+        failed = false;
+        return {};
+    }
+
+    const auto bitsToStore = take.bitsPerSample == 64 ? 64 : take.bitsPerSample >= 32 ? 32 : 24;
+    std::unique_ptr<CompactCaptureBuffer> encoder;
+
+    if (bitsToStore == 24)
+    {
+        encoder = std::make_unique<CompactCaptureBuffer> (take.numChannels, numFrames, CaptureFormat::lossless24);
+
+        if (! encoder->isValid())
+            return {};
+    }
+
+    stream.writeInt (take.numChannels);
+    stream.writeInt (take.takeLength);
+    stream.writeInt (numFrames);
+    stream.writeBool (take.isFinished);
+    stream.writeInt (bitsToStore);
+
+    if (! (bitsToStore == 64 ? writeFrames<double> (stream, take, nullptr, deadline)
+                             : writeFrames<float> (stream, take, encoder.get(), deadline)))
+        return {};
+
+    if (encoder != nullptr)
+        encoder->writeEncodedTake (stream, numFrames);
+
+    failed = false;
+    return take;
+}
+
+template <typename SampleType>
+bool TakeArchiver::writeFrames (juce::OutputStream& stream, const TakeInfo& take, CompactCaptureBuffer* encoder, juce::uint32 deadline)
+{
+    const auto numFrames = take.numFramesRecorded;
+    juce::AudioBuffer<SampleType> chunk (take.numChannels, chunkSize);
+
+    for (int start = 0; start < numFrames; start += chunkSize)
+    {
+        const auto num = juce::jmin (chunkSize, numFrames - start);
+        chunk.setSize (take.numChannels, num, false, false, true);
+
+        if (! readTake (take, start, chunk, getTimeLeft (deadline)))
+            return false;
+
+        if constexpr (std::is_same_v<SampleType, float>)
+        {
+            if (encoder != nullptr)
+            {
+                // The encoder is exactly the take's length, so it encodes the
+                // last, partial block as soon as that's written.
+                encoder->write (chunk, start, num);
+                continue;
+            }
+        }
+
+        for (int channel = 0; channel < take.numChannels; ++channel)
+        {
+           #if JUCE_BIG_ENDIAN
+            for (int i = 0; i < num; ++i)
+            {
+                if constexpr (std::is_same_v<SampleType, double>)
+                    stream.writeDouble (chunk.getSample (channel, i));
+                else
+                    stream.writeFloat (chunk.getSample (channel, i));
+            }
+           #else
+            stream.write (chunk.getReadPointer (channel), sizeof (SampleType) * (size_t) num);
+           #endif
+        }
+    }
+
+    return true;
+}
+
+std::unique_ptr<CaptureCarryOver> TakeArchiver::read (juce::InputStream& stream, int maxNumChannels, int maxTakeLength)
+{
+    const auto numChannels = stream.readInt();
+    const auto takeLength = stream.readInt();
+    const auto numFrames = stream.readInt();
+    const auto isFinished = stream.readBool();
+    const auto bitsPerSample = stream.readInt();
+
+    if (numChannels <= 0 || numChannels > maxNumChannels || takeLength <= 0 || takeLength > maxTakeLength
+        || numFrames <= 0 || numFrames > takeLength || (bitsPerSample != 64 && bitsPerSample != 32 && bitsPerSample != 24))
+        return {};
+
+    // Nothing is allocated for a take the data can't hold: four or eight
+    // bytes a sample raw, or at least a length and five bytes a block encoded.
+    const auto numBlocks = ((size_t) numFrames + CompactCaptureBuffer::losslessBlockSize - 1) / CompactCaptureBuffer::losslessBlockSize;
+    const auto minNumBytes = (size_t) numChannels * (bitsPerSample == 24 ? 4 + 5 * numBlocks
+                                                                          : (size_t) bitsPerSample / 8 * (size_t) numFrames);
+    const auto numBytesLeft = stream.getNumBytesRemaining();
+
+    if (numBytesLeft >= 0 && (juce::uint64) numBytesLeft < (juce::uint64) minNumBytes)
+        return {};
+
+    std::unique_ptr<CaptureBuffer> take;
+
+    if (bitsPerSample == 64)
+    {
+        take = readSavedFrames<double> (stream, numChannels, numFrames);
+    }
+    else if (bitsPerSample == 32)
+    {
+        take = readSavedFrames<float> (stream, numChannels, numFrames);
+    }
+    else
+    {
+        auto decoder = std::make_unique<CompactCaptureBuffer> (numChannels, numFrames, CaptureFormat::lossless24);
+
+        if (decoder->isValid() && decoder->readEncodedTake (stream, numFrames))
+            take = std::move (decoder);
+    }
+
+    if (take == nullptr)
+        return {};
+
+    auto carryOver = std::make_unique<CaptureCarryOver>();
+    carryOver->source = std::move (take);
+    carryOver->takeLength = takeLength;
+    carryOver->numFramesRecorded = numFrames;
+    carryOver->isPlaying = isFinished;
+    return carryOver;
+}
+
+template <typename SampleType>
+std::unique_ptr<CaptureBuffer> TakeArchiver::readSavedFrames (juce::InputStream& stream, int numChannels, int numFrames)
+{
+    auto restored = std::make_unique<RestoredTake<SampleType>> (numChannels, numFrames);
+
+    if (! restored->isValid())
+        return {};
+
+    for (int start = 0; start < numFrames; start += chunkSize)
+    {
+        const auto num = juce::jmin (chunkSize, numFrames - start);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto* dest = restored->getWritePointer (channel) + start;
+
+           #if JUCE_BIG_ENDIAN
+            for (int i = 0; i < num; ++i)
+            {
+                if constexpr (std::is_same_v<SampleType, double>)
+                    dest[i] = stream.readDouble();
+                else
+                    dest[i] = stream.readFloat();
+            }
+
+            if (stream.isExhausted() && start + num < numFrames)
+                return {};
+           #else
+            const auto numBytes = (int) sizeof (SampleType) * num;
+
+            if (stream.read (dest, numBytes) != numBytes)
+                return {};
+           #endif
+        }
+    }
+
+    return restored;
+}
@@ -0,0 +1,152 @@
+/*
+  ==============================================================================
+
+    Reads the running take out of the installed buffer, so that it can be
+    saved with the session or exported without holding up the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CaptureBuffer.h"
+
+struct CaptureCarryOver;
+class CompactCaptureBuffer;
+
+//==============================================================================
+/**
+    Lets other threads read the take in the installed capture buffer while
+    the audio thread carries on recording into it or playing it back.
+
+    The audio thread publishes where the take is and how far it has got at
+    the end of each block, and says whenever it's about to overwrite or swap
+    out a take it has published, so that a read caught part way through is
+    thrown away rather than mixing two takes. Reads are queued for the
+    allocator's worker, the only thread that ever frees buffers or recycles
+    their segments, which serves them from the installed buffer in between
+    its other jobs (see serviceRequests()). No copy is kept ahead of time, so
+    a take costs nothing beyond its capture buffer until it is actually saved
+    or exported, and it's read at the precision it was recorded at.
+
+    A session's take is restored the same way a take is carried over to a new
+    sample rate: read() turns the saved data back into a CaptureCarryOver,
+    which the allocator resamples, if need be, into the next buffer it builds.
+*/
+class TakeArchiver
+{
+public:
+    /** The thread that calls serviceRequests(), which is woken whenever a
+        read is queued.
+    */
+    explicit TakeArchiver (juce::Thread& worker);
+
+    /** What the installed buffer holds, as the audio thread sees it. */
+    struct Progress
+    {
+        uint32_t generation = 0;        // the buffer's
+        int firstFrame = 0;             // where the take starts in the buffer
+        int numFramesRecorded = 0;      // 0 if there's nothing worth reading
+        bool isFinished = false;        // recording had ended and playback begun
+        bool isSessionTake = false;     // a record then reverse take, which sessions keep
+    };
+
+    /** Audio thread: publishes the take at the end of a block. */
+    void publishProgress (const Progress&) noexcept;
+
+    /** Audio thread: call before anything that overwrites the frames of the
+        take last published, or changes which frames a read gets.
+    */
+    void noteTakeReplaced() noexcept;
+
+    /** Worker thread: answers the reads queued since the last call. */
+    void serviceRequests (CaptureBuffer* installedBuffer);
+
+    //==============================================================================
+    /** The take in the installed buffer. */
+    struct TakeInfo
+    {
+        int numChannels = 0;
+        int takeLength = 0;             // the buffer length, in frames
+        int firstFrame = 0;
+        int numFramesRecorded = 0;
+        int bitsPerSample = 32;         // as CaptureBuffer::getBitsPerSample()
+        bool isFinished = false;
+        bool isSessionTake = false;
+
+        // The buffer, and the number of replacements before the take was
+        // described, which together say which take this is.
+        uint32_t generation = 0, numReplacements = 0;
+    };
+
+    /** Any thread but the audio thread or the worker: describes the take
+        as it is now. numFramesRecorded is 0 if there's nothing worth reading,
+        or if the worker didn't get round to answering within timeoutMs.
+    */
+    TakeInfo getTakeInfo (int timeoutMs);
+
+    /** Any thread but the audio thread or the worker: copies frames
+        [startFrame, startFrame + dest.getNumSamples()) of every channel of
+        the take, which must lie within the frames it described. Returns false
+        if that take has since been replaced or restarted, or if the worker
+        didn't answer within timeoutMs.
+    */
+    bool readTake (const TakeInfo& take, int startFrame, juce::AudioBuffer<float>& dest, int timeoutMs);
+
+    /** As readTake(), at full precision for a 64-bit take. */
+    bool readTake (const TakeInfo& take, int startFrame, juce::AudioBuffer<double>& dest, int timeoutMs);
+
+    /** Any thread but the audio thread or the worker: writes the take as it
+        is now, if it's one that sessions keep, and returns what was written
+        (a numFramesRecorded of 0 if nothing, in which case the stream may
+        hold part of it). timeoutMs is for the whole take, however many reads
+        that takes. failed is set if there was a take to write, or it couldn't
+        be told whether there was, but it wasn't all written: the worker
+        didn't finish in time, the take was replaced part way through, or
+        there wasn't the memory to encode it.
+    */
+    TakeInfo write (juce::OutputStream& stream, int timeoutMs, bool& failed);
+
+    /** Reads a take written by write(), or returns nullptr if the data is
+        damaged, describes a take with more channels or frames than the
+        limits given, or there isn't the memory to hold it.
+    */
+    static std::unique_ptr<CaptureCarryOver> read (juce::InputStream& stream, int maxNumChannels, int maxTakeLength);
+
+private:
+    struct Request;
+
+    /** Frames per read, and per run of raw samples in the saved data. */
+    static constexpr int chunkSize = 8192;
+
+    Progress readProgress (uint32_t& numReplacementsSeen) const noexcept;
+    bool isStillInstalled (const TakeInfo&) const noexcept;
+
+    bool perform (const std::shared_ptr<Request>&, int timeoutMs);
+
+    template <typename SampleType>
+    bool readFrames (const TakeInfo&, int startFrame, juce::AudioBuffer<SampleType>& dest, int timeoutMs);
+
+    template <typename SampleType>
+    bool writeFrames (juce::OutputStream&, const TakeInfo&, CompactCaptureBuffer* encoder, juce::uint32 deadline);
+
+    template <typename SampleType>
+    static std::unique_ptr<CaptureBuffer> readSavedFrames (juce::InputStream&, int numChannels, int numFrames);
+    bool serve (Request&, CaptureBuffer* installedBuffer) const;
+    TakeInfo getInstalledTake (CaptureBuffer* installedBuffer) const noexcept;
+
+    juce::Thread& worker;
+
+    // Progress is published with a sequence lock: the count is odd while
+    // the audio thread is part way through writing the two words, so the
+    // worker tries again. The generation takes the first word; the frame
+    // counts and flags the second.
+    std::atomic<uint32_t> progressSequence { 0 }, numReplacements { 0 };
+    std::atomic<uint64_t> progressWords[2] {};
+
+    juce::CriticalSection requestLock;
+    std::vector<std::shared_ptr<Request>> pendingRequests;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TakeArchiver)
+};
@@ -0,0 +1,246 @@
+/*
+  ==============================================================================
+
+    Writes the running take out to a WAV or FLAC file in the background.
+
+  ==============================================================================
+*/
+
+#include "TakeExporter.h"
+#include "ReversatronKernels.h"
+
+//==============================================================================
+TakeExporter::TakeExporter (TakeArchiver& archiverToUse)
+    : juce::Thread ("ReversaTron exporter"),
+      archiver (archiverToUse)
+{
+}
+
+TakeExporter::~TakeExporter()
+{
+    stopThread (10000);
+}
+
+juce::Result TakeExporter::start (const Options& newOptions)
+{
+    if (isThreadRunning())
+        return juce::Result::fail ("An export is already running.");
+
+    const auto info = archiver.getTakeInfo (startTimeoutMs);
+
+    if (info.numFramesRecorded == 0)
+        return juce::Result::fail ("There's no recorded take to export yet.");
+
+    options = newOptions;
+    takeInfo = info;
+    proportion = 0.0f;
+    isWaitingForTake = ! info.isFinished;
+
+    {
+        const juce::ScopedLock sl (errorLock);
+        error = {};
+    }
+
+    startThread();
+    return juce::Result::ok();
+}
+
+void TakeExporter::cancel()
+{
+    stopThread (10000);
+}
+
+TakeExporter::Progress TakeExporter::getProgress() const
+{
+    Progress progress;
+    progress.isRunning = isThreadRunning();
+    progress.isWaitingForTake = progress.isRunning && isWaitingForTake;
+    progress.proportion = proportion;
+
+    const juce::ScopedLock sl (errorLock);
+    progress.error = error;
+    return progress;
+}
+
+//==============================================================================
+void TakeExporter::run()
+{
+    auto result = waitForTake();
+
+    if (result.isEmpty() && ! threadShouldExit())
+        result = writeTake();
+
+    const juce::ScopedLock sl (errorLock);
+    error = result;
+}
+
+juce::String TakeExporter::waitForTake()
+{
+    // Checked until recording ends, when the take's final length is known.
+    while (! takeInfo.isFinished && ! threadShouldExit())
+    {
+        wait (recordingPollMs);
+
+        const auto info = archiver.getTakeInfo (readTimeoutMs);
+
+        if (info.numFramesRecorded == 0 || info.generation != takeInfo.generation
+            || info.numReplacements != takeInfo.numReplacements)
+            return "The take was stopped before it finished recording.";
+
+        takeInfo = info;
+    }
+
+    isWaitingForTake = false;
+    return {};
+}
+
+juce::String TakeExporter::writeTake()
+{
+    const auto& file = options.file;
+    const auto numChannels = takeInfo.numChannels;
+    const auto numFrames = takeInfo.numFramesRecorded;
+    const auto isFlac = file.hasFileExtension ("flac");
+
+    // The same fades as playback gives a take (see PlaybackFades), measured
+    // in frames through the exported file.
+    fadeLength = juce::jmin (static_cast<double> (options.crossfadeSeconds) * options.sampleRate, static_cast<double> (numFrames / 2));
+    fadeInEnd = static_cast<int> (std::ceil (fadeLength));
+    fadeOutStart = juce::jmax (fadeInEnd, static_cast<int> (std::floor (numFrames - fadeLength)) + 1);
+    gainStep = fadeLength > 0.0 ? static_cast<float> (1.0 / fadeLength) : 0.0f;
+
+    std::unique_ptr<juce::AudioFormat> format;
+
+    if (isFlac)
+        format = std::make_unique<juce::FlacAudioFormat>();
+    else
+        format = std::make_unique<juce::WavAudioFormat>();
+
+    // 32 bits makes the WAV writer use floats.
+    const auto bitsPerSample = takeInfo.bitsPerSample < 32 ? takeInfo.bitsPerSample : (isFlac ? 24 : 32);
+
+    file.deleteFile();
+    std::unique_ptr<juce::OutputStream> stream (file.createOutputStream());
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+
+    if (stream != nullptr)
+        writer.reset (format->createWriterFor (stream.get(), options.sampleRate, (unsigned int) numChannels, bitsPerSample, {}, 0));
+
+    if (writer == nullptr)
+        return "Couldn't write " + file.getFullPathName();
+
+    stream.release();   // now owned by the writer
+
+    juce::AudioBuffer<float> source (numChannels, chunkSize);
+    juce::AudioBuffer<float> output (numChannels, chunkSize);
+
+    juce::TimeSliceThread diskThread ("ReversaTron export writer");
+    diskThread.startThread();
+    juce::String result;
+
+    {
+        // Deleting the threaded writer writes out whatever is still queued,
+        // and closes the file, even if the export has been cancelled.
+        juce::AudioFormatWriter::ThreadedWriter threadedWriter (writer.release(), diskThread, fifoSize);
+
+        for (int done = 0; done < numFrames && ! threadShouldExit();)
+        {
+            const auto num = juce::jmin (chunkSize, numFrames - done);
+
+            // A reversed export works back from the end of the take, so each
+            // chunk comes from the recorded frames mirroring its place.
+            const auto sourceStart = options.reversed ? numFrames - done - num : done;
+
+            source.setSize (numChannels, num, false, false, true);
+
+            if (! archiver.readTake (takeInfo, sourceStart, source, readTimeoutMs))
+            {
+                result = "The take was replaced before it could all be exported.";
+                break;
+            }
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                renderChunk (source.getReadPointer (channel), output.getWritePointer (channel), done, num);
+
+            // The FIFO only fills up if the disk falls behind.
+            while (! threadedWriter.write (output.getArrayOfReadPointers(), num))
+            {
+                if (threadShouldExit())
+                    break;
+
+                wait (5);
+            }
+
+            done += num;
+            proportion = static_cast<float> (done) / static_cast<float> (numFrames);
+        }
+    }
+
+    diskThread.stopThread (10000);
+    return result;
+}
+
+void TakeExporter::renderChunk (const float* source, float* dest, int outputStart, int num) const noexcept
+{
+    // As in playback, the chunk is split into fade in, plain and fade out
+    // segments, each one gain ramp over the (possibly reversed) source.
+    for (int offset = 0; offset < num;)
+    {
+        const auto frame = outputStart + offset;
+        int segmentEnd;
+        float gain = 1.0f, step = 0.0f;
+        bool isFade = true;
+
+        if (frame < fadeInEnd)
+        {
+            segmentEnd = fadeInEnd;
+            gain = static_cast<float> (frame / fadeLength);
+            step = gainStep;
+        }
+        else if (frame < fadeOutStart)
+        {
+            segmentEnd = fadeOutStart;
+            isFade = false;
+        }
+        else
+        {
+            segmentEnd = takeInfo.numFramesRecorded;
+            gain = static_cast<float> ((takeInfo.numFramesRecorded - frame) / fadeLength);
+            step = -gainStep;
+        }
+
+        const auto n = juce::jmin (num - offset, segmentEnd - frame);
+        auto* segmentDest = dest + offset;
+
+        if (options.reversed)
+        {
+            // Output offset i reads source (num - 1 - i).
+            const auto* segmentSource = source + num - offset - n;
+
+            if (isFade)
+            {
+                juce::FloatVectorOperations::clear (segmentDest, n);
+                ReversatronKernels::reverseCrossfade (segmentDest, segmentSource, n, gain, step);
+            }
+            else
+            {
+                ReversatronKernels::reverseCopy (segmentDest, segmentSource, n);
+            }
+        }
+        else
+        {
+            const auto* segmentSource = source + offset;
+
+            if (isFade)
+            {
+                juce::FloatVectorOperations::clear (segmentDest, n);
+                ReversatronKernels::crossfade (segmentDest, segmentSource, n, gain, step);
+            }
+            else
+            {
+                juce::FloatVectorOperations::copy (segmentDest, segmentSource, n);
+            }
+        }
+
+        offset += n;
+    }
+}
@@ -0,0 +1,92 @@
+/*
+  ==============================================================================
+
+    Writes the running take out to a WAV or FLAC file in the background.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TakeArchiver.h"
+
+//==============================================================================
+/**
+    Bounces the running take to an audio file, reversed or as it was
+    recorded, faded in and out the way playback fades it.
+
+    Everything happens on the exporter's own thread: it reads the take a
+    chunk at a time out of the capture buffer through a TakeArchiver,
+    reverses and fades the chunk, and hands it to a JUCE ThreadedWriter,
+    whose FIFO is emptied to disk by a second thread. Even the longest take
+    is never copied whole, and the audio thread carries on untouched.
+
+    A take that's still recording is waited for, so that all of it is
+    exported. Files are written at the take's own precision: 16 or 24-bit
+    PCM for the fixed-point formats, and 32-bit float WAV for floating point
+    takes (or 24-bit FLAC, which has no float format).
+*/
+class TakeExporter  : private juce::Thread
+{
+public:
+    explicit TakeExporter (TakeArchiver&);
+    ~TakeExporter() override;
+
+    struct Options
+    {
+        juce::File file;                // FLAC if it has a .flac extension, otherwise WAV
+        bool reversed = true;
+        double sampleRate = 44100.0;
+        float crossfadeSeconds = 0.0f;
+    };
+
+    /** Message thread: starts exporting the take, or says why it can't. */
+    juce::Result start (const Options& options);
+
+    /** Message thread: stops an export part way. What has been written so
+        far is left in the file.
+    */
+    void cancel();
+
+    struct Progress
+    {
+        bool isRunning = false;
+        bool isWaitingForTake = false;  // the take is still recording
+        float proportion = 0.0f;        // of the export running, or the last one
+        juce::String error;             // why the last export failed, if it did
+    };
+
+    Progress getProgress() const;
+
+private:
+    static constexpr int chunkSize = 8192;
+    static constexpr int fifoSize = 1 << 16;
+
+    void run() override;
+    juce::String waitForTake();
+    juce::String writeTake();
+    void renderChunk (const float* source, float* dest, int outputStart, int num) const noexcept;
+
+    // How long to wait for the allocator's worker to answer a read, and how
+    // often to look at a take that's still recording.
+    static constexpr int startTimeoutMs = 500;
+    static constexpr int readTimeoutMs = 5000;
+    static constexpr int recordingPollMs = 50;
+
+    TakeArchiver& archiver;
+
+    // Set by start() before the thread runs, and only read by it after.
+    Options options;
+    TakeArchiver::TakeInfo takeInfo;
+    double fadeLength = 0.0;
+    int fadeInEnd = 0, fadeOutStart = 0;
+    float gainStep = 0.0f;
+
+    std::atomic<float> proportion { 0.0f };
+    std::atomic<bool> isWaitingForTake { false };
+    juce::CriticalSection errorLock;
+    juce::String error;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TakeExporter)
+};
@@ -0,0 +1,33 @@
+/*
+  ==============================================================================
+
+    Sample-accurate transport commands from the message thread to the audio
+    thread.
+
+  ==============================================================================
+*/
+
+#include "TransportCommandQueue.h"
+
+//==============================================================================
+bool TransportCommandQueue::push (const TransportCommand& command) noexcept
+{
+    if (fifo.getFreeSpace() == 0)
+        return false;
+
+    fifo.write (1).forEach ([&] (int index) { commands[(size_t) index] = command; });
+    return true;
+}
+
+const TransportCommand* TransportCommandQueue::peek() const noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (1, start1, size1, start2, size2);
+
+    return size1 > 0 ? &commands[(size_t) start1] : nullptr;
+}
+
+void TransportCommandQueue::pop() noexcept
+{
+    fifo.finishedRead (1);
+}
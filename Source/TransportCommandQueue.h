@@ -0,0 +1,83 @@
+/*
+  ==============================================================================
+
+    Sample-accurate transport commands from the message thread to the audio
+    thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+struct TransportCommand
+{
+    enum Type
+    {
+        start = 0,          // begin a new take, recording from frame 0
+        stop,               // stop recording/playback
+        retrigger,          // restart the current take from frame 0
+        switchToPlayback,   // reverse what has been recorded so far, now
+        resume,             // pick up a take restored from a saved session
+        recall              // retroactive mode: play a take from the bank again
+    };
+
+    /** Sample time (in samples processed since the plugin was created) at
+        which the command takes effect. Anything at or before the start of the
+        next block is applied at its first sample.
+    */
+    static constexpr juce::int64 asSoonAsPossible = -1;
+
+    Type type = stop;
+    juce::int64 sampleTime = asSoonAsPossible;
+    float crossfadeSeconds = 0.0f;    // used by start and resume
+    int slot = 0;                     // used by recall
+
+    /** Used by resume: where the restored take had got to, in frames of the
+        take as it was saved. It resumes once the buffer it's being restored
+        into arrives.
+    */
+    struct ResumePoint
+    {
+        uint32_t generation = 0;
+        int takeLength = 0;
+        int numFramesRecorded = 0;
+        juce::int64 position = 0;       // playback position, if it had finished recording
+        bool isPlaying = false;
+    };
+
+    ResumePoint resumePoint;
+};
+
+//==============================================================================
+/**
+    A single-producer/single-consumer FIFO of TransportCommands.
+
+    The message thread pushes; the audio thread peeks at the front command to
+    find where in the block it falls, applies it at that sample and pops it.
+    Commands must be pushed in sample-time order.
+*/
+class TransportCommandQueue
+{
+public:
+    TransportCommandQueue() = default;
+
+    /** Producer: returns false if the queue is full. */
+    bool push (const TransportCommand& command) noexcept;
+
+    /** Consumer: the oldest command, or nullptr if there isn't one. */
+    const TransportCommand* peek() const noexcept;
+
+    /** Consumer: removes the command returned by peek(). */
+    void pop() noexcept;
+
+private:
+    static constexpr int capacity = 64;
+
+    juce::AbstractFifo fifo { capacity };
+    std::array<TransportCommand, capacity> commands;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TransportCommandQueue)
+};
@@ -0,0 +1,226 @@
+/*
+  ==============================================================================
+
+    A min/max peak pyramid of the capture buffer, built while recording.
+
+  ==============================================================================
+*/
+
+#include "WaveformOverview.h"
+
+//==============================================================================
+WaveformOverview::WaveformOverview()
+    : peaks (std::make_unique<std::atomic<uint32_t>[]> ((size_t) (numSlots * 2 * maxPeaksPerTake)))
+{
+}
+
+uint32_t WaveformOverview::pack (Peak peak) noexcept
+{
+    auto quantise = [] (float value)
+    {
+        return static_cast<uint16_t> (static_cast<int16_t> (juce::jlimit (-32767, 32767, juce::roundToInt (value * 32767.0f))));
+    };
+
+    return static_cast<uint32_t> (quantise (peak.min)) | (static_cast<uint32_t> (quantise (peak.max)) << 16);
+}
+
+WaveformOverview::Peak WaveformOverview::unpack (uint32_t packed) noexcept
+{
+    Peak peak;
+    peak.min = static_cast<int16_t> (packed & 0xffff) / 32767.0f;
+    peak.max = static_cast<int16_t> (packed >> 16) / 32767.0f;
+    return peak;
+}
+
+std::atomic<uint32_t>& WaveformOverview::peakAt (int slot, int level, int index) const noexcept
+{
+    jassert (index < (maxPeaksPerTake >> level));
+    return peaks[(size_t) (slot * 2 * maxPeaksPerTake + levelOffset (level) + index)];
+}
+
+//==============================================================================
+template <typename SampleType>
+void WaveformOverview::addFrames (const SampleType* const* channels, int numChannels, int startSample,
+                                  uint64_t frame, int numFrames, int takeLength) noexcept
+{
+    if (frame == 0)
+        startTake (takeLength);
+    else
+        setTakeLength (takeLength);
+
+    const auto samplesPerPeak = slots[(size_t) recordSlot.load (std::memory_order_relaxed)].samplesPerPeak.load (std::memory_order_relaxed);
+
+    for (int done = 0; done < numFrames;)
+    {
+        const auto num = juce::jmin (numFrames - done, samplesPerPeak - pendingFrames);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const auto range = juce::FloatVectorOperations::findMinAndMax (channels[channel] + startSample + done, num);
+            pending.merge ({ static_cast<float> (range.getStart()), static_cast<float> (range.getEnd()) });
+        }
+
+        pendingFrames += num;
+        done += num;
+
+        if (pendingFrames == samplesPerPeak)
+            storePeak();
+    }
+}
+
+template void WaveformOverview::addFrames (const float* const*, int, int, uint64_t, int, int) noexcept;
+template void WaveformOverview::addFrames (const double* const*, int, int, uint64_t, int, int) noexcept;
+
+void WaveformOverview::beginPlayback (int numFramesRecorded, bool doubleBuffered) noexcept
+{
+    setTakeLength (numFramesRecorded);
+
+    // The last peak of a take cut short (or one that isn't a whole number of
+    // peaks long) is only partly filled.
+    if (pendingFrames > 0)
+        storePeak();
+
+    const auto slot = recordSlot.load (std::memory_order_relaxed);
+    playbackSlot.store (slot);
+
+    if (doubleBuffered)
+        recordSlot.store (slot ^ 1);
+}
+
+void WaveformOverview::startTake (int takeLength) noexcept
+{
+    auto& slot = slots[(size_t) recordSlot.load (std::memory_order_relaxed)];
+
+    // The coarsest power of two that fits the take into maxPeaksPerTake.
+    auto samplesPerPeak = minSamplesPerPeak;
+
+    while (static_cast<juce::int64> (samplesPerPeak) * maxPeaksPerTake < takeLength)
+        samplesPerPeak *= 2;
+
+    slot.numPeaks.store (0, std::memory_order_relaxed);
+    slot.takeLength.store (takeLength, std::memory_order_relaxed);
+    slot.samplesPerPeak.store (samplesPerPeak, std::memory_order_relaxed);
+    slot.generation.store (slot.generation.load (std::memory_order_relaxed) + 1, std::memory_order_release);
+
+    pending = {};
+    pendingFrames = 0;
+}
+
+void WaveformOverview::setTakeLength (int takeLength) noexcept
+{
+    auto& slot = slots[(size_t) recordSlot.load (std::memory_order_relaxed)];
+
+    if (slot.takeLength.load (std::memory_order_relaxed) == takeLength)
+        return;
+
+    while (static_cast<juce::int64> (slot.samplesPerPeak.load (std::memory_order_relaxed)) * maxPeaksPerTake < takeLength)
+        halveResolution();
+
+    slot.takeLength.store (takeLength, std::memory_order_release);
+}
+
+void WaveformOverview::halveResolution() noexcept
+{
+    // Level l + 1 already holds what level l needs at twice the peak size, so
+    // each level is copied down over the one below, which is done with.
+    const auto slotIndex = recordSlot.load (std::memory_order_relaxed);
+    auto& slot = slots[(size_t) slotIndex];
+    const auto numPeaks = slot.numPeaks.load (std::memory_order_relaxed);
+    const auto samplesPerPeak = slot.samplesPerPeak.load (std::memory_order_relaxed);
+
+    // A last peak without a partner goes back into the one being filled.
+    if ((numPeaks & 1) != 0)
+    {
+        pending.merge (unpack (peakAt (slotIndex, 0, numPeaks - 1).load (std::memory_order_relaxed)));
+        pendingFrames += samplesPerPeak;
+    }
+
+    for (int level = 0; level + 1 < numLevels; ++level)
+        for (int index = 0; index < (numPeaks >> (level + 1)); ++index)
+            peakAt (slotIndex, level, index).store (peakAt (slotIndex, level + 1, index).load (std::memory_order_relaxed), std::memory_order_relaxed);
+
+    // Readers that caught the copy half done see a new generation and start over.
+    slot.numPeaks.store (numPeaks >> 1, std::memory_order_relaxed);
+    slot.samplesPerPeak.store (samplesPerPeak * 2, std::memory_order_relaxed);
+    slot.generation.store (slot.generation.load (std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void WaveformOverview::storePeak() noexcept
+{
+    const auto slotIndex = recordSlot.load (std::memory_order_relaxed);
+    auto& slot = slots[(size_t) slotIndex];
+    const auto index = slot.numPeaks.load (std::memory_order_relaxed);
+    auto peak = pending;
+
+    pending = {};
+    pendingFrames = 0;
+
+    if (index >= maxPeaksPerTake)
+        return;
+
+    peakAt (slotIndex, 0, index).store (pack (peak), std::memory_order_relaxed);
+
+    // Each time a peak completes a pair, the pair's parent in the level above
+    // is complete too.
+    auto levelIndex = index;
+
+    for (int level = 1; level < numLevels && (levelIndex & 1) != 0; ++level)
+    {
+        peak.merge (unpack (peakAt (slotIndex, level - 1, levelIndex - 1).load (std::memory_order_relaxed)));
+        levelIndex >>= 1;
+        peakAt (slotIndex, level, levelIndex).store (pack (peak), std::memory_order_relaxed);
+    }
+
+    slot.numPeaks.store (index + 1, std::memory_order_release);
+}
+
+//==============================================================================
+WaveformOverview::TakeInfo WaveformOverview::getTakeInfo (bool playbackTake) const noexcept
+{
+    TakeInfo take;
+    take.slot = (playbackTake ? playbackSlot : recordSlot).load();
+
+    const auto& slotToRead = slots[(size_t) take.slot];
+    take.generation = slotToRead.generation.load (std::memory_order_acquire);
+    take.takeLength = slotToRead.takeLength.load (std::memory_order_relaxed);
+    take.samplesPerPeak = slotToRead.samplesPerPeak.load (std::memory_order_relaxed);
+    take.numPeaks = slotToRead.numPeaks.load (std::memory_order_acquire);
+    return take;
+}
+
+void WaveformOverview::getPeaks (const TakeInfo& take, double startFrame, double framesPerPixel,
+                                 int firstPixel, int numPixels, Peak* dest) const noexcept
+{
+    // Start from the coarsest level whose peaks are no wider than a pixel.
+    auto level = 0;
+
+    while (level + 1 < numLevels && static_cast<double> (take.samplesPerPeak << (level + 1)) <= framesPerPixel)
+        ++level;
+
+    const auto framesCovered = static_cast<juce::int64> (take.numPeaks) * take.samplesPerPeak;
+
+    for (int i = 0; i < numPixels; ++i)
+    {
+        const auto pixelStart = startFrame + (firstPixel + i) * framesPerPixel;
+        auto frameStart = juce::jmax ((juce::int64) 0, static_cast<juce::int64> (std::floor (pixelStart)));
+        const auto frameEnd = juce::jmin (framesCovered, static_cast<juce::int64> (std::ceil (pixelStart + framesPerPixel)));
+
+        Peak result;
+
+        // The upper levels lag behind level 0 until their pairs complete, so
+        // whatever the coarse level doesn't cover yet comes from finer ones.
+        for (int l = level; l >= 0 && frameStart < frameEnd; --l)
+        {
+            const auto size = static_cast<juce::int64> (take.samplesPerPeak) << l;
+            const auto available = static_cast<juce::int64> (take.numPeaks >> l);
+            const auto end = juce::jmin ((frameEnd + size - 1) / size, available);
+
+            for (auto index = frameStart / size; index < end; ++index)
+                result.merge (unpack (peakAt (take.slot, l, static_cast<int> (index)).load (std::memory_order_relaxed)));
+
+            frameStart = juce::jmax (frameStart, end * size);
+        }
+
+        dest[i] = result;
+    }
+}
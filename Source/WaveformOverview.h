@@ -0,0 +1,116 @@
+/*
+  ==============================================================================
+
+    A min/max peak pyramid of the capture buffer, built while recording.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Summarises each take as min/max peaks at a ladder of resolutions, so the
+    editor can draw any zoom level without touching the recorded samples.
+
+    The audio thread feeds in every frame it records with addFrames(). Level 0
+    holds one peak per samplesPerPeak frames (all channels combined), and each
+    level above holds one peak per two of the level below, filled in as soon
+    as both halves are complete. The resolution is picked at the start of each
+    take so that the whole take fits in a fixed, preallocated number of peaks:
+    nothing is allocated after construction and the cost per recorded frame
+    doesn't depend on the buffer length. If the take is made longer while it
+    records, every level moves down one and the resolution halves.
+
+    There are two takes' worth of storage so that in ping-pong mode the take
+    being played back stays visible while the next one records. Peaks are
+    stored as packed 16-bit min/max pairs in atomics, so the message thread
+    can read them at any time; at worst it sees a take that has just been
+    restarted, which it can tell from the generation number.
+*/
+class WaveformOverview
+{
+public:
+    WaveformOverview();
+
+    struct Peak
+    {
+        float min = 1.0f, max = -1.0f;      // min > max means no data
+
+        bool isEmpty() const noexcept       { return min > max; }
+        void merge (Peak other) noexcept    { min = juce::jmin (min, other.min); max = juce::jmax (max, other.max); }
+    };
+
+    /** What the message thread needs to know about one of the takes. */
+    struct TakeInfo
+    {
+        int slot = 0;
+        uint32_t generation = 0;            // changes whenever the take restarts
+        int takeLength = 0;                 // frames
+        int samplesPerPeak = 1;
+        int numPeaks = 0;                   // complete level 0 peaks so far
+    };
+
+    //==============================================================================
+    /** Audio thread: summarises numFrames recorded frames, starting at the
+        given frame of a take takeLength frames long. Frame 0 starts a new take;
+        the length can change from one call to the next. The samples can be
+        floats or doubles.
+    */
+    template <typename SampleType>
+    void addFrames (const SampleType* const* channels, int numChannels, int startSample,
+                    uint64_t frame, int numFrames, int takeLength) noexcept;
+
+    /** Audio thread: the take being recorded starts playing back, with
+        numFramesRecorded as its final length. Any partly filled peak is
+        completed, and if the capture is double buffered the next take records
+        into the other slot.
+    */
+    void beginPlayback (int numFramesRecorded, bool doubleBuffered) noexcept;
+
+    //==============================================================================
+    /** Any thread: the take being recorded, or the one being played back. */
+    TakeInfo getTakeInfo (bool playbackTake) const noexcept;
+
+    /** Any thread: fills dest with numPixels peaks, from pixel firstPixel of
+        a view that starts at startFrame and shows framesPerPixel frames per
+        pixel. Pixels with nothing recorded yet are left empty.
+    */
+    void getPeaks (const TakeInfo& take, double startFrame, double framesPerPixel,
+                   int firstPixel, int numPixels, Peak* dest) const noexcept;
+
+private:
+    static constexpr int numSlots = 2;
+    static constexpr int maxPeaksPerTake = 1 << 15;
+    static constexpr int numLevels = 16;    // level 0 to the single peak covering the whole take
+    static constexpr int minSamplesPerPeak = 16;
+
+    static uint32_t pack (Peak peak) noexcept;
+    static Peak unpack (uint32_t packed) noexcept;
+
+    static int levelOffset (int level) noexcept     { return 2 * maxPeaksPerTake - (2 * maxPeaksPerTake >> level); }
+
+    std::atomic<uint32_t>& peakAt (int slot, int level, int index) const noexcept;
+    void startTake (int takeLength) noexcept;
+    void setTakeLength (int takeLength) noexcept;
+    void halveResolution() noexcept;
+    void storePeak() noexcept;
+
+    struct Slot
+    {
+        std::atomic<uint32_t> generation { 0 };
+        std::atomic<int> takeLength { 0 }, samplesPerPeak { minSamplesPerPeak }, numPeaks { 0 };
+    };
+
+    std::array<Slot, numSlots> slots;
+    std::unique_ptr<std::atomic<uint32_t>[]> peaks;     // numSlots * 2 * maxPeaksPerTake, all levels back to back
+    std::atomic<int> recordSlot { 0 }, playbackSlot { 0 };
+
+    // Audio thread only: the level 0 peak being accumulated.
+    Peak pending;
+    int pendingFrames = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WaveformOverview)
+};
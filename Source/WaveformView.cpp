@@ -0,0 +1,183 @@
+/*
+  ==============================================================================
+
+    Draws the capture buffer's waveform overview with a live playhead.
+
+  ==============================================================================
+*/
+
+#include "WaveformView.h"
+
+//==============================================================================
+WaveformView::WaveformView (ReversatronAudioProcessor& p)
+    : audioProcessor (p)
+{
+    setOpaque (true);
+    startTimerHz (30);
+}
+
+WaveformView::~WaveformView()
+{
+    stopTimer();
+}
+
+//==============================================================================
+void WaveformView::paint (juce::Graphics& g)
+{
+    const auto clip = g.getClipBounds();
+    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId).darker (0.3f));
+
+    const auto& take = lastState.take;
+
+    if (take.takeLength <= 0)
+    {
+        g.setColour (juce::Colours::grey);
+        g.drawText ("No take recorded", getLocalBounds(), juce::Justification::centred);
+        return;
+    }
+
+    // Only the columns in the clip region are fetched and drawn.
+    const auto firstX = juce::jmax (0, clip.getX());
+    const auto numColumns = juce::jmin ((int) peaks.size(), clip.getRight()) - firstX;
+    const auto framesPerPixel = getVisibleLength (take) / juce::jmax (1, getWidth());
+    const auto centre = getHeight() * 0.5f;
+
+    if (numColumns > 0)
+    {
+        audioProcessor.getWaveformOverview().getPeaks (take, visibleStart, framesPerPixel, firstX, numColumns, peaks.data());
+
+        g.setColour (juce::Colours::white.withAlpha (lastState.headFrame < 0 ? 0.4f : 0.8f));
+
+        for (int i = 0; i < numColumns; ++i)
+        {
+            const auto& peak = peaks[(size_t) i];
+
+            if (! peak.isEmpty())
+                g.drawVerticalLine (firstX + i, centre - peak.max * centre, juce::jmax (centre - peak.min * centre, centre - peak.max * centre + 1.0f));
+        }
+    }
+
+    if (lastState.headFrame >= 0)
+    {
+        g.setColour (juce::Colours::orange);
+        g.drawVerticalLine (frameToX (take, lastState.headFrame), 0.0f, (float) getHeight());
+    }
+}
+
+void WaveformView::resized()
+{
+    peaks.resize ((size_t) juce::jmax (0, getWidth()));
+}
+
+void WaveformView::mouseWheelMove (const juce::MouseEvent& event, const juce::MouseWheelDetails& wheel)
+{
+    const auto& take = lastState.take;
+
+    if (take.takeLength <= 0 || getWidth() <= 0)
+        return;
+
+    // Zoom around the frame under the pointer, down to one peak per pixel.
+    const auto length = getVisibleLength (take);
+    const auto anchor = visibleStart + length * event.position.x / getWidth();
+    const auto minLength = juce::jmin ((double) take.samplesPerPeak * getWidth(), (double) take.takeLength);
+    const auto newLength = juce::jlimit (minLength, (double) take.takeLength, length * std::pow (2.0, -wheel.deltaY * 4.0));
+
+    visibleStart = juce::jlimit (0.0, take.takeLength - newLength, anchor - newLength * event.position.x / getWidth());
+    visibleLength = newLength >= take.takeLength ? 0.0 : newLength;
+    lastHeadX = -1;
+    repaint();
+}
+
+void WaveformView::mouseDoubleClick (const juce::MouseEvent&)
+{
+    visibleStart = 0.0;
+    visibleLength = 0.0;
+    lastHeadX = -1;
+    repaint();
+}
+
+//==============================================================================
+WaveformView::DisplayState WaveformView::getDisplayState() const noexcept
+{
+    const auto transport = audioProcessor.getTransportSnapshot();
+
+    DisplayState state;
+
+    // While a take is reversing, the one shown is the one being heard; in
+    // ping-pong mode that isn't the one being recorded.
+    state.showingPlayback = transport.status == ReversatronAudioProcessor::PLAYBACK
+                         || transport.status == ReversatronAudioProcessor::CONTINUOUS;
+    state.take = audioProcessor.getWaveformOverview().getTakeInfo (state.showingPlayback);
+
+    // Playback position p reads recorded frame (bufferLength - 1 - p).
+    if (transport.status == ReversatronAudioProcessor::RECORDING)
+        state.headFrame = static_cast<int> (transport.frame);
+    else if (state.showingPlayback)
+        state.headFrame = juce::jmax (0, transport.bufferLength - 1 - static_cast<int> (transport.playbackPosition));
+
+    return state;
+}
+
+double WaveformView::getVisibleLength (const WaveformOverview::TakeInfo& take) const noexcept
+{
+    return visibleLength > 0.0 ? visibleLength : (double) take.takeLength;
+}
+
+int WaveformView::frameToX (const WaveformOverview::TakeInfo& take, double frame) const noexcept
+{
+    return juce::roundToInt ((frame - visibleStart) * getWidth() / getVisibleLength (take));
+}
+
+void WaveformView::timerCallback()
+{
+    const auto state = getDisplayState();
+    const auto& take = state.take;
+    const auto& lastTake = lastState.take;
+
+    const auto isNewTake = take.slot != lastTake.slot || take.generation != lastTake.generation
+                        || take.takeLength != lastTake.takeLength || state.showingPlayback != lastState.showingPlayback
+                        || (state.headFrame < 0) != (lastState.headFrame < 0);
+
+    if (isNewTake)
+    {
+        if (take.takeLength != lastTake.takeLength)
+        {
+            visibleStart = 0.0;
+            visibleLength = 0.0;
+        }
+
+        lastState = state;
+        lastHeadX = -1;
+        repaint();
+        return;
+    }
+
+    // Only the columns that have gained peaks, and the head's old and new
+    // positions, need drawing again.
+    if (take.numPeaks != lastTake.numPeaks)
+    {
+        const auto startX = frameToX (take, (double) lastTake.numPeaks * take.samplesPerPeak) - 1;
+        const auto endX = frameToX (take, (double) take.numPeaks * take.samplesPerPeak) + 1;
+
+        if (endX > 0 && startX < getWidth())
+            repaint (startX, 0, endX - startX, getHeight());
+    }
+
+    lastState = state;
+
+    auto headX = state.headFrame >= 0 ? frameToX (take, state.headFrame) : -1;
+
+    if (headX > getWidth())
+        headX = -1;
+
+    if (headX != lastHeadX)
+    {
+        if (lastHeadX >= 0)
+            repaint (lastHeadX - 1, 0, 3, getHeight());
+
+        if (headX >= 0)
+            repaint (headX - 1, 0, 3, getHeight());
+
+        lastHeadX = headX;
+    }
+}
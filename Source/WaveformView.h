@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    Draws the capture buffer's waveform overview with a live playhead.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+//==============================================================================
+/**
+    Shows the current take from the processor's WaveformOverview, in recorded
+    order, with the write head while recording and the playhead (moving right
+    to left) while playing back.
+
+    It polls the overview and transport snapshot on a timer and only repaints
+    the columns that have new peaks and the strips the playhead has moved
+    across; paint() only fetches peaks for the clip region. The mouse wheel
+    zooms around the pointer and a double-click shows the whole take again.
+*/
+class WaveformView  : public juce::Component,
+                      private juce::Timer
+{
+public:
+    explicit WaveformView (ReversatronAudioProcessor&);
+    ~WaveformView() override;
+
+    //==============================================================================
+    void paint (juce::Graphics&) override;
+    void resized() override;
+    void mouseWheelMove (const juce::MouseEvent&, const juce::MouseWheelDetails&) override;
+    void mouseDoubleClick (const juce::MouseEvent&) override;
+
+private:
+    void timerCallback() override;
+
+    /** What's on screen: which take, and where the head is. */
+    struct DisplayState
+    {
+        WaveformOverview::TakeInfo take;
+        bool showingPlayback = false;
+        int headFrame = -1;                 // -1 when stopped
+    };
+
+    DisplayState getDisplayState() const noexcept;
+    double getVisibleLength (const WaveformOverview::TakeInfo& take) const noexcept;
+    int frameToX (const WaveformOverview::TakeInfo& take, double frame) const noexcept;
+
+    ReversatronAudioProcessor& audioProcessor;
+
+    DisplayState lastState;
+    int lastHeadX = -1;
+
+    // Zoom, in frames of the take; a visibleLength of 0 shows all of it.
+    double visibleStart = 0.0, visibleLength = 0.0;
+
+    std::vector<WaveformOverview::Peak> peaks;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WaveformView)
+};
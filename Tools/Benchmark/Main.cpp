@@ -0,0 +1,295 @@
+/*
+  ==============================================================================
+
+    ReversaTronBenchmark: times processBlock headlessly across a matrix of
+    block sizes, channel counts, buffer lengths and crossfade times, in both
+    RECORDING and PLAYBACK.
+
+    Usage:
+        ReversaTronBenchmark [options]
+
+        --quick                     a small matrix, for CTest
+        --format <float|16|24|lossless|double>
+        --double                    process in double precision
+        --voices <n>                reverse voices playing (default 1)
+        --seconds <s>               audio timed per case (default 1)
+        --max-ns-per-sample <n>     fail if any case averages more than this
+        --max-block-load <fraction> fail if any case's 99th percentile block
+                                    takes longer than this fraction of its
+                                    real-time duration
+
+    Prints one JSON object per case, e.g.
+
+        {"state":"playback","precision":"float","kernels":"AVX2","voices":1,"blockSize":256,"channels":2,
+         "bufferLength":10,"crossfade":0.5,"nsPerSample":0.81,"p99BlockUs":3.1,"worstBlockUs":4.2,
+         "blockBudgetUs":5333.3,"timedBlocks":187,"waitedBlocks":0,"nonFiniteBlocks":0,"denormalBlocks":0,
+         "droppedSamples":0,"workerWaitBlocks":0,"worstWorkerWaitUs":0}
+
+    Buffers are allocated whole before each case starts, so processBlock
+    never has to wait for the allocator's worker to top up its segment pool.
+    Any block that still waited for it is counted in waitedBlocks and left
+    out of the times, which are of the DSP alone. worstBlockUs is reported
+    but not gated on, as one descheduled block would fail the run.
+
+    nsPerSample is the mean time per channel sample; the block counts come
+    from the processor's own DSP load monitor. With 16 or more channels the
+    work is shared with a pool of worker threads, and workerWaitBlocks counts
+    the blocks in which the audio thread had to wait for one of them to
+    finish, with worstWorkerWaitUs the longest such wait in any one block. kernels is the instruction set
+    the playback kernels were picked for (REVERSATRON_KERNELS=baseline or
+    avx2 caps it, to compare them on one machine). The exit code is 1 if any
+    threshold was exceeded, any block produced NaN or infinite output, or
+    any input was dropped. The memory budget set for the plugin doesn't
+    apply here.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "ReversatronKernels.h"
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+
+    struct BenchmarkOptions
+    {
+        bool quick = false;
+        int captureFormat = 0;
+        bool doublePrecision = false;
+        int numVoices = 1;
+        double secondsPerCase = 1.0;
+        double maxNsPerSample = 0.0;    // 0 = no limit
+        double maxBlockLoad = 0.0;
+    };
+
+    struct BenchmarkCase
+    {
+        ReversatronAudioProcessor::RunningMode state;
+        int blockSize, numChannels;
+        float bufferLength, crossfadeTime;
+    };
+
+    struct BenchmarkResult
+    {
+        double nsPerSample = 0.0, p99BlockUs = 0.0, worstBlockUs = 0.0, blockBudgetUs = 0.0;
+        int numTimedBlocks = 0, numWaitedBlocks = 0;
+        uint64_t numNonFiniteBlocks = 0, numDenormalBlocks = 0, numDroppedSamples = 0, numWorkerWaitBlocks = 0;
+        double worstWorkerWaitUs = 0.0;
+    };
+
+    void setParameter (ReversatronAudioProcessor& processor, const juce::String& id, float value)
+    {
+        auto* parameter = processor.getApvts().getParameter (id);
+        parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+    }
+
+    //==============================================================================
+    template <typename SampleType>
+    BenchmarkResult runCase (const BenchmarkCase& c, const BenchmarkOptions& options)
+    {
+        ReversatronAudioProcessor processor;
+
+        // Non-realtime, so that running faster than real time never drops
+        // samples, with the buffer allocated up front so it needn't wait.
+        processor.setNonRealtime (true);
+        processor.setIgnoresMemoryBudget (true);
+        processor.setReservesWholeBuffers (true);
+        processor.setProcessingPrecision (std::is_same_v<SampleType, double> ? juce::AudioProcessor::doublePrecision
+                                                                             : juce::AudioProcessor::singlePrecision);
+        processor.setPlayConfigDetails (c.numChannels, c.numChannels, sampleRate, c.blockSize);
+        setParameter (processor, "storage", 0.0f);
+        setParameter (processor, "captureFormat", (float) options.captureFormat);
+        setParameter (processor, "voices", (float) options.numVoices);
+        processor.prepareToPlay (sampleRate, c.blockSize);
+        processor.startTake (c.bufferLength, c.crossfadeTime);
+
+        // A second of noise to feed in, copied into the block before each call.
+        juce::Random random (0x5eed);
+        juce::AudioBuffer<SampleType> noise (c.numChannels, (int) sampleRate);
+
+        for (int channel = 0; channel < c.numChannels; ++channel)
+            for (int i = 0; i < noise.getNumSamples(); ++i)
+                noise.setSample (channel, i, static_cast<SampleType> (random.nextFloat() * 2.0f - 1.0f));
+
+        juce::AudioBuffer<SampleType> block (c.numChannels, c.blockSize);
+        juce::MidiBuffer midi;
+        int noisePosition = 0;
+
+        auto process = [&]
+        {
+            for (int channel = 0; channel < c.numChannels; ++channel)
+                block.copyFrom (channel, 0, noise, channel, noisePosition, c.blockSize);
+
+            noisePosition = (noisePosition + c.blockSize) % (noise.getNumSamples() - c.blockSize);
+
+            const auto start = juce::Time::getHighResolutionTicks();
+            processor.processBlock (block, midi);
+            return juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+        };
+
+        // The first block installs the buffer. For playback, record a whole
+        // take first; only blocks spent entirely in the wanted state count.
+        process();
+
+        while (processor.getTransportSnapshot().status != c.state)
+            process();
+
+        // Recording stops at the take length, and playback at the end of the
+        // buffer, which the take is played back up to.
+        const auto transport = processor.getTransportSnapshot();
+        const auto phaseEnd = (uint64_t) (c.state == ReversatronAudioProcessor::PLAYBACK ? transport.bufferLength : transport.takeLength);
+        const auto numBlocks = juce::jmax (1, (int) (juce::jmin (options.secondsPerCase * sampleRate, (double) transport.takeLength) / c.blockSize));
+
+        std::vector<double> times;
+        times.reserve ((size_t) numBlocks);
+        double total = 0.0;
+        int numWaited = 0;
+
+        for (int i = 0; i < numBlocks; ++i)
+        {
+            const auto before = processor.getTransportSnapshot();
+            const auto numWaitedBefore = processor.getDspLoadStats().numWaitedBlocks;
+            const auto seconds = process();
+
+            if (before.status != c.state || before.frame + (uint64_t) c.blockSize > phaseEnd)
+                continue;
+
+            if (processor.getDspLoadStats().numWaitedBlocks != numWaitedBefore)
+            {
+                ++numWaited;
+                continue;
+            }
+
+            total += seconds;
+            times.push_back (seconds);
+        }
+
+        std::sort (times.begin(), times.end());
+        const auto numTimed = (int) times.size();
+
+        const auto stats = processor.getDspLoadStats();
+        processor.stopTake();
+        processor.releaseResources();
+
+        BenchmarkResult result;
+        result.nsPerSample = numTimed > 0 ? total * 1.0e9 / ((double) numTimed * c.blockSize * c.numChannels) : 0.0;
+        result.p99BlockUs = numTimed > 0 ? times[(size_t) ((numTimed - 1) * 99 / 100)] * 1.0e6 : 0.0;
+        result.worstBlockUs = numTimed > 0 ? times.back() * 1.0e6 : 0.0;
+        result.numTimedBlocks = numTimed;
+        result.numWaitedBlocks = numWaited;
+        result.blockBudgetUs = c.blockSize / sampleRate * 1.0e6;
+        result.numNonFiniteBlocks = stats.numNonFiniteBlocks;
+        result.numDenormalBlocks = stats.numDenormalBlocks;
+        result.numDroppedSamples = stats.numDroppedSamples;
+        result.numWorkerWaitBlocks = stats.numWorkerWaitBlocks;
+        result.worstWorkerWaitUs = stats.worstWorkerWaitMicroseconds;
+        return result;
+    }
+
+    juce::Array<BenchmarkCase> createMatrix (bool quick)
+    {
+        const auto blockSizes     = quick ? std::vector<int> { 64, 1024 }      : std::vector<int> { 16, 64, 256, 1024, 4096 };
+        const auto channelCounts  = quick ? std::vector<int> { 2, 16 }         : std::vector<int> { 1, 2, 8, 16, 64 };
+        const auto bufferLengths  = quick ? std::vector<float> { 1.0f }        : std::vector<float> { 1.0f, 10.0f, 30.0f };
+        const auto crossfadeTimes = quick ? std::vector<float> { 0.25f }       : std::vector<float> { 0.0f, 0.25f, 2.0f };
+
+        juce::Array<BenchmarkCase> matrix;
+
+        for (auto state : { ReversatronAudioProcessor::RECORDING, ReversatronAudioProcessor::PLAYBACK })
+            for (auto blockSize : blockSizes)
+                for (auto numChannels : channelCounts)
+                    for (auto bufferLength : bufferLengths)
+                        for (auto crossfadeTime : crossfadeTimes)
+                            matrix.add ({ state, blockSize, numChannels, bufferLength, crossfadeTime });
+
+        return matrix;
+    }
+
+    bool parseArguments (const juce::StringArray& args, BenchmarkOptions& options)
+    {
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+            const auto hasValue = i + 1 < args.size();
+
+            if (arg == "--quick")                                   options.quick = true;
+            else if (arg == "--format" && hasValue)                 options.captureFormat = juce::jmax (0, juce::StringArray { "float", "16", "24", "lossless", "double" }.indexOf (args[++i]));
+            else if (arg == "--double")                             options.doublePrecision = true;
+            else if (arg == "--voices" && hasValue)                 options.numVoices = juce::jlimit (1, ReverseVoicePool::maxVoices, args[++i].getIntValue());
+            else if (arg == "--seconds" && hasValue)                options.secondsPerCase = juce::jmax (0.01, args[++i].getDoubleValue());
+            else if (arg == "--max-ns-per-sample" && hasValue)      options.maxNsPerSample = args[++i].getDoubleValue();
+            else if (arg == "--max-block-load" && hasValue)         options.maxBlockLoad = args[++i].getDoubleValue();
+            else                                                    return false;
+        }
+
+        return true;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // The processor's parameters need the message manager.
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray args;
+
+    for (int i = 1; i < argc; ++i)
+        args.add (argv[i]);
+
+    BenchmarkOptions options;
+
+    if (! parseArguments (args, options))
+    {
+        std::cout << "Usage: ReversaTronBenchmark [--quick] [--format float|16|24|lossless|double] [--double] [--voices n]" << std::endl
+                  << "                            [--seconds s] [--max-ns-per-sample n] [--max-block-load fraction]" << std::endl;
+        return 2;
+    }
+
+    auto numFailed = 0;
+
+    for (const auto& c : createMatrix (options.quick))
+    {
+        const auto result = options.doublePrecision ? runCase<double> (c, options) : runCase<float> (c, options);
+
+        std::cout << "{\"state\":\"" << (c.state == ReversatronAudioProcessor::RECORDING ? "recording" : "playback") << "\""
+                  << ",\"precision\":\"" << (options.doublePrecision ? "double" : "float") << "\""
+                  << ",\"kernels\":\"" << ReversatronKernels::getInstructionSet() << "\""
+                  << ",\"voices\":" << options.numVoices
+                  << ",\"blockSize\":" << c.blockSize
+                  << ",\"channels\":" << c.numChannels
+                  << ",\"bufferLength\":" << c.bufferLength
+                  << ",\"crossfade\":" << c.crossfadeTime
+                  << ",\"nsPerSample\":" << result.nsPerSample
+                  << ",\"p99BlockUs\":" << result.p99BlockUs
+                  << ",\"worstBlockUs\":" << result.worstBlockUs
+                  << ",\"blockBudgetUs\":" << result.blockBudgetUs
+                  << ",\"timedBlocks\":" << result.numTimedBlocks
+                  << ",\"waitedBlocks\":" << result.numWaitedBlocks
+                  << ",\"nonFiniteBlocks\":" << result.numNonFiniteBlocks
+                  << ",\"denormalBlocks\":" << result.numDenormalBlocks
+                  << ",\"droppedSamples\":" << result.numDroppedSamples
+                  << ",\"workerWaitBlocks\":" << result.numWorkerWaitBlocks
+                  << ",\"worstWorkerWaitUs\":" << result.worstWorkerWaitUs << "}" << std::endl;
+
+        const auto tooSlow = options.maxNsPerSample > 0.0 && result.nsPerSample > options.maxNsPerSample;
+        const auto tooLate = options.maxBlockLoad > 0.0 && result.p99BlockUs > options.maxBlockLoad * result.blockBudgetUs;
+        const auto notFinite = result.numNonFiniteBlocks > 0;
+        const auto dropped = result.numDroppedSamples > 0;
+
+        if (tooSlow || tooLate || notFinite || dropped)
+        {
+            std::cerr << "FAIL: " << (notFinite ? "NaN or infinite output"
+                                      : dropped ? "input samples dropped"
+                                      : tooSlow ? "mean time per sample over threshold"
+                                                : "99th percentile block time over threshold") << std::endl;
+            ++numFailed;
+        }
+    }
+
+    return numFailed == 0 ? 0 : 1;
+}
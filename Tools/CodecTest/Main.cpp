@@ -0,0 +1,298 @@
+/*
+  ==============================================================================
+
+    ReversaTronCodecTest: checks that takes stored in the fixed-point capture
+    formats come back bit-exact.
+
+    Usage:
+        ReversaTronCodecTest
+
+    For each of the 16-bit, 24-bit and 24-bit lossless formats, takes of
+    random, silent, full-scale and over-range input (plus values sitting
+    exactly half way between two steps) are recorded into a
+    CompactCaptureBuffer in uneven blocks, and read back both with
+    readTake() and reversed. Every sample has to match the input quantised
+    by a plain scalar reference, bit for bit. Takes are tried both filling
+    the buffer and cut short, with lengths that leave a partial last codec
+    block. The quantise and encode kernels are also checked against the
+    reference at every length up to a few vectors, so that their SIMD and
+    scalar paths are seen to agree.
+
+    Prints one line per failure, and exits with 1 if there were any.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "CompactCaptureBuffer.h"
+#include "ReversatronKernels.h"
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    enum class Signal
+    {
+        random,
+        silence,
+        fullScale,      // alternating +1 and -1
+        overRange,      // beyond +/-1, so clipped
+        halfSteps       // exactly half way between two steps
+    };
+
+    const char* getName (Signal signal)
+    {
+        switch (signal)
+        {
+            case Signal::random:    return "random";
+            case Signal::silence:   return "silence";
+            case Signal::fullScale: return "full scale";
+            case Signal::overRange: return "over range";
+            case Signal::halfSteps: return "half steps";
+        }
+
+        return "";
+    }
+
+    const char* getName (CaptureFormat format)
+    {
+        switch (format)
+        {
+            case CaptureFormat::int16:      return "16-bit";
+            case CaptureFormat::int24:      return "24-bit";
+            case CaptureFormat::lossless24: return "24-bit lossless";
+            case CaptureFormat::float32:
+            case CaptureFormat::float64:    break;
+        }
+
+        return "";
+    }
+
+    float getScale (CaptureFormat format)
+    {
+        return format == CaptureFormat::int16 ? ReversatronKernels::int16Scale : ReversatronKernels::int24Scale;
+    }
+
+    //==============================================================================
+    /** What a sample should come back as, worked out the slow way. */
+    int32_t quantiseReference (float sample, float scale)
+    {
+        if (std::isnan (sample))
+            return static_cast<int32_t> (-scale);
+
+        const auto clipped = juce::jlimit (-1.0f, 1.0f, sample);
+        return static_cast<int32_t> (std::nearbyint (static_cast<double> (clipped * scale)));
+    }
+
+    float decodeReference (float sample, float scale)
+    {
+        return static_cast<float> (quantiseReference (sample, scale)) * (1.0f / scale);
+    }
+
+    bool isSameBits (float a, float b)
+    {
+        return std::memcmp (&a, &b, sizeof (float)) == 0;
+    }
+
+    juce::AudioBuffer<float> makeInput (Signal signal, int numChannels, int numSamples, float scale, juce::Random& random)
+    {
+        juce::AudioBuffer<float> input (numChannels, numSamples);
+        input.clear();
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto* samples = input.getWritePointer (channel);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                switch (signal)
+                {
+                    case Signal::random:    samples[i] = random.nextFloat() * 2.0f - 1.0f; break;
+                    case Signal::silence:   samples[i] = 0.0f; break;
+                    case Signal::fullScale: samples[i] = (i & 1) != 0 ? -1.0f : 1.0f; break;
+                    case Signal::overRange: samples[i] = (random.nextFloat() * 2.0f - 1.0f) * 4.0f; break;
+                    case Signal::halfSteps: samples[i] = (static_cast<float> (random.nextInt (2001) - 1000) + 0.5f) / scale; break;
+                }
+            }
+        }
+
+        return input;
+    }
+
+    //==============================================================================
+    int numFailures = 0;
+
+    void fail (const juce::String& what)
+    {
+        std::cout << "FAIL: " << what << std::endl;
+        ++numFailures;
+    }
+
+    /** Records a take numRecorded frames long into a buffer numSamples long,
+        in blocks of uneven sizes, and reads it back.
+    */
+    void checkTake (CaptureFormat format, Signal signal, int numSamples, int numRecorded)
+    {
+        constexpr int numChannels = 2;
+        const auto scale = getScale (format);
+        const auto description = juce::String (getName (format)) + ", " + getName (signal) + ", "
+                               + juce::String (numRecorded) + " of " + juce::String (numSamples) + " frames";
+
+        juce::Random random (0x5eed + numSamples + numRecorded);
+        const auto input = makeInput (signal, numChannels, numRecorded, scale, random);
+
+        CompactCaptureBuffer capture (numChannels, numSamples, format);
+
+        if (! capture.isValid())
+        {
+            fail (description + ": couldn't allocate the buffer");
+            return;
+        }
+
+        juce::AudioBuffer<float> block (numChannels, 128);
+
+        for (int done = 0, i = 0; done < numRecorded; ++i)
+        {
+            const auto num = juce::jmin (numRecorded - done, 1 + (i * 37) % 128);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                block.copyFrom (channel, 0, input, channel, done, num);
+
+            capture.write (block, done, num);
+            done += num;
+        }
+
+        capture.beginPlayback (numRecorded);
+
+        // As recorded.
+        std::vector<float> output ((size_t) juce::jmax (1, numRecorded));
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            capture.readTake (channel, 0, output.data(), numRecorded);
+
+            for (int i = 0; i < numRecorded; ++i)
+            {
+                const auto expected = decodeReference (input.getSample (channel, i), scale);
+
+                if (! isSameBits (output[(size_t) i], expected))
+                {
+                    fail (description + ": readTake() frame " + juce::String (i) + " is " + juce::String (output[(size_t) i], 9)
+                          + ", expected " + juce::String (expected, 9));
+                    return;
+                }
+            }
+        }
+
+        // Reversed, as playback reads it: a take cut short starts part way in.
+        const auto firstPosition = numSamples - numRecorded;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            for (int done = 0, i = 0; done < numRecorded; ++i)
+            {
+                const auto num = juce::jmin (numRecorded - done, 1 + (i * 53) % 100);
+                capture.readReversed (channel, firstPosition + done, output.data() + done, num);
+                done += num;
+            }
+
+            for (int i = 0; i < numRecorded; ++i)
+            {
+                const auto expected = decodeReference (input.getSample (channel, numRecorded - 1 - i), scale);
+
+                if (! isSameBits (output[(size_t) i], expected))
+                {
+                    fail (description + ": readReversed() position " + juce::String (firstPosition + i) + " is "
+                          + juce::String (output[(size_t) i], 9) + ", expected " + juce::String (expected, 9));
+                    return;
+                }
+            }
+        }
+    }
+
+    //==============================================================================
+    /** The kernels on their own, at every length up to a few vectors, so
+        that both the vector loops and the scalar tails are covered.
+    */
+    void checkKernels()
+    {
+        juce::Random random (0xc0dec);
+
+        for (int num = 0; num <= 40; ++num)
+        {
+            std::vector<float> src ((size_t) num + 1);
+
+            for (auto& sample : src)
+            {
+                // Half steps of both scales, clipped values and the odd NaN.
+                switch (random.nextInt (4))
+                {
+                    case 0:  sample = (static_cast<float> (random.nextInt (2001) - 1000) + 0.5f) / ReversatronKernels::int16Scale; break;
+                    case 1:  sample = (static_cast<float> (random.nextInt (2001) - 1000) + 0.5f) / ReversatronKernels::int24Scale; break;
+                    case 2:  sample = (random.nextFloat() * 2.0f - 1.0f) * 2.0f; break;
+                    default: sample = random.nextInt (8) == 0 ? std::nanf ("") : random.nextFloat() * 2.0f - 1.0f; break;
+                }
+            }
+
+            std::vector<int32_t> quantised ((size_t) num + 1);
+            std::vector<int16_t> encoded16 ((size_t) num + 1);
+            std::vector<uint8_t> encoded24 ((size_t) num * 3 + 1);
+            std::vector<float> decoded ((size_t) num + 1);
+
+            for (auto scale : { ReversatronKernels::int16Scale, ReversatronKernels::int24Scale })
+            {
+                ReversatronKernels::quantise (quantised.data(), src.data(), num, scale);
+
+                for (int i = 0; i < num; ++i)
+                    if (quantised[(size_t) i] != quantiseReference (src[(size_t) i], scale))
+                        fail ("quantise(), " + juce::String (num) + " samples at scale " + juce::String (scale) + ": sample " + juce::String (i)
+                              + " is " + juce::String (quantised[(size_t) i]) + ", expected " + juce::String (quantiseReference (src[(size_t) i], scale)));
+            }
+
+            ReversatronKernels::encodeInt16 (encoded16.data(), src.data(), num);
+            ReversatronKernels::reverseDecodeInt16 (decoded.data(), encoded16.data(), num);
+
+            for (int i = 0; i < num; ++i)
+                if (! isSameBits (decoded[(size_t) (num - 1 - i)], decodeReference (src[(size_t) i], ReversatronKernels::int16Scale)))
+                    fail ("encodeInt16(), " + juce::String (num) + " samples: sample " + juce::String (i) + " doesn't round trip");
+
+            ReversatronKernels::encodeInt24 (encoded24.data(), src.data(), num);
+            ReversatronKernels::reverseDecodeInt24 (decoded.data(), encoded24.data(), num);
+
+            for (int i = 0; i < num; ++i)
+                if (! isSameBits (decoded[(size_t) (num - 1 - i)], decodeReference (src[(size_t) i], ReversatronKernels::int24Scale)))
+                    fail ("encodeInt24(), " + juce::String (num) + " samples: sample " + juce::String (i) + " doesn't round trip");
+        }
+    }
+}
+
+//==============================================================================
+int main()
+{
+    checkKernels();
+
+    constexpr auto blockSize = CompactCaptureBuffer::losslessBlockSize;
+
+    // Whole blocks, a partial last block, and lengths shorter than a block.
+    const int lengths[] = { 1, blockSize - 1, blockSize, 10 * blockSize, 10 * blockSize + 17, 4099 };
+
+    for (auto format : { CaptureFormat::int16, CaptureFormat::int24, CaptureFormat::lossless24 })
+    {
+        for (auto signal : { Signal::random, Signal::silence, Signal::fullScale, Signal::overRange, Signal::halfSteps })
+        {
+            for (auto numSamples : lengths)
+            {
+                // Filling the buffer, which finishes the last block as the
+                // take is recorded, and cut short part way through a block.
+                checkTake (format, signal, numSamples, numSamples);
+
+                if (numSamples > 1)
+                    checkTake (format, signal, numSamples, numSamples - 1 - numSamples / 3);
+            }
+        }
+    }
+
+    std::cout << (numFailures == 0 ? "All codec round trips were bit-exact." : "Some codec round trips failed.") << std::endl;
+    return numFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,189 @@
+/*
+  ==============================================================================
+
+    ReversaTronKernelTest: checks every build of the playback kernels that
+    this machine can run against a plain scalar reference.
+
+    Usage:
+        ReversaTronKernelTest
+
+    The reverse, crossfade and mix kernels are built for the baseline
+    instruction set and, on x86, for AVX2 and AVX-512 (see
+    ReversatronKernelDispatch.h). Each set the CPU supports, whatever
+    REVERSATRON_KERNELS says, is run at float and double precision over
+    every length up to a few of its widest vectors, from unaligned as well
+    as aligned pointers, with random samples and gain ramps. reverseCopy()
+    has to match exactly; the others have to come within a few rounding
+    steps of the reference, which allows for fused multiply-adds and for
+    the wide kernels working out the gain a vector at a time.
+
+    Prints one line per failure, and exits with 1 if there were any.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "ReversatronKernelDispatch.h"
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace
+{
+    enum class Kernel
+    {
+        reverseCrossfade,
+        crossfade,
+        reverseMix,
+        mix
+    };
+
+    const char* getName (Kernel kernel)
+    {
+        switch (kernel)
+        {
+            case Kernel::reverseCrossfade: return "reverseCrossfade";
+            case Kernel::crossfade:        return "crossfade";
+            case Kernel::reverseMix:       return "reverseMix";
+            case Kernel::mix:              return "mix";
+        }
+
+        return "";
+    }
+
+    /** Long enough for two of the widest vectors (AVX-512 floats) and a
+        scalar tail after them.
+    */
+    constexpr int maxLength = 40;
+
+    //==============================================================================
+    /** What dest[i] should come out as, worked out the slow way in double
+        precision.
+    */
+    bool isReversed (Kernel kernel)
+    {
+        return kernel == Kernel::reverseCrossfade || kernel == Kernel::reverseMix;
+    }
+
+    double getReference (Kernel kernel, double dry, double wet, int i, float gainStart, float gainStep)
+    {
+        const auto gain = (double) gainStart + (double) i * (double) gainStep;
+
+        if (kernel == Kernel::reverseCrossfade || kernel == Kernel::crossfade)
+            return dry + (wet - dry) * gain;
+
+        return dry + wet * gain;
+    }
+
+    /** The gain is worked out in floats, at whichever step of the ramp the
+        kernel starts a vector from, so allow for a few of its rounding steps
+        as well as those of the sample type.
+    */
+    template <typename SampleType>
+    double getTolerance (double dry, double wet)
+    {
+        const auto sampleEpsilon = (double) std::numeric_limits<SampleType>::epsilon();
+        const auto gainEpsilon = (double) std::numeric_limits<float>::epsilon();
+        return 4.0 * (sampleEpsilon + gainEpsilon) * (std::abs (dry) + std::abs (wet) + 1.0);
+    }
+
+    //==============================================================================
+    int numFailures = 0;
+
+    void fail (const juce::String& what)
+    {
+        std::cout << "FAIL: " << what << std::endl;
+        ++numFailures;
+    }
+
+    template <typename SampleType>
+    void checkKernels (const juce::String& setName, const ReversatronKernels::Dispatch::PlaybackKernels<SampleType>& kernels)
+    {
+        const auto precision = juce::String (std::is_same_v<SampleType, double> ? "double" : "float");
+        juce::Random random (0x5e7 + (int) sizeof (SampleType));
+
+        // One extra sample either side, so the kernels can be run from
+        // unaligned pointers too.
+        std::vector<SampleType> src ((size_t) maxLength + 2), dry ((size_t) maxLength + 2), dest ((size_t) maxLength + 2);
+
+        for (int num = 0; num <= maxLength; ++num)
+        {
+            for (int offset = 0; offset < 2; ++offset)
+            {
+                const auto description = setName + ", " + precision + ", " + juce::String (num) + " samples"
+                                       + (offset != 0 ? ", unaligned" : "");
+
+                for (auto& sample : src)
+                    sample = static_cast<SampleType> (random.nextDouble() * 2.0 - 1.0);
+
+                for (auto& sample : dry)
+                    sample = static_cast<SampleType> (random.nextDouble() * 2.0 - 1.0);
+
+                const auto* srcStart = src.data() + offset;
+
+                // Reversed copies have to be exact.
+                dest = dry;
+                kernels.reverseCopy (dest.data() + offset, srcStart, num);
+
+                for (int i = 0; i < num; ++i)
+                {
+                    if (dest[(size_t) (offset + i)] != srcStart[num - 1 - i])
+                    {
+                        fail (description + ": reverseCopy() sample " + juce::String (i) + " is wrong");
+                        break;
+                    }
+                }
+
+                if (dest[(size_t) (offset + num)] != dry[(size_t) (offset + num)] || (offset != 0 && dest[0] != dry[0]))
+                    fail (description + ": reverseCopy() wrote outside its range");
+
+                // A ramp that stays within [0, 1] over the run, either way.
+                const auto gainStart = random.nextFloat();
+                const auto gainEnd = random.nextFloat();
+                const auto gainStep = num > 1 ? (gainEnd - gainStart) / (float) (num - 1) : 0.0f;
+
+                for (auto kernel : { Kernel::reverseCrossfade, Kernel::crossfade, Kernel::reverseMix, Kernel::mix })
+                {
+                    auto* function = kernel == Kernel::reverseCrossfade ? kernels.reverseCrossfade
+                                   : kernel == Kernel::crossfade        ? kernels.crossfade
+                                   : kernel == Kernel::reverseMix       ? kernels.reverseMix
+                                                                        : kernels.mix;
+                    dest = dry;
+                    function (dest.data() + offset, srcStart, num, gainStart, gainStep);
+
+                    for (int i = 0; i < num; ++i)
+                    {
+                        const auto before = (double) dry[(size_t) (offset + i)];
+                        const auto wet = (double) srcStart[isReversed (kernel) ? num - 1 - i : i];
+                        const auto expected = getReference (kernel, before, wet, i, gainStart, gainStep);
+                        const auto actual = (double) dest[(size_t) (offset + i)];
+
+                        if (std::abs (actual - expected) > getTolerance<SampleType> (before, wet))
+                        {
+                            fail (description + ": " + getName (kernel) + "() sample " + juce::String (i) + " is "
+                                  + juce::String (actual, 12) + ", expected " + juce::String (expected, 12));
+                            break;
+                        }
+                    }
+
+                    if (dest[(size_t) (offset + num)] != dry[(size_t) (offset + num)] || (offset != 0 && dest[0] != dry[0]))
+                        fail (description + ": " + getName (kernel) + "() wrote outside its range");
+                }
+            }
+        }
+    }
+}
+
+//==============================================================================
+int main()
+{
+    for (const auto* set : ReversatronKernels::Dispatch::getSupportedKernelSets())
+    {
+        std::cout << "Checking the " << set->name << " kernels" << std::endl;
+        checkKernels (set->name, set->floats);
+        checkKernels (set->name, set->doubles);
+    }
+
+    std::cout << (numFailures == 0 ? "Every kernel set matched the reference." : "Some kernels didn't match the reference.") << std::endl;
+    return numFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,318 @@
+/*
+  ==============================================================================
+
+    ReversaTronRender: runs audio files through the ReversaTron engine
+    offline, one file per core at a time.
+
+    Usage:
+        ReversaTronRender [options] file...
+
+        --length <seconds>      buffer length (default 10)
+        --crossfade <seconds>   crossfade time (default 2)
+        --mode <reverse|pingpong|slice>
+        --tempo <bpm>           tempo for slice reverse mode (default 120)
+        --format <float|16|24|lossless|double>
+        --block <samples>       processing block size (default 4096)
+        --jobs <n>              files rendered at once (default: number of cores)
+        --output <directory>    where to write (default: next to each input)
+        --stats                 print each file's processBlock timing as JSON
+
+    Each input is written as <name>.reversed.wav, holding exactly what the
+    plugin would have output, less its reported latency. Once the input runs
+    out, silence is fed in until the last take has played back. The memory
+    budget set for the plugin doesn't apply, and if any input is dropped
+    anyway the file counts as failed and the exit code is 1.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include <iostream>
+
+namespace
+{
+    struct RenderOptions
+    {
+        float bufferLength = 10.0f;
+        float crossfadeTime = 2.0f;
+        double tempo = 120.0;
+        int mode = 0;
+        int captureFormat = 0;
+        int blockSize = 4096;
+        int numJobs = juce::SystemStats::getNumCpus();
+        bool printStats = false;
+        juce::File outputDirectory;
+        juce::Array<juce::File> inputs;
+    };
+
+    void setParameter (ReversatronAudioProcessor& processor, const juce::String& id, float value)
+    {
+        auto* parameter = processor.getApvts().getParameter (id);
+        parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+    }
+
+    /** Gives the processor a tempo, as a host that isn't playing would. */
+    class FixedTempoPlayHead  : public juce::AudioPlayHead
+    {
+    public:
+        explicit FixedTempoPlayHead (double bpmToUse)
+            : bpm (bpmToUse)
+        {
+        }
+
+        juce::Optional<PositionInfo> getPosition() const override
+        {
+            PositionInfo info;
+            info.setBpm (bpm);
+            info.setTimeSignature (TimeSignature {});
+            info.setIsPlaying (false);
+            return info;
+        }
+
+    private:
+        const double bpm;
+    };
+
+    //==============================================================================
+    class RenderJob  : public juce::ThreadPoolJob
+    {
+    public:
+        RenderJob (const juce::File& inputToUse, const RenderOptions& optionsToUse)
+            : juce::ThreadPoolJob (inputToUse.getFileName()),
+              input (inputToUse), options (optionsToUse)
+        {
+        }
+
+        JobStatus runJob() override
+        {
+            const auto start = juce::Time::getMillisecondCounterHiRes();
+
+            juce::AudioFormatManager formats;
+            formats.registerBasicFormats();
+
+            std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor (input));
+
+            if (reader == nullptr)
+            {
+                error = "can't read " + input.getFullPathName();
+                return jobHasFinished;
+            }
+
+            const auto numChannels = static_cast<int> (reader->numChannels);
+            const auto sampleRate = reader->sampleRate;
+            const auto directory = options.outputDirectory == juce::File() ? input.getParentDirectory()
+                                                                         : options.outputDirectory;
+            const auto output = directory.getChildFile (input.getFileNameWithoutExtension() + ".reversed.wav");
+
+            output.deleteFile();
+            std::unique_ptr<juce::OutputStream> stream (output.createOutputStream());
+            std::unique_ptr<juce::AudioFormatWriter> writer;
+
+            if (stream != nullptr)
+                writer.reset (juce::WavAudioFormat().createWriterFor (stream.get(), sampleRate, (unsigned int) numChannels,
+                                                                      juce::jmax (16, (int) reader->bitsPerSample), {}, 0));
+
+            if (writer == nullptr)
+            {
+                error = "can't write " + output.getFullPathName();
+                return jobHasFinished;
+            }
+
+            stream.release();   // now owned by the writer
+
+            FixedTempoPlayHead playHead (options.tempo);
+            ReversatronAudioProcessor processor;
+            processor.setNonRealtime (true);
+            processor.setIgnoresMemoryBudget (true);
+            processor.setPlayHead (&playHead);
+            processor.setPlayConfigDetails (numChannels, numChannels, sampleRate, options.blockSize);
+
+            // Disk storage streams in real time, so offline renders stay in memory.
+            setParameter (processor, "storage", 0.0f);
+            setParameter (processor, "captureFormat", (float) options.captureFormat);
+            setParameter (processor, "mode", (float) options.mode);
+
+            processor.prepareToPlay (sampleRate, options.blockSize);
+            processor.startTake (options.bufferLength, options.crossfadeTime);
+
+            juce::AudioBuffer<float> buffer (numChannels, options.blockSize);
+            juce::MidiBuffer midi;
+
+            // The latency is only settled once the first block has seen the
+            // tempo; that much of the output is dropped so that it lines up
+            // with the input, as it would in a host.
+            auto samplesToSkip = (juce::int64) -1;
+
+            auto renderBlock = [&] (int numSamples)
+            {
+                juce::AudioBuffer<float> block (buffer.getArrayOfWritePointers(), numChannels, numSamples);
+                processor.processBlock (block, midi);
+
+                if (samplesToSkip < 0)
+                    samplesToSkip = processor.getRequiredLatencySamples();
+
+                const auto numToSkip = (int) juce::jmin ((juce::int64) numSamples, samplesToSkip);
+                samplesToSkip -= numToSkip;
+
+                if (numToSkip < numSamples)
+                    writer->writeFromAudioSampleBuffer (block, numToSkip, numSamples - numToSkip);
+            };
+
+            for (juce::int64 position = 0; position < reader->lengthInSamples && ! shouldExit();)
+            {
+                const auto numSamples = (int) juce::jmin ((juce::int64) options.blockSize, reader->lengthInSamples - position);
+                reader->read (&buffer, 0, numSamples, position, true, true);
+                renderBlock (numSamples);
+                position += numSamples;
+            }
+
+            // Play out whatever is still recorded. A take that's still
+            // recording is reversed straight away, or in ping-pong mode left to
+            // finish its period and then played back.
+            const auto transport = processor.getTransportSnapshot();
+            const auto length = (juce::int64) transport.takeLength;
+            const auto frame = (juce::int64) transport.frame;
+            auto tail = (juce::int64) 0;
+
+            if (transport.status == ReversatronAudioProcessor::SLICING)
+            {
+                tail = processor.getRequiredLatencySamples();
+            }
+            else if (transport.status == ReversatronAudioProcessor::PLAYBACK)
+            {
+                tail = (juce::int64) transport.bufferLength - frame;
+            }
+            else if (transport.status == ReversatronAudioProcessor::CONTINUOUS || (transport.status == ReversatronAudioProcessor::RECORDING && options.mode == 1))
+            {
+                tail = (length - frame) + length;
+            }
+            else if (transport.status == ReversatronAudioProcessor::RECORDING)
+            {
+                processor.switchToPlayback();
+                tail = frame;
+            }
+
+            while (tail > 0 && ! shouldExit())
+            {
+                const auto numSamples = (int) juce::jmin ((juce::int64) options.blockSize, tail);
+                buffer.clear();
+                renderBlock (numSamples);
+                tail -= numSamples;
+            }
+
+            stats = processor.getDspLoadStats();
+            processor.releaseResources();
+
+            // A render that lost input isn't what the plugin would have made.
+            if (stats.numDroppedSamples > 0)
+            {
+                error = input.getFileName() + ": " + juce::String ((juce::int64) stats.numDroppedSamples)
+                      + " input samples were dropped, so " + output.getFileName() + " is incomplete";
+                return jobHasFinished;
+            }
+
+            secondsRendered = (double) reader->lengthInSamples / sampleRate;
+            secondsTaken = (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0;
+            return jobHasFinished;
+        }
+
+        const juce::File input;
+        const RenderOptions& options;
+        juce::String error;
+        double secondsRendered = 0.0, secondsTaken = 0.0;
+        DspLoadMonitor::Stats stats;
+    };
+
+    //==============================================================================
+    bool parseArguments (const juce::StringArray& args, RenderOptions& options)
+    {
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+            const auto hasValue = i + 1 < args.size();
+
+            if (arg == "--length" && hasValue)              options.bufferLength = juce::jlimit (0.5f, 500.0f, args[++i].getFloatValue());
+            else if (arg == "--crossfade" && hasValue)      options.crossfadeTime = juce::jlimit (0.0f, 250.0f, args[++i].getFloatValue());
+            else if (arg == "--mode" && hasValue)           options.mode = juce::jmax (0, juce::StringArray { "reverse", "pingpong", "slice" }.indexOf (args[++i]));
+            else if (arg == "--tempo" && hasValue)          options.tempo = juce::jlimit (20.0, 999.0, args[++i].getDoubleValue());
+            else if (arg == "--format" && hasValue)         options.captureFormat = juce::jmax (0, juce::StringArray { "float", "16", "24", "lossless", "double" }.indexOf (args[++i]));
+            else if (arg == "--block" && hasValue)          options.blockSize = juce::jlimit (16, 65536, args[++i].getIntValue());
+            else if (arg == "--jobs" && hasValue)           options.numJobs = juce::jmax (1, args[++i].getIntValue());
+            else if (arg == "--output" && hasValue)         options.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile (args[++i]);
+            else if (arg == "--stats")                      options.printStats = true;
+            else if (arg.startsWith ("--"))                 return false;
+            else                                            options.inputs.add (juce::File::getCurrentWorkingDirectory().getChildFile (arg));
+        }
+
+        return ! options.inputs.isEmpty();
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // The processor's parameters and editor need the message manager, even
+    // though nothing here is shown.
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray args;
+
+    for (int i = 1; i < argc; ++i)
+        args.add (argv[i]);
+
+    RenderOptions options;
+
+    if (! parseArguments (args, options))
+    {
+        std::cout << "Usage: ReversaTronRender [--length s] [--crossfade s] [--mode reverse|pingpong|slice] [--tempo bpm]" << std::endl
+                  << "                         [--format float|16|24|lossless|double] [--block n] [--jobs n]" << std::endl
+                  << "                         [--output dir] [--stats] file..." << std::endl;
+        return 1;
+    }
+
+    if (options.outputDirectory != juce::File())
+        options.outputDirectory.createDirectory();
+
+    const auto start = juce::Time::getMillisecondCounterHiRes();
+
+    juce::OwnedArray<RenderJob> jobs;
+    juce::ThreadPool pool (juce::jmin (options.numJobs, options.inputs.size()));
+
+    for (auto& input : options.inputs)
+        pool.addJob (jobs.add (new RenderJob (input, options)), false);
+
+    for (auto* job : jobs)
+        while (! pool.waitForJobToFinish (job, 1000)) {}
+
+    const auto secondsTaken = (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0;
+    auto secondsRendered = 0.0;
+    auto numFailed = 0;
+
+    for (auto* job : jobs)
+    {
+        if (job->error.isNotEmpty())
+        {
+            std::cerr << "Error: " << job->error << std::endl;
+            ++numFailed;
+            continue;
+        }
+
+        secondsRendered += job->secondsRendered;
+        std::cout << job->input.getFileName() << ": " << juce::String (job->secondsRendered, 1) << " s in "
+                  << juce::String (job->secondsTaken, 2) << " s ("
+                  << juce::String (job->secondsRendered / juce::jmax (1.0e-6, job->secondsTaken), 1) << "x realtime)" << std::endl;
+
+        if (options.printStats)
+            std::cout << juce::JSON::toString (job->stats.toVar(), true) << std::endl;
+
+        if (job->stats.numNonFiniteBlocks > 0)
+            std::cerr << "Warning: " << job->input.getFileName() << " produced NaN or infinite output" << std::endl;
+    }
+
+    std::cout << "Total: " << juce::String (secondsRendered, 1) << " s of audio in " << juce::String (secondsTaken, 2)
+              << " s on " << pool.getNumThreads() << " threads ("
+              << juce::String (secondsRendered / juce::jmax (1.0e-6, secondsTaken), 1) << "x realtime)" << std::endl;
+
+    return numFailed == 0 ? 0 : 1;
+}